@@ -0,0 +1,54 @@
+// malloc hooks for alloc_tracker. Link this object into a program to count its allocations, the
+// definitions here take precedence over glibc's, which they forward to.
+
+#include <cerrno>
+#include <cstddef>
+
+#include "common/alloc_tracker.h"
+
+extern "C" {
+
+void *__libc_malloc(size_t size) noexcept;
+void *__libc_calloc(size_t n, size_t size) noexcept;
+void *__libc_realloc(void *ptr, size_t size) noexcept;
+void *__libc_memalign(size_t alignment, size_t size) noexcept;
+void __libc_free(void *ptr) noexcept;
+
+void *malloc(size_t size) noexcept {
+  alloc_tracker::record_alloc(size);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) noexcept {
+  alloc_tracker::record_alloc(n * size);
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept {
+  alloc_tracker::record_alloc(size);
+  return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) noexcept {
+  alloc_tracker::record_alloc(size);
+  return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) noexcept {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) noexcept {
+  if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+  void *ptr = memalign(alignment, size);
+  if (!ptr) return ENOMEM;
+  *out = ptr;
+  return 0;
+}
+
+void free(void *ptr) noexcept {
+  if (ptr) alloc_tracker::record_free();
+  __libc_free(ptr);
+}
+
+}
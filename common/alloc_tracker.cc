@@ -0,0 +1,82 @@
+#include "common/alloc_tracker.h"
+
+#include <execinfo.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+
+namespace {
+
+// plain data, so the thread local needs no initialization that could allocate
+struct ThreadState {
+  alloc_tracker::Counters counters;
+  int no_alloc_depth;
+  NoAllocScope::Action action;
+  uint64_t violations;
+  bool in_report;
+};
+
+thread_local ThreadState state;
+std::atomic<bool> hooks_seen = false;
+
+void report(size_t size) {
+  // backtrace() may allocate on its first call
+  state.in_report = true;
+  fprintf(stderr, "allocation of %zu bytes in a NoAllocScope:\n", size);
+  void *frames[64];
+  int n = backtrace(frames, std::size(frames));
+  backtrace_symbols_fd(frames, n, STDERR_FILENO);
+  state.in_report = false;
+}
+
+}  // namespace
+
+namespace alloc_tracker {
+
+Counters thread_counters() {
+  return state.counters;
+}
+
+bool hooked() {
+  return hooks_seen.load(std::memory_order_relaxed);
+}
+
+void record_alloc(size_t size) {
+  if (!hooks_seen.load(std::memory_order_relaxed)) hooks_seen.store(true, std::memory_order_relaxed);
+  if (state.in_report) return;
+
+  state.counters.allocs++;
+  state.counters.bytes += size;
+  if (state.no_alloc_depth > 0) {
+    state.violations++;
+    if (state.action == NoAllocScope::Action::Abort) {
+      report(size);
+      abort();
+    } else if (state.action == NoAllocScope::Action::Log) {
+      report(size);
+    }
+  }
+}
+
+void record_free() {
+  if (!state.in_report) state.counters.frees++;
+}
+
+}  // namespace alloc_tracker
+
+NoAllocScope::NoAllocScope(Action action) : prev_action(state.action), start_violations(state.violations) {
+  state.action = action;
+  state.no_alloc_depth++;
+}
+
+NoAllocScope::~NoAllocScope() {
+  state.no_alloc_depth--;
+  state.action = prev_action;
+}
+
+uint64_t NoAllocScope::violations() const {
+  return state.violations - start_violations;
+}
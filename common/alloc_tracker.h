@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Counts the heap allocations of each thread, to measure and forbid them in realtime loops.
+// Counting needs the malloc hooks in alloc_hooks.cc linked into the program (`alloc_hooks` in
+// common/SConscript), without them the counters stay at zero and the guards never fire.
+// operator new goes through malloc, so C++ allocations are counted too.
+namespace alloc_tracker {
+
+struct Counters {
+  uint64_t allocs = 0;
+  uint64_t frees = 0;
+  uint64_t bytes = 0;  // requested by the allocations
+};
+
+// counters of the calling thread
+Counters thread_counters();
+// true once the malloc hooks have seen an allocation
+bool hooked();
+
+// called by the hooks
+void record_alloc(size_t size);
+void record_free();
+
+}  // namespace alloc_tracker
+
+// allocations of the current thread since construction
+class AllocCounter {
+public:
+  AllocCounter() : start(alloc_tracker::thread_counters()) {}
+  uint64_t allocs() const { return alloc_tracker::thread_counters().allocs - start.allocs; }
+  uint64_t bytes() const { return alloc_tracker::thread_counters().bytes - start.bytes; }
+
+private:
+  const alloc_tracker::Counters start;
+};
+
+// Forbids allocations by the current thread while in scope. Abort prints the backtrace of the
+// first one and aborts, Log prints the backtrace of every one, Count only counts them, for tests
+// to check violations(). Scopes nest, the innermost action applies.
+class NoAllocScope {
+public:
+  enum class Action { Abort, Log, Count };
+
+  explicit NoAllocScope(Action action = Action::Abort);
+  ~NoAllocScope();
+  NoAllocScope(const NoAllocScope &) = delete;
+  NoAllocScope &operator=(const NoAllocScope &) = delete;
+  uint64_t violations() const;
+
+private:
+  Action prev_action;
+  uint64_t start_violations;
+};
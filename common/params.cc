@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <cassert>
 #include <csignal>
+#include <cstring>
 #include <unordered_map>
 
 #include "common/queue.h"
@@ -96,6 +97,7 @@ std::unordered_map<std::string, uint32_t> keys = {
     {"AthenadUploadQueue", PERSISTENT},
     {"AthenadRecentlyViewedRoutes", PERSISTENT},
     {"BootCount", PERSISTENT},
+    {"BootlogJournalCursor", PERSISTENT},
     {"CalibrationParams", PERSISTENT},
     {"CameraDebugExpGain", CLEAR_ON_MANAGER_START},
     {"CameraDebugExpTime", CLEAR_ON_MANAGER_START},
@@ -203,6 +205,16 @@ std::unordered_map<std::string, uint32_t> keys = {
     {"Version", PERSISTENT},
 };
 
+// keys sorted by name, so key types can be merged into a sorted snapshot without hashing
+const std::vector<std::pair<std::string_view, uint32_t>> &sorted_keys() {
+  static const auto sorted = []() {
+    std::vector<std::pair<std::string_view, uint32_t>> v(keys.begin(), keys.end());
+    std::sort(v.begin(), v.end());
+    return v;
+  }();
+  return sorted;
+}
+
 } // namespace
 
 
@@ -310,6 +322,70 @@ std::map<std::string, std::string> Params::readAll() {
   return util::read_files_in_dir(getParamPath());
 }
 
+bool Params::snapshot(ParamsSnapshot *snapshot) {
+  std::string &arena = snapshot->arena_;
+  arena.clear();
+  snapshot->offsets_.clear();
+  snapshot->entries_.clear();
+
+  FileLock file_lock(params_path + "/.lock");
+
+  // everything is opened relative to the params directory
+  unique_fd dir_fd = HANDLE_EINTR(open(getParamPath().c_str(), O_RDONLY | O_DIRECTORY));
+  if (dir_fd < 0) return false;
+  int d_fd = HANDLE_EINTR(dup(dir_fd));
+  if (d_fd < 0) return false;
+  DIR *d = fdopendir(d_fd);
+  if (!d) {
+    close(d_fd);
+    return false;
+  }
+
+  struct dirent *de = NULL;
+  while ((de = readdir(d))) {
+    if (de->d_type == DT_DIR) continue;
+
+    unique_fd fd = HANDLE_EINTR(openat(dir_fd, de->d_name, O_RDONLY));
+    struct stat st = {};
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+    ParamsSnapshot::Offsets o = {.key = arena.size(), .key_len = strlen(de->d_name)};
+    arena.append(de->d_name, o.key_len + 1);
+    o.value = arena.size();
+    arena.resize(o.value + st.st_size + 1);
+    ssize_t n = 0;
+    while (o.value_len < (size_t)st.st_size && (n = HANDLE_EINTR(read(fd, &arena[o.value + o.value_len], st.st_size - o.value_len))) > 0) {
+      o.value_len += n;
+    }
+    arena.resize(o.value + o.value_len);
+    arena.push_back('\0');
+    snapshot->offsets_.push_back(o);
+  }
+  closedir(d);
+
+  // the arena doesn't move anymore, build the views
+  auto &entries = snapshot->entries_;
+  for (const auto &o : snapshot->offsets_) {
+    entries.push_back({std::string_view(arena.data() + o.key, o.key_len),
+                       std::string_view(arena.data() + o.value, o.value_len), static_cast<ParamKeyType>(0)});
+  }
+  std::sort(entries.begin(), entries.end(), [](auto &a, auto &b) { return a.key < b.key; });
+
+  // merge in the key types
+  const auto &types = sorted_keys();
+  auto it = types.begin();
+  for (auto &e : entries) {
+    while (it != types.end() && it->first < e.key) ++it;
+    if (it != types.end() && it->first == e.key) e.type = static_cast<ParamKeyType>(it->second);
+  }
+  return true;
+}
+
+const ParamEntry *ParamsSnapshot::find(std::string_view key) const {
+  auto it = std::lower_bound(entries_.begin(), entries_.end(), key, [](auto &e, std::string_view k) { return e.key < k; });
+  return (it != entries_.end() && it->key == key) ? &(*it) : nullptr;
+}
+
 void Params::clearAll(ParamKeyType key_type) {
   FileLock file_lock(params_path + "/.lock");
 
@@ -3,6 +3,7 @@
 #include <future>
 #include <map>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -19,6 +20,40 @@ enum ParamKeyType {
   ALL = 0xFFFFFFFF
 };
 
+struct ParamEntry {
+  std::string_view key;
+  std::string_view value;
+  ParamKeyType type;  // 0 for unknown keys
+};
+
+// All params read at once into a single buffer. Entries are sorted by key and
+// point into the buffer (NUL terminated), so they're only valid while the snapshot is alive.
+// Reusing a snapshot for another read doesn't allocate once its buffers are large enough.
+class ParamsSnapshot {
+public:
+  const std::vector<ParamEntry> &entries() const { return entries_; }
+  // returns nullptr if the key isn't in the snapshot
+  const ParamEntry *find(std::string_view key) const;
+  // "" if the key isn't in the snapshot
+  std::string_view get(std::string_view key) const {
+    const ParamEntry *e = find(key);
+    return e ? e->value : std::string_view("");
+  }
+  // the NUL terminated value, cut at its first NUL byte, "" if the key isn't in the snapshot
+  const char *c_str(std::string_view key) const {
+    const ParamEntry *e = find(key);
+    return e ? e->value.data() : "";
+  }
+
+private:
+  friend class Params;
+  struct Offsets { size_t key, key_len, value, value_len; };
+
+  std::string arena_;
+  std::vector<Offsets> offsets_;
+  std::vector<ParamEntry> entries_;
+};
+
 class Params {
 public:
   explicit Params(const std::string &path = {});
@@ -44,6 +79,7 @@ public:
     return get(key, block) == "1";
   }
   std::map<std::string, std::string> readAll();
+  bool snapshot(ParamsSnapshot *snapshot);
 
   // helpers for writing values
   int put(const char *key, const char *val, size_t value_size);
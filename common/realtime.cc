@@ -0,0 +1,82 @@
+#include "common/realtime.h"
+
+#include <alloca.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "common/swaglog.h"
+#include "common/util.h"
+
+const std::map<std::string, RealtimeProfile> &realtime_profiles() {
+  // camerad and encoderd map large camera and encoder buffers, locking them all would pin
+  // hundreds of MB, so they only prefault their stacks
+  static const std::map<std::string, RealtimeProfile> profiles = {
+    {"pandad", {.policy = SCHED_FIFO, .priority = 54, .cores = {3}, .lock_memory = true, .stack_prefault = 256 * 1024}},
+    {"camerad", {.policy = SCHED_FIFO, .priority = 53, .cores = {6}, .stack_prefault = 256 * 1024}},
+    {"encoderd", {.policy = SCHED_FIFO, .priority = 52, .cores = {3}, .stack_prefault = 256 * 1024}},
+    // TODO: why does a realtime priority impact camerad timings? loggerd stays SCHED_OTHER until we know
+    {"loggerd", {.cores = {0, 1, 2, 3}}},
+    {"sensord", {.cores = {1}, .nice = -18, .lock_memory = true, .stack_prefault = 64 * 1024}},
+  };
+  return profiles;
+}
+
+static void prefault_stack(size_t size) {
+  volatile unsigned char *stack = (volatile unsigned char *)alloca(size);
+  const long page_size = sysconf(_SC_PAGESIZE);
+  for (size_t i = 0; i < size; i += page_size) {
+    stack[i] = 0;
+  }
+}
+
+int apply_realtime_profile(const RealtimeProfile &profile) {
+  int ret = 0;
+  // MCL_ONFAULT locks pages as they are touched instead of populating every mapping up front,
+  // including reserved but unused heap and thread stacks
+#ifdef MCL_ONFAULT
+  const int lock_flags = MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT;
+#else
+  const int lock_flags = MCL_CURRENT | MCL_FUTURE;
+#endif
+  if (profile.lock_memory && mlockall(lock_flags) != 0) {
+    // e.g. RLIMIT_MEMLOCK is too low. Page faults can still hit the realtime threads, but they run.
+    LOGW("mlockall failed: %s", strerror(errno));
+  }
+  if (profile.stack_prefault > 0) {
+    prefault_stack(profile.stack_prefault);
+  }
+
+#ifdef __linux__
+  if (profile.policy == SCHED_OTHER) {
+    if (profile.nice != 0 && setpriority(PRIO_PROCESS, 0, profile.nice) != 0) {
+      LOGE("setpriority(%d) failed: %s", profile.nice, strerror(errno));
+      ret = -1;
+    }
+  } else {
+    struct sched_param sa = {.sched_priority = profile.priority};
+    if (sched_setscheduler(0, profile.policy, &sa) != 0) {
+      LOGE("sched_setscheduler(%d, %d) failed: %s", profile.policy, profile.priority, strerror(errno));
+      ret = -1;
+    }
+  }
+#endif
+
+  if (!profile.cores.empty() && util::set_core_affinity(profile.cores) != 0) {
+    LOGE("setting the core affinity failed: %s", strerror(errno));
+    ret = -1;
+  }
+  return ret;
+}
+
+int config_realtime_process(const std::string &process) {
+  auto it = realtime_profiles().find(process);
+  if (it == realtime_profiles().end()) {
+    LOGE("no realtime profile for %s", process.c_str());
+    return -1;
+  }
+  return apply_realtime_profile(it->second);
+}
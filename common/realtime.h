@@ -0,0 +1,27 @@
+#pragma once
+
+#include <sched.h>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// How a process's realtime threads are scheduled, applied at startup by config_realtime_process().
+struct RealtimeProfile {
+  int policy = SCHED_OTHER;  // SCHED_FIFO, SCHED_RR or SCHED_OTHER
+  int priority = 0;          // for SCHED_FIFO and SCHED_RR
+  std::vector<int> cores;    // CPU set, empty for any
+  int nice = 0;              // for SCHED_OTHER
+  bool lock_memory = false;  // mlockall on fault, so touched pages aren't paged out under the realtime threads
+  size_t stack_prefault = 0;  // bytes of the stack to fault in
+};
+
+// profiles of the processes, keyed by name
+const std::map<std::string, RealtimeProfile> &realtime_profiles();
+
+// Apply `profile` to the calling thread, memory locking applies to the whole process.
+// Returns 0 on success, or -1 if any step failed. Failing to lock memory only logs a warning.
+int apply_realtime_profile(const RealtimeProfile &profile);
+// apply the profile of `process`, -1 if it has none
+int config_realtime_process(const std::string &process);
@@ -4,17 +4,75 @@
 
 #include "common/swaglog.h"
 
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <limits>
+#include <memory>
 #include <mutex>
+#include <numeric>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <zmq.h>
 #include <stdarg.h>
 #include "third_party/json11/json11.hpp"
+#include "common/spsc_queue.h"
+#include "common/util.h"
 #include "common/version.h"
 #include "system/hardware/hw.h"
 
+namespace {
+
+// Messages below SYNC_LEVEL are formatted on the calling thread into a record on that thread's
+// queue, and turned into json and sent by the drain thread. Errors, messages too long for a record
+// and logging from exiting threads are sent synchronously, after what the same thread already queued.
+constexpr int SYNC_LEVEL = CLOUDLOG_ERROR;
+constexpr size_t RECORD_MSG_SIZE = 512;
+constexpr size_t QUEUE_SIZE = 256;
+
+struct LogRecord {
+  int levelnum;
+  const char* filename;
+  int lineno;
+  const char* func;
+  double created;
+  bool timestamp;  // a cloudlog_te event
+  uint64_t event_time;
+  uint32_t frame_id;
+  char msg[RECORD_MSG_SIZE];
+};
+
+struct LogQueue {
+  LogQueue() : records(QUEUE_SIZE) {}
+  SpscQueue<LogRecord> records;
+  std::atomic<uint64_t> dropped = 0;
+  std::atomic<bool> closed = false;
+  uint64_t reported_dropped = 0;  // with SwaglogState::lock held
+};
+
+// the calling thread's queue, closed when the thread exits
+struct ThreadQueue {
+  ~ThreadQueue() {
+    if (queue) queue->closed = true;
+    exited = true;
+  }
+  std::shared_ptr<LogQueue> queue;
+  bool exited = false;
+};
+
+thread_local ThreadQueue thread_queue;
+
+}  // namespace
+
+bool LOG_TIMESTAMPS = getenv("LOG_TIMESTAMPS");
+uint32_t NO_FRAME_ID = std::numeric_limits<uint32_t>::max();
+
 class SwaglogState {
 public:
   SwaglogState() {
@@ -56,19 +114,72 @@ public:
     ctx_j["version"] = COMMA_VERSION;
     ctx_j["dirty"] = !getenv("CLEAN");
     ctx_j["device"] = Hardware::get_name();
+
+    drain_thread = std::thread(&SwaglogState::drain_loop, this);
   }
 
   ~SwaglogState() {
+    {
+      std::lock_guard lk(stop_lock);
+      stop = true;
+    }
+    stop_cv.notify_one();
+    drain_thread.join();
+
     zmq_close(sock);
     zmq_ctx_destroy(zctx);
   }
 
-  void log(int levelnum, const char* filename, int lineno, const char* func, const char* msg, const std::string& log_s) {
+  // nullptr if the calling thread is exiting and has no queue anymore
+  LogQueue* queue() {
+    if (thread_queue.exited) return nullptr;
+    if (!thread_queue.queue) {
+      thread_queue.queue = std::make_shared<LogQueue>();
+      std::lock_guard lk(queues_lock);
+      queues.push_back(thread_queue.queue);
+    }
+    return thread_queue.queue.get();
+  }
+
+  void log(int levelnum, const char* filename, int lineno, const char* func, const char* msg, const json11::Json &msg_j,
+           double created) {
+    // keep the order of what this thread already queued, other threads' records are left to the drain thread
+    if (thread_queue.exited) drain();
     std::lock_guard lk(lock);
-    if (levelnum >= print_level) {
-      printf("%s: %s\n", filename, msg);
+    if (!thread_queue.exited && thread_queue.queue) drain_queue(*thread_queue.queue);
+    send(levelnum, filename, lineno, func, msg, msg_j, created);
+  }
+
+  // called after a record is queued, wakes the drain thread once per drain instead of once per record
+  void notify() {
+    if (pending.exchange(true, std::memory_order_acq_rel)) return;
+    {
+      // the drain thread is either before its check of `pending` or waiting
+      std::lock_guard lk(stop_lock);
     }
-    zmq_send(sock, log_s.data(), log_s.length(), ZMQ_NOBLOCK);
+    stop_cv.notify_one();
+  }
+
+  void drain() {
+    std::lock_guard queues_lk(queues_lock);
+    std::lock_guard lk(lock);
+    for (auto it = queues.begin(); it != queues.end();) {
+      // read before popping, nothing is pushed after the queue is closed
+      bool closed = (*it)->closed;
+      drain_queue(**it);
+      it = closed ? queues.erase(it) : it + 1;
+    }
+  }
+
+  static json11::Json timestamp_json(const char* event, uint64_t event_time, uint32_t frame_id) {
+    json11::Json::object tspt_j = json11::Json::object{
+      {"event", event},
+      {"time", std::to_string(event_time)}
+    };
+    if (frame_id < NO_FRAME_ID) {
+      tspt_j["frame_id"] = std::to_string(frame_id);
+    }
+    return json11::Json::object{{"timestamp", tspt_j}};
   }
 
   std::mutex lock;
@@ -76,77 +187,168 @@ public:
   void* sock = nullptr;
   int print_level;
   json11::Json::object ctx_j;
-};
 
-bool LOG_TIMESTAMPS = getenv("LOG_TIMESTAMPS");
-uint32_t NO_FRAME_ID = std::numeric_limits<uint32_t>::max();
+  std::atomic<uint64_t> sent = 0;
+  std::atomic<uint64_t> dropped = 0;
 
-static void cloudlog_common(int levelnum, const char* filename, int lineno, const char* func,
-                            char* msg_buf, const json11::Json::object &msg_j={}) {
-  static SwaglogState s;
+private:
+  // with lock held, which also keeps the queue's consumer single
+  void drain_queue(LogQueue &q) {
+    while (q.records.try_pop(record)) {
+      if (record.timestamp) {
+        send(record.levelnum, record.filename, record.lineno, record.func, record.msg,
+             timestamp_json(record.msg, record.event_time, record.frame_id), record.created);
+      } else {
+        send(record.levelnum, record.filename, record.lineno, record.func, record.msg, record.msg, record.created);
+      }
+    }
 
-  json11::Json::object log_j = json11::Json::object {
-    {"ctx", s.ctx_j},
-    {"levelnum", levelnum},
-    {"filename", filename},
-    {"lineno", lineno},
-    {"funcname", func},
-    {"created", seconds_since_epoch()}
-  };
-  if (msg_j.empty()) {
-    log_j["msg"] = msg_buf;
-  } else {
-    log_j["msg"] = msg_j;
+    uint64_t q_dropped = q.dropped.load(std::memory_order_relaxed);
+    if (q_dropped != q.reported_dropped) {
+      std::string msg = util::string_format("swaglog: %llu messages dropped", (unsigned long long)(q_dropped - q.reported_dropped));
+      send(CLOUDLOG_WARNING, __FILE__, __LINE__, __func__, msg.c_str(), msg, seconds_since_epoch());
+      q.reported_dropped = q_dropped;
+    }
+  }
+
+  // with lock held
+  void send(int levelnum, const char* filename, int lineno, const char* func, const char* msg, const json11::Json &msg_j,
+            double created) {
+    json11::Json::object log_j = json11::Json::object {
+      {"ctx", ctx_j},
+      {"levelnum", levelnum},
+      {"filename", filename},
+      {"lineno", lineno},
+      {"funcname", func},
+      {"created", created},
+      {"msg", msg_j},
+    };
+
+    log_s.clear();
+    log_s += (char)levelnum;
+    ((json11::Json)log_j).dump(log_s);
+
+    if (levelnum >= print_level) {
+      printf("%s: %s\n", filename, msg);
+    }
+    zmq_send(sock, log_s.data(), log_s.length(), ZMQ_NOBLOCK);
+    sent.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void drain_loop() {
+    util::set_thread_name("swaglog");
+#ifdef __linux__
+    // don't inherit the realtime priority and the cores of the thread that logged first
+    struct sched_param sa = {.sched_priority = 0};
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &sa);
+    std::vector<int> cores(sysconf(_SC_NPROCESSORS_CONF));
+    std::iota(cores.begin(), cores.end(), 0);
+    util::set_core_affinity(cores);
+#endif
+    while (true) {
+      {
+        std::unique_lock lk(stop_lock);
+        stop_cv.wait(lk, [this] { return stop || pending.load(std::memory_order_acquire); });
+        if (stop) break;
+      }
+      pending.exchange(false, std::memory_order_acq_rel);
+      drain();
+    }
+    drain();
   }
 
   std::string log_s;
-  log_s += (char)levelnum;
-  ((json11::Json)log_j).dump(log_s);
-  s.log(levelnum, filename, lineno, func, msg_buf, log_s);
+  LogRecord record;
 
-  free(msg_buf);
-}
+  std::mutex queues_lock;
+  std::vector<std::shared_ptr<LogQueue>> queues;
 
-void cloudlog_e(int levelnum, const char* filename, int lineno, const char* func,
-                const char* fmt, ...) {
-  va_list args;
-  va_start(args, fmt);
-  char* msg_buf = nullptr;
-  int ret = vasprintf(&msg_buf, fmt, args);
-  va_end(args);
-  if (ret <= 0 || !msg_buf) return;
-  cloudlog_common(levelnum, filename, lineno, func, msg_buf);
+  std::mutex stop_lock;
+  std::condition_variable stop_cv;
+  bool stop = false;
+  std::atomic<bool> pending = false;  // records were queued since the drain thread last woke up
+  std::thread drain_thread;
+};
+
+static SwaglogState &swaglog_state() {
+  static SwaglogState s;
+  return s;
 }
 
-void cloudlog_t_common(int levelnum, const char* filename, int lineno, const char* func,
-                       uint32_t frame_id, const char* fmt, va_list args) {
-  if (!LOG_TIMESTAMPS) return;
+static void cloudlog_common(int levelnum, const char* filename, int lineno, const char* func,
+                            bool timestamp, uint32_t frame_id, const char* fmt, va_list args) {
+  SwaglogState &s = swaglog_state();
+  double created = seconds_since_epoch();
+  uint64_t event_time = timestamp ? nanos_since_boot() : 0;
+
+  LogQueue* q = levelnum < SYNC_LEVEL ? s.queue() : nullptr;
+  if (q) {
+    LogRecord record;
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int ret = vsnprintf(record.msg, sizeof(record.msg), fmt, args_copy);
+    va_end(args_copy);
+    if (ret <= 0) return;
+
+    if (ret < (int)sizeof(record.msg)) {
+      record.levelnum = levelnum;
+      record.filename = filename;
+      record.lineno = lineno;
+      record.func = func;
+      record.created = created;
+      record.timestamp = timestamp;
+      record.event_time = event_time;
+      record.frame_id = frame_id;
+      if (!q->records.try_push(record)) {
+        q->dropped.fetch_add(1, std::memory_order_relaxed);
+        s.dropped.fetch_add(1, std::memory_order_relaxed);
+      }
+      s.notify();
+      return;
+    }
+  }
+
   char* msg_buf = nullptr;
   int ret = vasprintf(&msg_buf, fmt, args);
   if (ret <= 0 || !msg_buf) return;
-  json11::Json::object tspt_j = json11::Json::object{
-    {"event", msg_buf},
-    {"time", std::to_string(nanos_since_boot())}
-  };
-  if (frame_id < NO_FRAME_ID) {
-    tspt_j["frame_id"] = std::to_string(frame_id);
+  if (timestamp) {
+    s.log(levelnum, filename, lineno, func, msg_buf, SwaglogState::timestamp_json(msg_buf, event_time, frame_id), created);
+  } else {
+    s.log(levelnum, filename, lineno, func, msg_buf, msg_buf, created);
   }
-  tspt_j = json11::Json::object{{"timestamp", tspt_j}};
-  cloudlog_common(levelnum, filename, lineno, func, msg_buf, tspt_j);
+  free(msg_buf);
 }
 
+void cloudlog_e(int levelnum, const char* filename, int lineno, const char* func,
+                const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  cloudlog_common(levelnum, filename, lineno, func, false, NO_FRAME_ID, fmt, args);
+  va_end(args);
+}
 
 void cloudlog_te(int levelnum, const char* filename, int lineno, const char* func,
                  const char* fmt, ...) {
+  if (!LOG_TIMESTAMPS) return;
   va_list args;
   va_start(args, fmt);
-  cloudlog_t_common(levelnum, filename, lineno, func, NO_FRAME_ID, fmt, args);
+  cloudlog_common(levelnum, filename, lineno, func, true, NO_FRAME_ID, fmt, args);
   va_end(args);
 }
 void cloudlog_te(int levelnum, const char* filename, int lineno, const char* func,
                  uint32_t frame_id, const char* fmt, ...) {
+  if (!LOG_TIMESTAMPS) return;
   va_list args;
   va_start(args, fmt);
-  cloudlog_t_common(levelnum, filename, lineno, func, frame_id, fmt, args);
+  cloudlog_common(levelnum, filename, lineno, func, true, frame_id, fmt, args);
   va_end(args);
 }
+
+SwaglogStats swaglog_stats() {
+  SwaglogState &s = swaglog_state();
+  return {.sent = s.sent.load(), .dropped = s.dropped.load()};
+}
+
+void swaglog_flush() {
+  swaglog_state().drain();
+}
@@ -24,6 +24,15 @@ void cloudlog_te(int levelnum, const char* filename, int lineno, const char* fun
 void cloudlog_te(int levelnum, const char* filename, int lineno, const char* func,
                  uint32_t frame_id, const char* fmt, ...) SWAG_LOG_CHECK_FMT(6, 7);
 
+struct SwaglogStats {
+  uint64_t sent;     // records sent to logmessaged, including the dropped record warnings
+  uint64_t dropped;  // records dropped because the logging thread's queue was full
+};
+
+SwaglogStats swaglog_stats();
+// send everything queued so far, on the calling thread
+void swaglog_flush();
+
 
 #define cloudlog(lvl, fmt, ...) cloudlog_e(lvl, __FILE__, __LINE__, \
                                            __func__, \
@@ -0,0 +1,51 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "common/alloc_tracker.h"
+
+TEST_CASE("AllocCounter") {
+  REQUIRE(alloc_tracker::hooked());
+
+  AllocCounter counter;
+  std::vector<std::string> strings;
+  for (int i = 0; i < 10; ++i) {
+    strings.push_back(std::string(100, 'a' + i));
+  }
+  REQUIRE(counter.allocs() >= 10);
+  REQUIRE(counter.bytes() >= 10 * 100);
+
+  // other threads have their own counters
+  AllocCounter main_counter;
+  std::thread([] { std::vector<int> v(1000); }).join();
+  REQUIRE(main_counter.bytes() < 1000 * sizeof(int));
+}
+
+TEST_CASE("NoAllocScope") {
+  std::vector<int> v;
+  v.reserve(100);
+
+  SECTION("steady state") {
+    NoAllocScope no_alloc(NoAllocScope::Action::Count);
+    for (int i = 0; i < 100; ++i) v.push_back(i);
+    v.clear();
+    REQUIRE(no_alloc.violations() == 0);
+  }
+  SECTION("growth") {
+    NoAllocScope no_alloc(NoAllocScope::Action::Count);
+    for (int i = 0; i < 101; ++i) v.push_back(i);
+    REQUIRE(no_alloc.violations() == 1);
+  }
+  SECTION("nested") {
+    NoAllocScope outer(NoAllocScope::Action::Count);
+    {
+      NoAllocScope inner(NoAllocScope::Action::Count);
+      std::string s(100, 'x');
+      REQUIRE(inner.violations() == 1);
+    }
+    REQUIRE(outer.violations() == 1);
+    std::string s(100, 'y');
+    REQUIRE(outer.violations() == 2);
+  }
+}
@@ -1,3 +1,4 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch2/catch.hpp"
 #define private public
 #include "common/params.h"
@@ -25,3 +26,70 @@ TEST_CASE("params_nonblocking_put") {
     REQUIRE(p.get(name) == "1");
   }
 }
+
+TEST_CASE("params_snapshot") {
+  char tmp_path[] = "/tmp/params_snapshot_XXXXXX";
+  const std::string param_path = mkdtemp(tmp_path);
+  Params params(param_path);
+  params.put("CarParams", "car");
+  params.put("IsMetric", "1");
+  params.put("AccessToken", std::string("a\0b", 3));
+  params.put("NotARealKey", "");
+
+  ParamsSnapshot snapshot;
+  REQUIRE(params.snapshot(&snapshot));
+
+  const auto all = params.readAll();
+  REQUIRE(snapshot.entries().size() == all.size());
+  auto it = all.begin();
+  for (const auto &entry : snapshot.entries()) {
+    REQUIRE(entry.key == it->first);
+    REQUIRE(entry.value == it->second);
+    REQUIRE(entry.value.data()[entry.value.size()] == '\0');
+    REQUIRE(entry.type == (params.checkKey(it->first) ? params.getKeyType(it->first) : 0));
+    ++it;
+  }
+
+  REQUIRE(snapshot.get("IsMetric") == "1");
+  REQUIRE(snapshot.get("AccessToken") == std::string_view("a\0b", 3));
+  REQUIRE((snapshot.find("AccessToken")->type & DONT_LOG));
+  REQUIRE(snapshot.find("NotARealKey")->type == 0);
+  REQUIRE(snapshot.find("IsDriverViewEnabled") == nullptr);
+  REQUIRE(snapshot.get("IsDriverViewEnabled").data() != nullptr);
+  REQUIRE(snapshot.get("IsDriverViewEnabled").empty());
+  REQUIRE(std::string(snapshot.c_str("IsMetric")) == "1");
+  REQUIRE(std::string(snapshot.c_str("IsDriverViewEnabled")).empty());
+
+  // reusing a snapshot picks up changes
+  params.remove("CarParams");
+  REQUIRE(params.snapshot(&snapshot));
+  REQUIRE(snapshot.find("CarParams") == nullptr);
+  REQUIRE(snapshot.entries().size() == all.size() - 1);
+}
+
+TEST_CASE("params_snapshot_benchmark", "[.][benchmark]") {
+  char tmp_path[] = "/tmp/params_snapshot_bench_XXXXXX";
+  const std::string param_path = mkdtemp(tmp_path);
+  Params params(param_path);
+  for (const auto &key : params.allKeys()) {
+    params.put(key, util::random_string(64));
+  }
+
+  BENCHMARK("readAll + getKeyType") {
+    size_t dont_log = 0;
+    for (const auto &[key, value] : params.readAll()) {
+      dont_log += (params.getKeyType(key) & DONT_LOG) != 0;
+    }
+    return dont_log;
+  };
+
+  ParamsSnapshot snapshot;
+  BENCHMARK("snapshot") {
+    params.snapshot(&snapshot);
+    size_t dont_log = 0;
+    for (const auto &entry : snapshot.entries()) {
+      dont_log += (entry.type & DONT_LOG) != 0;
+    }
+    return dont_log;
+  };
+}
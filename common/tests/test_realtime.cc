@@ -0,0 +1,114 @@
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "common/realtime.h"
+
+TEST_CASE("realtime_profiles") {
+  const auto &profiles = realtime_profiles();
+  for (auto name : {"pandad", "camerad", "encoderd", "loggerd", "sensord"}) {
+    REQUIRE(profiles.count(name) == 1);
+  }
+  for (const auto &[name, profile] : profiles) {
+    INFO(name);
+    if (profile.policy == SCHED_OTHER) {
+      REQUIRE(profile.priority == 0);
+    } else {
+      REQUIRE(profile.nice == 0);
+      REQUIRE(profile.priority >= sched_get_priority_min(profile.policy));
+      REQUIRE(profile.priority <= sched_get_priority_max(profile.policy));
+    }
+  }
+  REQUIRE(config_realtime_process("not_a_process") == -1);
+}
+
+// catch2 assertions aren't thread safe, the profile is applied on a thread and checked on the main one
+TEST_CASE("apply_realtime_profile") {
+  int ret = -1, priority = 0;
+  std::thread([&] {
+    RealtimeProfile profile = {.nice = 1, .stack_prefault = 64 * 1024};
+    ret = apply_realtime_profile(profile);
+    priority = getpriority(PRIO_PROCESS, 0);
+  }).join();
+  REQUIRE(ret == 0);
+  REQUIRE(priority >= 1);
+}
+
+TEST_CASE("apply_realtime_profile memory locking isn't fatal") {
+  // an unprivileged process can't lock anything with no RLIMIT_MEMLOCK
+  struct rlimit old_limit;
+  REQUIRE(getrlimit(RLIMIT_MEMLOCK, &old_limit) == 0);
+  struct rlimit limit = {.rlim_cur = 0, .rlim_max = old_limit.rlim_max};
+  REQUIRE(setrlimit(RLIMIT_MEMLOCK, &limit) == 0);
+  int ret = -1;
+  std::thread([&] {
+    RealtimeProfile profile = {.lock_memory = true};
+    ret = apply_realtime_profile(profile);
+  }).join();
+  munlockall();
+  setrlimit(RLIMIT_MEMLOCK, &old_limit);
+  REQUIRE(ret == 0);
+}
+
+// cyclictest style wakeup latency of a thread running each profile, while other threads keep all
+// cores busy. Needs root and the device's cores for the profiles, otherwise these fall back to
+// SCHED_OTHER on any core.
+TEST_CASE("realtime wakeup latency", "[.][realtime]") {
+  const int period_us = 1000;
+  const int loops = 5000;
+
+  std::atomic<bool> stop = false;
+  std::vector<std::thread> load;
+  for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); ++i) {
+    load.emplace_back([&] {
+      volatile uint64_t x = 0;
+      while (!stop) x = x + 1;
+    });
+  }
+
+  for (const auto &[name, profile] : realtime_profiles()) {
+    std::vector<int64_t> latency_us;
+    std::thread([&, p = profile] {
+      RealtimeProfile applied = p;
+      if (apply_realtime_profile(applied) != 0) {
+        applied.policy = SCHED_OTHER;
+        applied.priority = 0;
+        applied.lock_memory = false;
+        applied.cores.clear();
+        apply_realtime_profile(applied);
+      }
+
+      latency_us.reserve(loops);
+      struct timespec next;
+      clock_gettime(CLOCK_MONOTONIC, &next);
+      for (int i = 0; i < loops; ++i) {
+        next.tv_nsec += period_us * 1000;
+        if (next.tv_nsec >= 1000000000) {
+          next.tv_nsec -= 1000000000;
+          next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        latency_us.push_back(((now.tv_sec - next.tv_sec) * 1000000000LL + (now.tv_nsec - next.tv_nsec)) / 1000);
+      }
+    }).join();
+
+    std::sort(latency_us.begin(), latency_us.end());
+    int64_t sum = 0;
+    for (auto l : latency_us) sum += l;
+    printf("%-10s min %4ld us, avg %4ld us, p99 %5ld us, max %5ld us\n", name.c_str(), (long)latency_us.front(),
+           (long)(sum / latency_us.size()), (long)latency_us[latency_us.size() * 99 / 100], (long)latency_us.back());
+  }
+
+  stop = true;
+  for (auto &t : load) t.join();
+}
@@ -1,8 +1,14 @@
 #include <zmq.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
 
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch2/catch.hpp"
+#include "common/alloc_tracker.h"
 #include "common/swaglog.h"
 #include "common/util.h"
 #include "common/version.h"
@@ -86,3 +92,76 @@ TEST_CASE("swaglog") {
 
   recv_log(thread_cnt, thread_msg_cnt);
 }
+
+TEST_CASE("swaglog queue overflow") {
+  const int msg_cnt = 10000;
+  SwaglogStats before = swaglog_stats();
+  std::thread([=] {
+    for (int i = 0; i < msg_cnt; ++i) {
+      LOGD("%d", i);
+    }
+  }).join();
+  swaglog_flush();
+  SwaglogStats after = swaglog_stats();
+
+  // every message is either sent or dropped, and the drops are logged
+  const uint64_t dropped = after.dropped - before.dropped;
+  REQUIRE(dropped > 0);
+  REQUIRE(after.sent - before.sent > msg_cnt - dropped);
+}
+
+TEST_CASE("swaglog queued messages don't allocate") {
+  if (!alloc_tracker::hooked()) return;
+
+  // the first message creates the thread's queue
+  LOGD("setup");
+  NoAllocScope no_alloc(NoAllocScope::Action::Count);
+  for (int i = 0; i < 100; ++i) {
+    LOGD("%d %s %.2f", i, "no alloc", i * 0.5);
+  }
+  REQUIRE(no_alloc.violations() == 0);
+}
+
+TEST_CASE("swaglog_benchmark", "[.][benchmark]") {
+  BENCHMARK("LOGD") {
+    LOGD("benchmark %d %s", 42, "message");
+  };
+
+  // caller side cost of a burst, including the drops once the queue is full
+  const int msg_cnt = 100000;
+  std::vector<uint64_t> times(msg_cnt);
+  SwaglogStats before = swaglog_stats();
+  for (int i = 0; i < msg_cnt; ++i) {
+    uint64_t start = nanos_since_boot();
+    LOGD("burst %d", i);
+    times[i] = nanos_since_boot() - start;
+  }
+  swaglog_flush();
+  SwaglogStats after = swaglog_stats();
+
+  std::sort(times.begin(), times.end());
+  printf("burst of %d: p50 %lu ns, p99 %lu ns, max %lu ns, %lu dropped\n", msg_cnt, (unsigned long)times[msg_cnt / 2],
+         (unsigned long)times[msg_cnt * 99 / 100], (unsigned long)times.back(), (unsigned long)(after.dropped - before.dropped));
+
+  // errors are sent on the caller thread, while other threads keep queueing
+  std::atomic<bool> exit = false;
+  std::vector<std::thread> loggers;
+  for (int i = 0; i < 4; ++i) {
+    loggers.emplace_back([&] {
+      while (!exit) LOGD("background %d", 42);
+    });
+  }
+  const int err_cnt = 10000;
+  std::vector<uint64_t> err_times(err_cnt);
+  for (int i = 0; i < err_cnt; ++i) {
+    uint64_t start = nanos_since_boot();
+    LOGE("error %d", i);
+    err_times[i] = nanos_since_boot() - start;
+  }
+  exit = true;
+  for (auto &t : loggers) t.join();
+
+  std::sort(err_times.begin(), err_times.end());
+  printf("LOGE with 4 logging threads: p50 %lu ns, p99 %lu ns, max %lu ns\n", (unsigned long)err_times[err_cnt / 2],
+         (unsigned long)err_times[err_cnt * 99 / 100], (unsigned long)err_times.back());
+}
@@ -10,6 +10,7 @@
 #include <string>
 
 #include "catch2/catch.hpp"
+#include "common/spsc_queue.h"
 #include "common/util.h"
 
 std::string random_bytes(int size) {
@@ -145,3 +146,34 @@ TEST_CASE("util::create_directories") {
     REQUIRE(util::create_directories("", 0755) == false);
   }
 }
+
+TEST_CASE("SpscQueue") {
+  SpscQueue<int> q(5);
+  REQUIRE(q.capacity() == 8);
+
+  SECTION("bounded") {
+    for (int i = 0; i < 8; ++i) REQUIRE(q.try_push(i));
+    REQUIRE_FALSE(q.try_push(8));
+    int v;
+    REQUIRE(q.try_pop(v));
+    REQUIRE(v == 0);
+    REQUIRE(q.try_push(8));
+    REQUIRE(q.size() == 8);
+  }
+  SECTION("producer and consumer threads") {
+    const int count = 100000;
+    std::thread producer([&]() {
+      for (int i = 0; i < count; ++i) {
+        while (!q.try_push(i)) std::this_thread::yield();
+      }
+    });
+    int expected = 0, v;
+    while (expected < count) {
+      if (q.try_pop(v)) {
+        REQUIRE(v == expected++);
+      }
+    }
+    producer.join();
+    REQUIRE_FALSE(q.try_pop(v));
+  }
+}
@@ -61,6 +61,24 @@ Geodetic ecef2geodetic(const ECEF &e) {
   return to_degrees({lat, lon, h});
 }
 
+void geodetic2ecef(const double *geodetic, double *ecef, size_t n) {
+  for (size_t i = 0; i < n; ++i, geodetic += 3, ecef += 3) {
+    ECEF e = geodetic2ecef(Geodetic{geodetic[0], geodetic[1], geodetic[2]});
+    ecef[0] = e.x;
+    ecef[1] = e.y;
+    ecef[2] = e.z;
+  }
+}
+
+void ecef2geodetic(const double *ecef, double *geodetic, size_t n) {
+  for (size_t i = 0; i < n; ++i, ecef += 3, geodetic += 3) {
+    Geodetic g = ecef2geodetic(ECEF{ecef[0], ecef[1], ecef[2]});
+    geodetic[0] = g.lat;
+    geodetic[1] = g.lon;
+    geodetic[2] = g.alt;
+  }
+}
+
 LocalCoord::LocalCoord(const Geodetic &geodetic, const ECEF &e) {
   init_ecef <<  e.x, e.y, e.z;
 
@@ -98,3 +116,35 @@ Geodetic LocalCoord::ned2geodetic(const NED &n) {
   ECEF e = ned2ecef(n);
   return ::ecef2geodetic(e);
 }
+
+void LocalCoord::ecef2ned(const double *ecef, double *ned, size_t n) {
+  for (size_t i = 0; i < n; ++i, ecef += 3, ned += 3) {
+    Eigen::Map<Eigen::Vector3d> out(ned);
+    out = ecef2ned_matrix * (Eigen::Map<const Eigen::Vector3d>(ecef) - init_ecef);
+  }
+}
+
+void LocalCoord::ned2ecef(const double *ned, double *ecef, size_t n) {
+  for (size_t i = 0; i < n; ++i, ned += 3, ecef += 3) {
+    Eigen::Map<Eigen::Vector3d> out(ecef);
+    out = (ned2ecef_matrix * Eigen::Map<const Eigen::Vector3d>(ned)) + init_ecef;
+  }
+}
+
+void LocalCoord::geodetic2ned(const double *geodetic, double *ned, size_t n) {
+  for (size_t i = 0; i < n; ++i, geodetic += 3, ned += 3) {
+    NED nn = geodetic2ned(Geodetic{geodetic[0], geodetic[1], geodetic[2]});
+    ned[0] = nn.n;
+    ned[1] = nn.e;
+    ned[2] = nn.d;
+  }
+}
+
+void LocalCoord::ned2geodetic(const double *ned, double *geodetic, size_t n) {
+  for (size_t i = 0; i < n; ++i, ned += 3, geodetic += 3) {
+    Geodetic g = ned2geodetic(NED{ned[0], ned[1], ned[2]});
+    geodetic[0] = g.lat;
+    geodetic[1] = g.lon;
+    geodetic[2] = g.alt;
+  }
+}
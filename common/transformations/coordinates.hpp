@@ -26,6 +26,9 @@ struct Geodetic {
 
 ECEF geodetic2ecef(const Geodetic &g);
 Geodetic ecef2geodetic(const ECEF &e);
+// batched over n points in contiguous n x 3 arrays, geodetic in degrees
+void geodetic2ecef(const double *geodetic, double *ecef, size_t n);
+void ecef2geodetic(const double *ecef, double *geodetic, size_t n);
 
 class LocalCoord {
 public:
@@ -40,4 +43,10 @@ public:
   ECEF ned2ecef(const NED &n);
   NED geodetic2ned(const Geodetic &g);
   Geodetic ned2geodetic(const NED &n);
+
+  // batched over n points in contiguous n x 3 arrays
+  void ecef2ned(const double *ecef, double *ned, size_t n);
+  void ned2ecef(const double *ned, double *ecef, size_t n);
+  void geodetic2ned(const double *geodetic, double *ned, size_t n);
+  void ned2geodetic(const double *ned, double *geodetic, size_t n);
 };
@@ -63,18 +63,34 @@ Eigen::Matrix3d rot(const Eigen::Vector3d &axis, double angle) {
 }
 
 
-Eigen::Vector3d ecef_euler_from_ned(const ECEF &ecef_init, const Eigen::Vector3d &ned_pose) {
+namespace {
+
+using RowMatrix3d = Eigen::Matrix<double, 3, 3, Eigen::RowMajor>;
+
+// the NED axes at ecef_init, in ECEF
+struct NedAxes {
+  Eigen::Vector3d x, y, z;
+};
+
+NedAxes ned_axes(const ECEF &ecef_init) {
+  LocalCoord converter = LocalCoord(ecef_init);
+  Eigen::Vector3d zero = ecef_init.to_vector();
+  return {
+    converter.ned2ecef({1, 0, 0}).to_vector() - zero,
+    converter.ned2ecef({0, 1, 0}).to_vector() - zero,
+    converter.ned2ecef({0, 0, 1}).to_vector() - zero,
+  };
+}
+
+Eigen::Vector3d ecef_euler_from_ned(const NedAxes &ned, const Eigen::Vector3d &ned_pose) {
   /*
     Using Rotations to Build Aerospace Coordinate Systems
     Don Koks
     https://apps.dtic.mil/dtic/tr/fulltext/u2/a484864.pdf
   */
-  LocalCoord converter = LocalCoord(ecef_init);
-  Eigen::Vector3d zero = ecef_init.to_vector();
-
-  Eigen::Vector3d x0 = converter.ned2ecef({1, 0, 0}).to_vector() - zero;
-  Eigen::Vector3d y0 = converter.ned2ecef({0, 1, 0}).to_vector() - zero;
-  Eigen::Vector3d z0 = converter.ned2ecef({0, 0, 1}).to_vector() - zero;
+  Eigen::Vector3d x0 = ned.x;
+  Eigen::Vector3d y0 = ned.y;
+  Eigen::Vector3d z0 = ned.z;
 
   Eigen::Vector3d x1 = rot(z0, ned_pose(2)) * x0;
   Eigen::Vector3d y1 = rot(z0, ned_pose(2)) * y0;
@@ -103,14 +119,12 @@ Eigen::Vector3d ecef_euler_from_ned(const ECEF &ecef_init, const Eigen::Vector3d
   return {phi, theta, psi};
 }
 
-Eigen::Vector3d ned_euler_from_ecef(const ECEF &ecef_init, const Eigen::Vector3d &ecef_pose) {
+Eigen::Vector3d ned_euler_from_ecef(const NedAxes &ned, const Eigen::Vector3d &ecef_pose) {
   /*
     Using Rotations to Build Aerospace Coordinate Systems
     Don Koks
     https://apps.dtic.mil/dtic/tr/fulltext/u2/a484864.pdf
   */
-  LocalCoord converter = LocalCoord(ecef_init);
-
   Eigen::Vector3d x0 = Eigen::Vector3d(1, 0, 0);
   Eigen::Vector3d y0 = Eigen::Vector3d(0, 1, 0);
   Eigen::Vector3d z0 = Eigen::Vector3d(0, 0, 1);
@@ -126,10 +140,9 @@ Eigen::Vector3d ned_euler_from_ecef(const ECEF &ecef_init, const Eigen::Vector3d
   Eigen::Vector3d x3 = rot(x2, ecef_pose(0)) * x2;
   Eigen::Vector3d y3 = rot(x2, ecef_pose(0)) * y2;
 
-  Eigen::Vector3d zero = ecef_init.to_vector();
-  x0 = converter.ned2ecef({1, 0, 0}).to_vector() - zero;
-  y0 = converter.ned2ecef({0, 1, 0}).to_vector() - zero;
-  z0 = converter.ned2ecef({0, 0, 1}).to_vector() - zero;
+  x0 = ned.x;
+  y0 = ned.y;
+  z0 = ned.z;
 
   double psi = atan2(x3.dot(y0), x3.dot(x0));
   double theta = atan2(-x3.dot(z0), sqrt(pow(x3.dot(x0), 2) + pow(x3.dot(y0), 2)));
@@ -142,3 +155,79 @@ Eigen::Vector3d ned_euler_from_ecef(const ECEF &ecef_init, const Eigen::Vector3d
   return {phi, theta, psi};
 }
 
+void store(const Eigen::Quaterniond &q, double *out) {
+  out[0] = q.w();
+  out[1] = q.x();
+  out[2] = q.y();
+  out[3] = q.z();
+}
+
+Eigen::Quaterniond load_quat(const double *in) {
+  return Eigen::Quaterniond(in[0], in[1], in[2], in[3]);
+}
+
+}  // namespace
+
+Eigen::Vector3d ecef_euler_from_ned(const ECEF &ecef_init, const Eigen::Vector3d &ned_pose) {
+  return ecef_euler_from_ned(ned_axes(ecef_init), ned_pose);
+}
+
+Eigen::Vector3d ned_euler_from_ecef(const ECEF &ecef_init, const Eigen::Vector3d &ecef_pose) {
+  return ned_euler_from_ecef(ned_axes(ecef_init), ecef_pose);
+}
+
+void euler2quat(const double *euler, double *quat, size_t n) {
+  for (size_t i = 0; i < n; ++i, euler += 3, quat += 4) {
+    store(euler2quat(Eigen::Vector3d(Eigen::Map<const Eigen::Vector3d>(euler))), quat);
+  }
+}
+
+void quat2euler(const double *quat, double *euler, size_t n) {
+  for (size_t i = 0; i < n; ++i, quat += 4, euler += 3) {
+    Eigen::Map<Eigen::Vector3d> out(euler);
+    out = quat2euler(load_quat(quat));
+  }
+}
+
+void quat2rot(const double *quat, double *rot, size_t n) {
+  for (size_t i = 0; i < n; ++i, quat += 4, rot += 9) {
+    Eigen::Map<RowMatrix3d> out(rot);
+    out = quat2rot(load_quat(quat));
+  }
+}
+
+void rot2quat(const double *rot, double *quat, size_t n) {
+  for (size_t i = 0; i < n; ++i, rot += 9, quat += 4) {
+    store(rot2quat(Eigen::Matrix3d(Eigen::Map<const RowMatrix3d>(rot))), quat);
+  }
+}
+
+void euler2rot(const double *euler, double *rot, size_t n) {
+  for (size_t i = 0; i < n; ++i, euler += 3, rot += 9) {
+    Eigen::Map<RowMatrix3d> out(rot);
+    out = euler2rot(Eigen::Vector3d(Eigen::Map<const Eigen::Vector3d>(euler)));
+  }
+}
+
+void rot2euler(const double *rot, double *euler, size_t n) {
+  for (size_t i = 0; i < n; ++i, rot += 9, euler += 3) {
+    Eigen::Map<Eigen::Vector3d> out(euler);
+    out = rot2euler(Eigen::Matrix3d(Eigen::Map<const RowMatrix3d>(rot)));
+  }
+}
+
+void ecef_euler_from_ned(const ECEF &ecef_init, const double *ned_pose, double *ecef_euler, size_t n) {
+  const NedAxes ned = ned_axes(ecef_init);
+  for (size_t i = 0; i < n; ++i, ned_pose += 3, ecef_euler += 3) {
+    Eigen::Map<Eigen::Vector3d> out(ecef_euler);
+    out = ecef_euler_from_ned(ned, Eigen::Map<const Eigen::Vector3d>(ned_pose));
+  }
+}
+
+void ned_euler_from_ecef(const ECEF &ecef_init, const double *ecef_pose, double *ned_euler, size_t n) {
+  const NedAxes ned = ned_axes(ecef_init);
+  for (size_t i = 0; i < n; ++i, ecef_pose += 3, ned_euler += 3) {
+    Eigen::Map<Eigen::Vector3d> out(ned_euler);
+    out = ned_euler_from_ecef(ned, Eigen::Map<const Eigen::Vector3d>(ecef_pose));
+  }
+}
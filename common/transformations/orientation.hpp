@@ -15,3 +15,14 @@ Eigen::Matrix3d rot_matrix(double roll, double pitch, double yaw);
 Eigen::Matrix3d rot(const Eigen::Vector3d &axis, double angle);
 Eigen::Vector3d ecef_euler_from_ned(const ECEF &ecef_init, const Eigen::Vector3d &ned_pose);
 Eigen::Vector3d ned_euler_from_ecef(const ECEF &ecef_init, const Eigen::Vector3d &ecef_pose);
+
+// Batched versions over n points in contiguous row-major arrays: euler angles and poses are n x 3,
+// quaternions n x 4 (w, x, y, z) and rotation matrices n x 3 x 3.
+void euler2quat(const double *euler, double *quat, size_t n);
+void quat2euler(const double *quat, double *euler, size_t n);
+void quat2rot(const double *quat, double *rot, size_t n);
+void rot2quat(const double *rot, double *quat, size_t n);
+void euler2rot(const double *euler, double *rot, size_t n);
+void rot2euler(const double *rot, double *euler, size_t n);
+void ecef_euler_from_ned(const ECEF &ecef_init, const double *ned_pose, double *ecef_euler, size_t n);
+void ned_euler_from_ecef(const ECEF &ecef_init, const double *ecef_pose, double *ned_euler, size_t n);
@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+import argparse
+import time
+
+import numpy as np
+
+import openpilot.common.transformations.coordinates as coord
+import openpilot.common.transformations.orientation as orient
+import openpilot.common.transformations.transformations as tf
+
+
+def timed(f, *args):
+  t = time.perf_counter()
+  f(*args)
+  return time.perf_counter() - t
+
+
+def main():
+  parser = argparse.ArgumentParser(description="Compare the batched transformations with the per point path")
+  parser.add_argument("--points", type=int, default=1_000_000)
+  args = parser.parse_args()
+
+  rng = np.random.default_rng(0)
+  eulers = rng.uniform(-np.pi, np.pi, (args.points, 3))
+  quats = orient.euler2quat(eulers)
+  rots = orient.euler2rot(eulers)
+  geodetic = np.column_stack([rng.uniform(-80, 80, args.points), rng.uniform(-180, 180, args.points), rng.uniform(0, 1000, args.points)])
+  ecef_init = coord.geodetic2ecef(geodetic[0])
+  converter = coord.LocalCoord.from_ecef(ecef_init)
+
+  cases = [
+    ("euler2quat", tf.euler2quat_single, orient.euler2quat, (3,), (4,), eulers),
+    ("quat2euler", tf.quat2euler_single, orient.quat2euler, (4,), (3,), quats),
+    ("quat2rot", tf.quat2rot_single, orient.quat2rot, (4,), (3, 3), quats),
+    ("rot2quat", tf.rot2quat_single, orient.rot2quat, (3, 3), (4,), rots),
+    ("euler2rot", tf.euler2rot_single, orient.euler2rot, (3,), (3, 3), eulers),
+    ("rot2euler", tf.rot2euler_single, orient.rot2euler, (3, 3), (3,), rots),
+    ("ned_euler_from_ecef", lambda e: tf.ned_euler_from_ecef_single(ecef_init, e),
+     lambda e: orient.ned_euler_from_ecef(ecef_init, e), (3,), (3,), eulers),
+    ("geodetic2ecef", tf.geodetic2ecef_single, coord.geodetic2ecef, (3,), (3,), geodetic),
+    ("geodetic2ned", converter.geodetic2ned_single, converter.geodetic2ned, (3,), (3,), geodetic),
+  ]
+  print(f"{args.points} points")
+  for name, single, batched, input_shape, output_shape, inputs in cases:
+    per_point = orient.numpy_wrap(single, input_shape, output_shape)
+    t_single = timed(per_point, inputs)
+    t_batched = timed(batched, inputs)
+    print(f"{name:>20}: per point {t_single * 1e3:8.1f} ms, batched {t_batched * 1e3:7.1f} ms, {t_single / t_batched:5.1f}x")
+
+
+if __name__ == "__main__":
+  main()
@@ -1,6 +1,8 @@
 import numpy as np
+import pytest
 
 import openpilot.common.transformations.coordinates as coord
+import openpilot.common.transformations.transformations as tf
 
 geodetic_positions = np.array([[37.7610403, -122.4778699, 115],
                                  [27.4840915, -68.5867592, 2380],
@@ -102,3 +104,22 @@ class TestNED:
     np.testing.assert_allclose(converter.ned2ecef(ned_offsets_batch),
                                                            ecef_positions_offset_batch,
                                                            rtol=1e-9, atol=1e-7)
+
+  def test_batch_matches_single(self):
+    converter = coord.LocalCoord.from_ecef(ecef_init_batch)
+    for i in range(len(geodetic_positions)):
+      np.testing.assert_array_equal(coord.geodetic2ecef(geodetic_positions)[i], tf.geodetic2ecef_single(geodetic_positions[i]))
+      np.testing.assert_array_equal(coord.ecef2geodetic(ecef_positions)[i], tf.ecef2geodetic_single(ecef_positions[i]))
+      np.testing.assert_array_equal(converter.ecef2ned(ecef_positions)[i], converter.ecef2ned_single(ecef_positions[i]))
+      np.testing.assert_array_equal(converter.ned2ecef(ned_offsets)[i], converter.ned2ecef_single(ned_offsets[i]))
+      np.testing.assert_array_equal(converter.geodetic2ned(geodetic_positions)[i], converter.geodetic2ned_single(geodetic_positions[i]))
+      np.testing.assert_array_equal(converter.ned2geodetic(ned_offsets)[i], converter.ned2geodetic_single(ned_offsets[i]))
+
+  def test_batch_shape_errors(self):
+    converter = coord.LocalCoord.from_ecef(ecef_init_batch)
+    with pytest.raises(ValueError, match="shape"):
+      tf.geodetic2ecef_batch(np.zeros((5, 2)))
+    with pytest.raises(ValueError, match="shape"):
+      tf.ned_euler_from_ecef_batch(ecef_init_batch, np.zeros((5, 4)))
+    with pytest.raises(ValueError, match="shape"):
+      converter.ecef2ned_batch(np.zeros((5, 2)))
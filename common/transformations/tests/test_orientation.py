@@ -1,8 +1,10 @@
 import numpy as np
+import pytest
 
 from openpilot.common.transformations.orientation import euler2quat, quat2euler, euler2rot, rot2euler, \
                                                rot2quat, quat2rot, \
-                                               ned_euler_from_ecef
+                                               ned_euler_from_ecef, ecef_euler_from_ned
+import openpilot.common.transformations.transformations as tf
 
 eulers = np.array([[ 1.46520501,  2.78688383,  2.92780854],
        [ 4.86909526,  3.60618161,  4.30648981],
@@ -59,3 +61,45 @@ class TestOrientation:
       np.testing.assert_allclose(ned_eulers[i], ned_euler_from_ecef(ecef_positions[i], eulers[i]), rtol=1e-7)
       #np.testing.assert_allclose(eulers[i], ecef_euler_from_ned(ecef_positions[i], ned_eulers[i]), rtol=1e-7)
     # np.testing.assert_allclose(ned_eulers, ned_euler_from_ecef(ecef_positions, eulers), rtol=1e-7)
+
+  def test_batch_matches_single(self):
+    rng = np.random.default_rng(0)
+    rand_eulers = rng.uniform(-np.pi, np.pi, (100, 3))
+    rand_quats = euler2quat(rand_eulers)
+    rand_rots = euler2rot(rand_eulers)
+    ecef_init = ecef_positions[0]
+    batches = [
+      (rand_quats, tf.euler2quat_single, rand_eulers),
+      (quat2euler(rand_quats), tf.quat2euler_single, rand_quats),
+      (quat2rot(rand_quats), tf.quat2rot_single, rand_quats),
+      (rot2quat(rand_rots), tf.rot2quat_single, rand_rots),
+      (rand_rots, tf.euler2rot_single, rand_eulers),
+      (rot2euler(rand_rots), tf.rot2euler_single, rand_rots),
+      (ecef_euler_from_ned(ecef_init, rand_eulers), lambda e: tf.ecef_euler_from_ned_single(ecef_init, e), rand_eulers),
+      (ned_euler_from_ecef(ecef_init, rand_eulers), lambda e: tf.ned_euler_from_ecef_single(ecef_init, e), rand_eulers),
+    ]
+    for batch, single, inputs in batches:
+      for i in range(len(inputs)):
+        np.testing.assert_array_equal(batch[i], single(inputs[i]))
+
+  def test_batch_shapes(self):
+    # any leading dimensions, non-contiguous and non-float64 inputs
+    grid = np.stack([eulers, eulers[::-1]])
+    assert euler2quat(grid).shape == (2, 5, 4)
+    assert euler2rot(grid).shape == (2, 5, 3, 3)
+    np.testing.assert_array_equal(euler2quat(grid)[1], euler2quat(eulers[::-1]))
+    np.testing.assert_array_equal(rot2euler(euler2rot(eulers.T.copy().T)), rot2euler(euler2rot(eulers)))
+    np.testing.assert_allclose(quat2euler(quats.astype(np.float32)), quat2euler(quats), rtol=1e-5)
+    assert euler2quat(np.zeros((0, 3))).shape == (0, 4)
+
+    # the bindings take C-contiguous float64 arrays without copying
+    with pytest.raises(ValueError):
+      tf.euler2quat_batch(eulers.T.copy().T)
+
+    # and check the shape even with asserts disabled
+    with pytest.raises(ValueError, match="shape"):
+      tf.euler2quat_batch(np.zeros((5, 4)))
+    with pytest.raises(ValueError, match="shape"):
+      tf.quat2rot_batch(np.zeros((5, 3)))
+    with pytest.raises(ValueError, match="shape"):
+      tf.rot2euler_batch(np.zeros((5, 3, 4)))
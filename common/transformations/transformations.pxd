@@ -34,6 +34,15 @@ cdef extern from "orientation.hpp":
   Vector3 ecef_euler_from_ned(const ECEF &, const Vector3 &)
   Vector3 ned_euler_from_ecef(const ECEF &, const Vector3 &)
 
+  void euler2quat_batch_c "euler2quat"(const double *, double *, size_t) nogil
+  void quat2euler_batch_c "quat2euler"(const double *, double *, size_t) nogil
+  void quat2rot_batch_c "quat2rot"(const double *, double *, size_t) nogil
+  void rot2quat_batch_c "rot2quat"(const double *, double *, size_t) nogil
+  void euler2rot_batch_c "euler2rot"(const double *, double *, size_t) nogil
+  void rot2euler_batch_c "rot2euler"(const double *, double *, size_t) nogil
+  void ecef_euler_from_ned_batch_c "ecef_euler_from_ned"(const ECEF &, const double *, double *, size_t) nogil
+  void ned_euler_from_ecef_batch_c "ned_euler_from_ecef"(const ECEF &, const double *, double *, size_t) nogil
+
 
 cdef extern from "coordinates.cc":
   cdef struct ECEF:
@@ -54,6 +63,8 @@ cdef extern from "coordinates.cc":
 
   ECEF geodetic2ecef(const Geodetic &)
   Geodetic ecef2geodetic(const ECEF &)
+  void geodetic2ecef_batch_c "geodetic2ecef"(const double *, double *, size_t) nogil
+  void ecef2geodetic_batch_c "ecef2geodetic"(const double *, double *, size_t) nogil
 
   cdef cppclass LocalCoord_c "LocalCoord":
     Matrix3 ned2ecef_matrix
@@ -68,5 +79,10 @@ cdef extern from "coordinates.cc":
     NED geodetic2ned(const Geodetic &)
     Geodetic ned2geodetic(const NED &)
 
+    void ecef2ned_batch_c "ecef2ned"(const double *, double *, size_t) nogil
+    void ned2ecef_batch_c "ned2ecef"(const double *, double *, size_t) nogil
+    void geodetic2ned_batch_c "geodetic2ned"(const double *, double *, size_t) nogil
+    void ned2geodetic_batch_c "ned2geodetic"(const double *, double *, size_t) nogil
+
 cdef extern from "coordinates.hpp":
   pass
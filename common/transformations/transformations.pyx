@@ -15,6 +15,16 @@ from openpilot.common.transformations.transformations cimport ned_euler_from_ece
 from openpilot.common.transformations.transformations cimport geodetic2ecef as geodetic2ecef_c
 from openpilot.common.transformations.transformations cimport ecef2geodetic as ecef2geodetic_c
 from openpilot.common.transformations.transformations cimport LocalCoord_c
+from openpilot.common.transformations.transformations cimport euler2quat_batch_c
+from openpilot.common.transformations.transformations cimport quat2euler_batch_c
+from openpilot.common.transformations.transformations cimport quat2rot_batch_c
+from openpilot.common.transformations.transformations cimport rot2quat_batch_c
+from openpilot.common.transformations.transformations cimport euler2rot_batch_c
+from openpilot.common.transformations.transformations cimport rot2euler_batch_c
+from openpilot.common.transformations.transformations cimport ecef_euler_from_ned_batch_c
+from openpilot.common.transformations.transformations cimport ned_euler_from_ecef_batch_c
+from openpilot.common.transformations.transformations cimport geodetic2ecef_batch_c
+from openpilot.common.transformations.transformations cimport ecef2geodetic_batch_c
 
 
 import numpy as np
@@ -111,6 +121,97 @@ def ecef2geodetic_single(ecef):
     return [g.lat, g.lon, g.alt]
 
 
+# The batched functions take C-contiguous float64 arrays of n points, n x 3 vectors, n x 4
+# quaternions or n x 3 x 3 rotations, and convert them without copies or the GIL.
+
+cdef check_shape(str name, tuple shape, tuple expected):
+    # not an assert, they're compiled out with -O and the kernels would read past the end of the array
+    if shape != expected:
+        raise ValueError(f"{name} must have shape (n, {', '.join(map(str, expected))}), got (n, {', '.join(map(str, shape))})")
+
+def euler2quat_batch(const double[:, ::1] euler not None):
+    check_shape("euler", (euler.shape[1],), (3,))
+    cdef double[:, ::1] quat = np.empty((euler.shape[0], 4))
+    if euler.shape[0] > 0:
+        with nogil:
+            euler2quat_batch_c(&euler[0, 0], &quat[0, 0], euler.shape[0])
+    return quat.base
+
+def quat2euler_batch(const double[:, ::1] quat not None):
+    check_shape("quat", (quat.shape[1],), (4,))
+    cdef double[:, ::1] euler = np.empty((quat.shape[0], 3))
+    if quat.shape[0] > 0:
+        with nogil:
+            quat2euler_batch_c(&quat[0, 0], &euler[0, 0], quat.shape[0])
+    return euler.base
+
+def quat2rot_batch(const double[:, ::1] quat not None):
+    check_shape("quat", (quat.shape[1],), (4,))
+    cdef double[:, :, ::1] rot = np.empty((quat.shape[0], 3, 3))
+    if quat.shape[0] > 0:
+        with nogil:
+            quat2rot_batch_c(&quat[0, 0], &rot[0, 0, 0], quat.shape[0])
+    return rot.base
+
+def rot2quat_batch(const double[:, :, ::1] rot not None):
+    check_shape("rot", (rot.shape[1], rot.shape[2]), (3, 3))
+    cdef double[:, ::1] quat = np.empty((rot.shape[0], 4))
+    if rot.shape[0] > 0:
+        with nogil:
+            rot2quat_batch_c(&rot[0, 0, 0], &quat[0, 0], rot.shape[0])
+    return quat.base
+
+def euler2rot_batch(const double[:, ::1] euler not None):
+    check_shape("euler", (euler.shape[1],), (3,))
+    cdef double[:, :, ::1] rot = np.empty((euler.shape[0], 3, 3))
+    if euler.shape[0] > 0:
+        with nogil:
+            euler2rot_batch_c(&euler[0, 0], &rot[0, 0, 0], euler.shape[0])
+    return rot.base
+
+def rot2euler_batch(const double[:, :, ::1] rot not None):
+    check_shape("rot", (rot.shape[1], rot.shape[2]), (3, 3))
+    cdef double[:, ::1] euler = np.empty((rot.shape[0], 3))
+    if rot.shape[0] > 0:
+        with nogil:
+            rot2euler_batch_c(&rot[0, 0, 0], &euler[0, 0], rot.shape[0])
+    return euler.base
+
+def ecef_euler_from_ned_batch(ecef_init, const double[:, ::1] ned_pose not None):
+    check_shape("ned_pose", (ned_pose.shape[1],), (3,))
+    cdef ECEF init = list2ecef(ecef_init)
+    cdef double[:, ::1] e = np.empty((ned_pose.shape[0], 3))
+    if ned_pose.shape[0] > 0:
+        with nogil:
+            ecef_euler_from_ned_batch_c(init, &ned_pose[0, 0], &e[0, 0], ned_pose.shape[0])
+    return e.base
+
+def ned_euler_from_ecef_batch(ecef_init, const double[:, ::1] ecef_pose not None):
+    check_shape("ecef_pose", (ecef_pose.shape[1],), (3,))
+    cdef ECEF init = list2ecef(ecef_init)
+    cdef double[:, ::1] e = np.empty((ecef_pose.shape[0], 3))
+    if ecef_pose.shape[0] > 0:
+        with nogil:
+            ned_euler_from_ecef_batch_c(init, &ecef_pose[0, 0], &e[0, 0], ecef_pose.shape[0])
+    return e.base
+
+def geodetic2ecef_batch(const double[:, ::1] geodetic not None):
+    check_shape("geodetic", (geodetic.shape[1],), (3,))
+    cdef double[:, ::1] ecef = np.empty((geodetic.shape[0], 3))
+    if geodetic.shape[0] > 0:
+        with nogil:
+            geodetic2ecef_batch_c(&geodetic[0, 0], &ecef[0, 0], geodetic.shape[0])
+    return ecef.base
+
+def ecef2geodetic_batch(const double[:, ::1] ecef not None):
+    check_shape("ecef", (ecef.shape[1],), (3,))
+    cdef double[:, ::1] geodetic = np.empty((ecef.shape[0], 3))
+    if ecef.shape[0] > 0:
+        with nogil:
+            ecef2geodetic_batch_c(&ecef[0, 0], &geodetic[0, 0], ecef.shape[0])
+    return geodetic.base
+
+
 cdef class LocalCoord:
     cdef LocalCoord_c * lc
 
@@ -169,5 +270,41 @@ cdef class LocalCoord:
         cdef Geodetic g = self.lc.ned2geodetic(n)
         return [g.lat, g.lon, g.alt]
 
+    def ecef2ned_batch(self, const double[:, ::1] ecef not None):
+        assert self.lc
+        check_shape("ecef", (ecef.shape[1],), (3,))
+        cdef double[:, ::1] ned = np.empty((ecef.shape[0], 3))
+        if ecef.shape[0] > 0:
+            with nogil:
+                self.lc.ecef2ned_batch_c(&ecef[0, 0], &ned[0, 0], ecef.shape[0])
+        return ned.base
+
+    def ned2ecef_batch(self, const double[:, ::1] ned not None):
+        assert self.lc
+        check_shape("ned", (ned.shape[1],), (3,))
+        cdef double[:, ::1] ecef = np.empty((ned.shape[0], 3))
+        if ned.shape[0] > 0:
+            with nogil:
+                self.lc.ned2ecef_batch_c(&ned[0, 0], &ecef[0, 0], ned.shape[0])
+        return ecef.base
+
+    def geodetic2ned_batch(self, const double[:, ::1] geodetic not None):
+        assert self.lc
+        check_shape("geodetic", (geodetic.shape[1],), (3,))
+        cdef double[:, ::1] ned = np.empty((geodetic.shape[0], 3))
+        if geodetic.shape[0] > 0:
+            with nogil:
+                self.lc.geodetic2ned_batch_c(&geodetic[0, 0], &ned[0, 0], geodetic.shape[0])
+        return ned.base
+
+    def ned2geodetic_batch(self, const double[:, ::1] ned not None):
+        assert self.lc
+        check_shape("ned", (ned.shape[1],), (3,))
+        cdef double[:, ::1] geodetic = np.empty((ned.shape[0], 3))
+        if ned.shape[0] > 0:
+            with nogil:
+                self.lc.ned2geodetic_batch_c(&ned[0, 0], &geodetic[0, 0], ned.shape[0])
+        return geodetic.base
+
     def __dealloc__(self):
         del self.lc
@@ -90,6 +90,10 @@ class ModelState:
 
   def run(self, buf: VisionBuf, wbuf: VisionBuf, transform: np.ndarray, transform_wide: np.ndarray,
                 inputs: dict[str, np.ndarray], prepare_only: bool) -> dict[str, np.ndarray] | None:
+    # the GPU prepares both frames while the other inputs are updated
+    self.frame.queue(buf, transform.flatten(), self.model.getCLBuffer("input_imgs"))
+    self.wide_frame.queue(wbuf, transform_wide.flatten(), self.model.getCLBuffer("big_input_imgs"))
+
     # Model decides when action is completed, so desire input is just a pulse triggered on rising edge
     inputs['desire'][0] = 0
     new_desire = np.where(inputs['desire'] - self.prev_desire > .99, inputs['desire'], 0)
@@ -102,8 +106,8 @@ class ModelState:
     self.inputs['traffic_convention'][:] = inputs['traffic_convention']
     self.inputs['lateral_control_params'][:] = inputs['lateral_control_params']
 
-    self.model.setInputBuffer("input_imgs", self.frame.prepare(buf, transform.flatten(), self.model.getCLBuffer("input_imgs")))
-    self.model.setInputBuffer("big_input_imgs", self.wide_frame.prepare(wbuf, transform_wide.flatten(), self.model.getCLBuffer("big_input_imgs")))
+    self.model.setInputBuffer("input_imgs", self.frame.wait())
+    self.model.setInputBuffer("big_input_imgs", self.wide_frame.wait())
 
     if prepare_only:
       return None
@@ -3,6 +3,7 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <iterator>
 
 #include "common/clutil.h"
 
@@ -10,9 +11,12 @@ ModelFrame::ModelFrame(cl_device_id device_id, cl_context context) {
   input_frames = std::make_unique<uint8_t[]>(buf_size);
 
   q = CL_CHECK_ERR(clCreateCommandQueue(context, device_id, 0, &err));
-  y_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, MODEL_WIDTH * MODEL_HEIGHT, NULL, &err));
-  u_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, (MODEL_WIDTH / 2) * (MODEL_HEIGHT / 2), NULL, &err));
-  v_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, (MODEL_WIDTH / 2) * (MODEL_HEIGHT / 2), NULL, &err));
+  for (auto &slot : slots) {
+    slot.q = CL_CHECK_ERR(clCreateCommandQueue(context, device_id, 0, &err));
+    slot.y_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, MODEL_WIDTH * MODEL_HEIGHT, NULL, &err));
+    slot.u_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, (MODEL_WIDTH / 2) * (MODEL_HEIGHT / 2), NULL, &err));
+    slot.v_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, (MODEL_WIDTH / 2) * (MODEL_HEIGHT / 2), NULL, &err));
+  }
   img_buffer_20hz_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, 5*frame_size_bytes, NULL, &err));
   region.origin = 4 * frame_size_bytes;
   region.size = frame_size_bytes;
@@ -22,37 +26,68 @@ ModelFrame::ModelFrame(cl_device_id device_id, cl_context context) {
   loadyuv_init(&loadyuv, context, device_id, MODEL_WIDTH, MODEL_HEIGHT);
 }
 
-uint8_t* ModelFrame::prepare(cl_mem yuv_cl, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3 &projection, cl_mem *output) {
-  transform_queue(&this->transform, q,
+void ModelFrame::queue(cl_mem yuv_cl, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3 &projection, cl_mem *output) {
+  Slot &slot = slots[next_slot];
+  next_slot = (next_slot + 1) % std::size(slots);
+
+  // the slot's buffers are free once its last frame is in the history
+  cl_event warped;
+  transform_queue(&this->transform, slot.q,
                 yuv_cl, frame_width, frame_height, frame_stride, frame_uv_offset,
-                y_cl, u_cl, v_cl, MODEL_WIDTH, MODEL_HEIGHT, projection);
+                slot.y_cl, slot.u_cl, slot.v_cl, MODEL_WIDTH, MODEL_HEIGHT, projection,
+                slot.loaded ? 1 : 0, slot.loaded ? &slot.loaded : nullptr, &warped);
+  if (slot.loaded) CL_CHECK(clReleaseEvent(slot.loaded));
 
+  // the history is updated in order of the frames on the main queue
+  CL_CHECK(clEnqueueBarrierWithWaitList(q, 1, &warped, nullptr));
+  CL_CHECK(clReleaseEvent(warped));
   for (int i = 0; i < 4; i++) {
     CL_CHECK(clEnqueueCopyBuffer(q, img_buffer_20hz_cl, img_buffer_20hz_cl, (i+1)*frame_size_bytes, i*frame_size_bytes, frame_size_bytes, 0, nullptr, nullptr));
   }
-  loadyuv_queue(&loadyuv, q, y_cl, u_cl, v_cl, last_img_cl);
-  if (output == NULL) {
-    CL_CHECK(clEnqueueReadBuffer(q, img_buffer_20hz_cl, CL_TRUE, 0, frame_size_bytes, &input_frames[0], 0, nullptr, nullptr));
-    CL_CHECK(clEnqueueReadBuffer(q, last_img_cl, CL_TRUE, 0, frame_size_bytes, &input_frames[MODEL_FRAME_SIZE], 0, nullptr, nullptr));
-    clFinish(q);
-    return &input_frames[0];
+  loadyuv_queue(&loadyuv, q, slot.y_cl, slot.u_cl, slot.v_cl, last_img_cl);
+  CL_CHECK(clEnqueueMarkerWithWaitList(q, 0, nullptr, &slot.loaded));
+
+  has_output = output != NULL;
+  if (!has_output) {
+    CL_CHECK(clEnqueueReadBuffer(q, img_buffer_20hz_cl, CL_FALSE, 0, frame_size_bytes, &input_frames[0], 0, nullptr, nullptr));
+    CL_CHECK(clEnqueueReadBuffer(q, last_img_cl, CL_FALSE, 0, frame_size_bytes, &input_frames[MODEL_FRAME_SIZE], 0, nullptr, nullptr));
   } else {
     copy_queue(&loadyuv, q, img_buffer_20hz_cl, *output, 0, 0, frame_size_bytes);
     copy_queue(&loadyuv, q, last_img_cl, *output, 0, frame_size_bytes, frame_size_bytes);
-
-    // NOTE: Since thneed is using a different command queue, this clFinish is needed to ensure the image is ready.
-    clFinish(q);
-    return NULL;
   }
+  if (ready) CL_CHECK(clReleaseEvent(ready));
+  CL_CHECK(clEnqueueMarkerWithWaitList(q, 0, nullptr, &ready));
+
+  // start now rather than on wait()
+  CL_CHECK(clFlush(slot.q));
+  CL_CHECK(clFlush(q));
+}
+
+uint8_t* ModelFrame::wait() {
+  // NOTE: Since thneed is using a different command queue, this wait is needed to ensure the image is ready.
+  CL_CHECK(clWaitForEvents(1, &ready));
+  return has_output ? NULL : &input_frames[0];
+}
+
+uint8_t* ModelFrame::prepare(cl_mem yuv_cl, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3 &projection, cl_mem *output) {
+  queue(yuv_cl, frame_width, frame_height, frame_stride, frame_uv_offset, projection, output);
+  return wait();
 }
 
 ModelFrame::~ModelFrame() {
+  CL_CHECK(clFinish(q));
+  if (ready) CL_CHECK(clReleaseEvent(ready));
+  for (auto &slot : slots) {
+    CL_CHECK(clFinish(slot.q));
+    if (slot.loaded) CL_CHECK(clReleaseEvent(slot.loaded));
+    CL_CHECK(clReleaseMemObject(slot.v_cl));
+    CL_CHECK(clReleaseMemObject(slot.u_cl));
+    CL_CHECK(clReleaseMemObject(slot.y_cl));
+    CL_CHECK(clReleaseCommandQueue(slot.q));
+  }
   transform_destroy(&transform);
   loadyuv_destroy(&loadyuv);
   CL_CHECK(clReleaseMemObject(img_buffer_20hz_cl));
   CL_CHECK(clReleaseMemObject(last_img_cl));
-  CL_CHECK(clReleaseMemObject(v_cl));
-  CL_CHECK(clReleaseMemObject(u_cl));
-  CL_CHECK(clReleaseMemObject(y_cl));
   CL_CHECK(clReleaseCommandQueue(q));
 }
\ No newline at end of file
@@ -20,6 +20,12 @@ class ModelFrame {
 public:
   ModelFrame(cl_device_id device_id, cl_context context);
   ~ModelFrame();
+  // Enqueue the preparation of a frame without waiting for it, yuv_cl must stay valid until wait().
+  // Frames are warped on the queues of two slots in turn, so the warp of a frame overlaps the
+  // history update and copy out of the previous one on the main queue.
+  void queue(cl_mem yuv_cl, int width, int height, int frame_stride, int frame_uv_offset, const mat3& transform, cl_mem *output);
+  // wait for the last queued frame, returns the input frames if it had no output buffer
+  uint8_t* wait();
   uint8_t* prepare(cl_mem yuv_cl, int width, int height, int frame_stride, int frame_uv_offset, const mat3& transform, cl_mem *output);
 
   const int MODEL_WIDTH = 512;
@@ -29,10 +35,20 @@ public:
   const size_t frame_size_bytes = MODEL_FRAME_SIZE * sizeof(uint8_t);
 
 private:
+  struct Slot {
+    cl_command_queue q;
+    cl_mem y_cl, u_cl, v_cl;
+    cl_event loaded = NULL;  // the last frame warped in the slot is in the history
+  };
+
   Transform transform;
   LoadYUVState loadyuv;
   cl_command_queue q;
-  cl_mem y_cl, u_cl, v_cl, img_buffer_20hz_cl, last_img_cl;
+  Slot slots[2];
+  int next_slot = 0;
+  cl_event ready = NULL;
+  bool has_output = false;
+  cl_mem img_buffer_20hz_cl, last_img_cl;
   cl_buffer_region region;
   std::unique_ptr<uint8_t[]> input_frames;
 };
\ No newline at end of file
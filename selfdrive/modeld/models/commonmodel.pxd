@@ -15,4 +15,6 @@ cdef extern from "selfdrive/modeld/models/commonmodel.h":
   cppclass ModelFrame:
     int buf_size
     ModelFrame(cl_device_id, cl_context)
+    void queue(cl_mem, int, int, int, int, mat3, cl_mem*)
+    unsigned char * wait() nogil
     unsigned char * prepare(cl_mem, int, int, int, int, mat3, cl_mem*)
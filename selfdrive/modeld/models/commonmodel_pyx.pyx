@@ -32,14 +32,22 @@ cdef class ModelFrame:
   def __dealloc__(self):
     del self.frame
 
-  def prepare(self, VisionBuf buf, float[:] projection, CLMem output):
+  def queue(self, VisionBuf buf, float[:] projection, CLMem output):
     cdef mat3 cprojection
     memcpy(cprojection.v, &projection[0], 9*sizeof(float))
-    cdef unsigned char * data
     if output is None:
-      data = self.frame.prepare(buf.buf.buf_cl, buf.width, buf.height, buf.stride, buf.uv_offset, cprojection, NULL)
+      self.frame.queue(buf.buf.buf_cl, buf.width, buf.height, buf.stride, buf.uv_offset, cprojection, NULL)
     else:
-      data = self.frame.prepare(buf.buf.buf_cl, buf.width, buf.height, buf.stride, buf.uv_offset, cprojection, output.mem)
+      self.frame.queue(buf.buf.buf_cl, buf.width, buf.height, buf.stride, buf.uv_offset, cprojection, output.mem)
+
+  def wait(self):
+    cdef unsigned char * data
+    with nogil:
+      data = self.frame.wait()
     if not data:
       return None
     return np.asarray(<cnp.uint8_t[:self.frame.buf_size]> data)
+
+  def prepare(self, VisionBuf buf, float[:] projection, CLMem output):
+    self.queue(buf, projection, output)
+    return self.wait()
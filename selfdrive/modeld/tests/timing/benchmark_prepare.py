@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+# type: ignore
+
+# Time the frame preparation of modeld on recorded frames, waiting for each frame
+# as before (prepare) against queueing the main and wide frames before waiting for them.
+# Runs on the default OpenCL device, e.g. a CPU runtime like pocl on PC.
+
+import os
+import time
+import numpy as np
+
+from msgq.visionipc import VisionIpcServer, VisionIpcClient, VisionStreamType
+from openpilot.common.transformations.camera import DEVICE_CAMERAS
+from openpilot.common.transformations.model import get_warp_matrix
+from openpilot.selfdrive.modeld.models.commonmodel_pyx import ModelFrame, CLContext
+from openpilot.tools.lib.framereader import FrameReader
+from openpilot.tools.lib.openpilotci import get_url
+
+TEST_ROUTE = "2f4452b03ccb98f0|2022-12-03--13-45-30"
+SEGMENT = 6
+N = int(os.getenv("N", "200"))
+
+
+def load_frames(fn):
+  fr = FrameReader(get_url(TEST_ROUTE, SEGMENT, fn), readahead=True)
+  return fr.w, fr.h, [fr.get(i, pix_fmt="nv12")[0].flatten().tobytes() for i in range(N)]
+
+
+if __name__ == "__main__":
+  w, h, road = load_frames("fcamera.hevc")
+  _, _, wide = load_frames("ecamera.hevc")
+
+  server = VisionIpcServer("camerad")
+  server.create_buffers(VisionStreamType.VISION_STREAM_ROAD, 2, w, h)
+  server.create_buffers(VisionStreamType.VISION_STREAM_WIDE_ROAD, 2, w, h)
+  server.start_listener()
+
+  ctx = CLContext()
+  client_main = VisionIpcClient("camerad", VisionStreamType.VISION_STREAM_ROAD, True, ctx)
+  client_extra = VisionIpcClient("camerad", VisionStreamType.VISION_STREAM_WIDE_ROAD, False, ctx)
+  assert client_main.connect(True) and client_extra.connect(True)
+
+  dc = DEVICE_CAMERAS[("tici", "ar0231")]
+  transform_main = get_warp_matrix(np.zeros(3), dc.fcam.intrinsics, False).astype(np.float32).flatten()
+  transform_extra = get_warp_matrix(np.zeros(3), dc.ecam.intrinsics, True).astype(np.float32).flatten()
+
+  def recv(i):
+    server.send(VisionStreamType.VISION_STREAM_ROAD, road[i], i, 0, 0)
+    server.send(VisionStreamType.VISION_STREAM_WIDE_ROAD, wide[i], i, 0, 0)
+    return client_main.recv(), client_extra.recv()
+
+  def run(pipelined):
+    frame, wide_frame = ModelFrame(ctx), ModelFrame(ctx)
+    t = []
+    for i in range(N):
+      buf_main, buf_extra = recv(i)
+      start = time.monotonic()
+      if pipelined:
+        frame.queue(buf_main, transform_main, None)
+        wide_frame.queue(buf_extra, transform_extra, None)
+        out = frame.wait(), wide_frame.wait()
+      else:
+        out = frame.prepare(buf_main, transform_main, None), wide_frame.prepare(buf_extra, transform_extra, None)
+      t.append((time.monotonic() - start) * 1000)
+      assert all(o is not None for o in out)
+    return np.array(t[10:])
+
+  for name, pipelined in (("prepare", False), ("queue/wait", True)):
+    t = run(pipelined)
+    print(f"{name:>10}: avg: {t.mean():0.2f}ms, min: {t.min():0.2f}ms, max: {t.max():0.2f}ms, p99: {np.percentile(t, 99):0.2f}ms")
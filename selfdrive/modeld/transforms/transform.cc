@@ -12,14 +12,9 @@ void transform_init(Transform* s, cl_context ctx, cl_device_id device_id) {
   s->krnl = CL_CHECK_ERR(clCreateKernel(prg, "warpPerspective", &err));
   // done with this
   CL_CHECK(clReleaseProgram(prg));
-
-  s->m_y_cl = CL_CHECK_ERR(clCreateBuffer(ctx, CL_MEM_READ_WRITE, 3*3*sizeof(float), NULL, &err));
-  s->m_uv_cl = CL_CHECK_ERR(clCreateBuffer(ctx, CL_MEM_READ_WRITE, 3*3*sizeof(float), NULL, &err));
 }
 
 void transform_destroy(Transform* s) {
-  CL_CHECK(clReleaseMemObject(s->m_y_cl));
-  CL_CHECK(clReleaseMemObject(s->m_uv_cl));
   CL_CHECK(clReleaseKernel(s->krnl));
 }
 
@@ -28,19 +23,19 @@ void transform_queue(Transform* s,
                      cl_mem in_yuv, int in_width, int in_height, int in_stride, int in_uv_offset,
                      cl_mem out_y, cl_mem out_u, cl_mem out_v,
                      int out_width, int out_height,
-                     const mat3& projection) {
+                     const mat3& projection,
+                     cl_uint num_wait_events, const cl_event *wait_list, cl_event *done) {
   const int zero = 0;
 
   // sampled using pixel center origin
   // (because that's how fastcv and opencv does it)
 
-  mat3 projection_y = projection;
+  // passed by value, no buffer to upload and wait for
+  cl_float16 projection_y = {}, projection_uv = {};
+  memcpy(projection_y.s, projection.v, sizeof(projection.v));
 
   // in and out uv is half the size of y.
-  mat3 projection_uv = transform_scale_buffer(projection, 0.5);
-
-  CL_CHECK(clEnqueueWriteBuffer(q, s->m_y_cl, CL_TRUE, 0, 3*3*sizeof(float), (void*)projection_y.v, 0, NULL, NULL));
-  CL_CHECK(clEnqueueWriteBuffer(q, s->m_uv_cl, CL_TRUE, 0, 3*3*sizeof(float), (void*)projection_uv.v, 0, NULL, NULL));
+  memcpy(projection_uv.s, transform_scale_buffer(projection, 0.5).v, sizeof(projection.v));
 
   const int in_y_width = in_width;
   const int in_y_height = in_height;
@@ -67,12 +62,12 @@ void transform_queue(Transform* s,
   CL_CHECK(clSetKernelArg(s->krnl, 8, sizeof(cl_int), &zero));  // dst_offset
   CL_CHECK(clSetKernelArg(s->krnl, 9, sizeof(cl_int), &out_y_height));  // dst_rows
   CL_CHECK(clSetKernelArg(s->krnl, 10, sizeof(cl_int), &out_y_width));  // dst_cols
-  CL_CHECK(clSetKernelArg(s->krnl, 11, sizeof(cl_mem), &s->m_y_cl));  // M
+  CL_CHECK(clSetKernelArg(s->krnl, 11, sizeof(cl_float16), &projection_y));  // M
 
   const size_t work_size_y[2] = {(size_t)out_y_width, (size_t)out_y_height};
 
   CL_CHECK(clEnqueueNDRangeKernel(q, s->krnl, 2, NULL,
-                              (const size_t*)&work_size_y, NULL, 0, 0, NULL));
+                              (const size_t*)&work_size_y, NULL, num_wait_events, wait_list, NULL));
 
   const size_t work_size_uv[2] = {(size_t)out_uv_width, (size_t)out_uv_height};
 
@@ -85,13 +80,14 @@ void transform_queue(Transform* s,
   CL_CHECK(clSetKernelArg(s->krnl, 8, sizeof(cl_int), &zero));  // dst_offset
   CL_CHECK(clSetKernelArg(s->krnl, 9, sizeof(cl_int), &out_uv_height));  // dst_rows
   CL_CHECK(clSetKernelArg(s->krnl, 10, sizeof(cl_int), &out_uv_width));  // dst_cols
-  CL_CHECK(clSetKernelArg(s->krnl, 11, sizeof(cl_mem), &s->m_uv_cl));  // M
+  CL_CHECK(clSetKernelArg(s->krnl, 11, sizeof(cl_float16), &projection_uv));  // M
 
   CL_CHECK(clEnqueueNDRangeKernel(q, s->krnl, 2, NULL,
                               (const size_t*)&work_size_uv, NULL, 0, 0, NULL));
   CL_CHECK(clSetKernelArg(s->krnl, 3, sizeof(cl_int), &in_v_offset));  // src_ofset
   CL_CHECK(clSetKernelArg(s->krnl, 6, sizeof(cl_mem), &out_v));  // dst
 
+  // the queue is in order, the last warp is done after the others
   CL_CHECK(clEnqueueNDRangeKernel(q, s->krnl, 2, NULL,
-                              (const size_t*)&work_size_uv, NULL, 0, 0, NULL));
+                              (const size_t*)&work_size_uv, NULL, 0, 0, done));
 }
@@ -9,16 +9,16 @@ __kernel void warpPerspective(__global const uchar * src,
                               int src_row_stride, int src_px_stride, int src_offset, int src_rows, int src_cols,
                               __global uchar * dst,
                               int dst_row_stride, int dst_offset, int dst_rows, int dst_cols,
-                              __constant float * M)
+                              float16 M)
 {
     int dx = get_global_id(0);
     int dy = get_global_id(1);
 
     if (dx < dst_cols && dy < dst_rows)
     {
-        float X0 = M[0] * dx + M[1] * dy + M[2];
-        float Y0 = M[3] * dx + M[4] * dy + M[5];
-        float W = M[6] * dx + M[7] * dy + M[8];
+        float X0 = M.s0 * dx + M.s1 * dy + M.s2;
+        float Y0 = M.s3 * dx + M.s4 * dy + M.s5;
+        float W = M.s6 * dx + M.s7 * dy + M.s8;
         W = W != 0.0f ? INTER_TAB_SIZE / W : 0.0f;
         int X = rint(X0 * W), Y = rint(Y0 * W);
 
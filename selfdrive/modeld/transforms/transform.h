@@ -11,7 +11,6 @@
 
 typedef struct {
   cl_kernel krnl;
-  cl_mem m_y_cl, m_uv_cl;
 } Transform;
 
 void transform_init(Transform* s, cl_context ctx, cl_device_id device_id);
@@ -22,4 +21,5 @@ void transform_queue(Transform* s, cl_command_queue q,
                      cl_mem yuv, int in_width, int in_height, int in_stride, int in_uv_offset,
                      cl_mem out_y, cl_mem out_u, cl_mem out_v,
                      int out_width, int out_height,
-                     const mat3& projection);
+                     const mat3& projection,
+                     cl_uint num_wait_events = 0, const cl_event *wait_list = NULL, cl_event *done = NULL);
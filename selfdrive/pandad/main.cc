@@ -1,18 +1,15 @@
 #include <cassert>
 
 #include "selfdrive/pandad/pandad.h"
+#include "common/realtime.h"
 #include "common/swaglog.h"
-#include "common/util.h"
 #include "system/hardware/hw.h"
 
 int main(int argc, char *argv[]) {
   LOGW("starting pandad");
 
   if (!Hardware::PC()) {
-    int err;
-    err = util::set_realtime_priority(54);
-    assert(err == 0);
-    err = util::set_core_affinity({3});
+    int err = config_realtime_process("pandad");
     assert(err == 0);
   }
 
@@ -0,0 +1,95 @@
+#include "selfdrive/pandad/panda_control.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "common/timing.h"
+#include "common/util.h"
+
+PandaControl::PandaControl(const std::vector<Panda *> &pandas, int health_hz)
+    : pandas_(pandas), snapshots_(std::make_unique<Snapshot[]>(pandas.size())), health_period_ns_(1e9 / health_hz) {
+  thread_ = std::thread(&PandaControl::controlThread, this);
+}
+
+PandaControl::~PandaControl() {
+  {
+    std::lock_guard lk(lock_);
+    exit_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+PandaHealth PandaControl::health(size_t i) const {
+  const Snapshot &s = snapshots_[i];
+  PandaHealth health;
+  while (true) {
+    uint32_t seq0 = s.seq.load(std::memory_order_acquire);
+    if (seq0 & 1) continue;
+    health = s.health;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.seq.load(std::memory_order_relaxed) == seq0) return health;
+  }
+}
+
+void PandaControl::post(Request kind, const Panda *panda, std::function<void()> fn) {
+  {
+    std::lock_guard lk(lock_);
+    auto it = std::find_if(requests_.begin(), requests_.end(), [&](auto &r) { return r.kind == kind && r.panda == panda; });
+    if (it != requests_.end()) {
+      requests_.erase(it);
+    }
+    requests_.push_back({kind, panda, std::move(fn)});
+  }
+  cv_.notify_one();
+}
+
+void PandaControl::controlThread() {
+  util::set_thread_name("pandad_control");
+
+  uint64_t next_poll = nanos_since_boot();
+  while (true) {
+    std::deque<PendingRequest> requests;
+    {
+      std::unique_lock lk(lock_);
+      const auto timeout = std::chrono::nanoseconds(std::max<int64_t>(next_poll - nanos_since_boot(), 0));
+      cv_.wait_for(lk, timeout, [this] { return exit_ || !requests_.empty(); });
+      if (exit_) break;
+      requests.swap(requests_);
+    }
+
+    for (auto &r : requests) r.fn();
+
+    if (nanos_since_boot() >= next_poll) {
+      for (size_t i = 0; i < pandas_.size(); ++i) {
+        pollHealth(i);
+      }
+      // skip the polls missed while the bus was slow instead of catching up
+      next_poll += health_period_ns_;
+      if (next_poll < nanos_since_boot()) next_poll = nanos_since_boot() + health_period_ns_;
+    }
+  }
+}
+
+void PandaControl::pollHealth(size_t i) {
+  // the firmware has no combined request, every read is a transfer of its own. Other threads
+  // can use the bus in between.
+  PandaHealth health;
+  auto health_opt = pandas_[i]->get_state();
+  health.valid = health_opt.has_value();
+  if (health_opt) health.health = *health_opt;
+  for (uint32_t bus = 0; bus < PANDA_CAN_CNT && health.valid; ++bus) {
+    auto can_health_opt = pandas_[i]->get_can_state(bus);
+    health.valid = can_health_opt.has_value();
+    if (can_health_opt) health.can_health[bus] = *can_health_opt;
+  }
+  health.mono_time = nanos_since_boot();
+
+  Snapshot &s = snapshots_[i];
+  uint32_t seq = s.seq.load(std::memory_order_relaxed);
+  s.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  s.health = health;
+  s.seq.store(seq + 2, std::memory_order_release);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "selfdrive/pandad/panda.h"
+
+struct PandaHealth {
+  bool valid = false;  // false until the first successful read, and after a failed one
+  uint64_t mono_time = 0;
+  health_t health = {};
+  std::array<can_health_t, PANDA_CAN_CNT> can_health = {};
+};
+
+// Runs the control transfers of the pandas on their own thread. Health and CAN health are polled
+// at `health_hz` and shared through a lock-free snapshot, and requests (safety, fan, IR,
+// heartbeat, ...) are queued to the thread. The CAN loop then only shares the bus with one control
+// transfer at a time, instead of waiting for all of them every 10th frame.
+class PandaControl {
+public:
+  enum class Request { Heartbeat, SafetyModel, PowerSaving, FanSpeed, IrPower, ListPandas, ConfigureSafety, PeripheralState };
+
+  PandaControl(const std::vector<Panda *> &pandas, int health_hz = 10);
+  ~PandaControl();
+  // latest health of panda i, never blocks
+  PandaHealth health(size_t i) const;
+  // health older than three polls means the control thread is stuck on a transfer
+  inline uint64_t maxHealthAgeNs() const { return 3 * health_period_ns_; }
+  // run fn on the control thread, in order of posting. A request still queued is dropped when a newer
+  // one of the same kind and panda is posted, so a slow bus can't make the queue grow.
+  void post(Request kind, const Panda *panda, std::function<void()> fn);
+
+private:
+  void controlThread();
+  void pollHealth(size_t i);
+
+  // seqlock, written only by the control thread
+  struct Snapshot {
+    std::atomic<uint32_t> seq = 0;
+    PandaHealth health;
+  };
+
+  std::vector<Panda *> pandas_;
+  std::unique_ptr<Snapshot[]> snapshots_;
+  const uint64_t health_period_ns_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  struct PendingRequest {
+    Request kind;
+    const Panda *panda;
+    std::function<void()> fn;
+  };
+  std::deque<PendingRequest> requests_;
+  bool exit_ = false;
+  std::thread thread_;
+};
@@ -15,6 +15,7 @@
 #include "common/swaglog.h"
 #include "common/timing.h"
 #include "common/util.h"
+#include "selfdrive/pandad/panda_control.h"
 #include "system/hardware/hw.h"
 
 // -- Multi-panda conventions --
@@ -187,7 +188,7 @@ void fill_panda_can_state(cereal::PandaState::PandaCanState::Builder &cs, const
   cs.setCanCoreResetCnt(can_health.can_core_reset_cnt);
 }
 
-std::optional<bool> send_panda_states(PubMaster *pm, const std::vector<Panda *> &pandas, bool spoofing_started) {
+std::optional<bool> send_panda_states(PubMaster *pm, const std::vector<Panda *> &pandas, PandaControl &control, bool spoofing_started) {
   bool ignition_local = false;
   const uint32_t pandas_cnt = pandas.size();
 
@@ -206,23 +207,20 @@ std::optional<bool> send_panda_states(PubMaster *pm, const std::vector<Panda *>
                                      (pandas[0]->hw_type == cereal::PandaState::PandaType::DOS) &&
                                      (pandas[1]->hw_type == cereal::PandaState::PandaType::RED_PANDA);
 
-  for (const auto& panda : pandas){
-    auto health_opt = panda->get_state();
-    if (!health_opt) {
+  bool stale = false;
+  for (uint32_t i = 0; i < pandas_cnt; i++) {
+    const auto &panda = pandas[i];
+    auto snapshot = control.health(i);
+    if (!snapshot.valid) {
       return std::nullopt;
     }
-
-    health_t health = *health_opt;
-
-    std::array<can_health_t, PANDA_CAN_CNT> can_health{};
-    for (uint32_t i = 0; i < PANDA_CAN_CNT; i++) {
-      auto can_health_opt = panda->get_can_state(i);
-      if (!can_health_opt) {
-        return std::nullopt;
-      }
-      can_health[i] = *can_health_opt;
+    // the control thread is stuck on a transfer, the health is published as invalid and not acted on
+    if (nanos_since_boot() - snapshot.mono_time > control.maxHealthAgeNs()) {
+      stale = true;
     }
-    pandaCanStates.push_back(can_health);
+
+    health_t health = snapshot.health;
+    pandaCanStates.push_back(snapshot.can_health);
 
     if (spoofing_started) {
       health.ignition_line_pkt = 1;
@@ -240,23 +238,28 @@ std::optional<bool> send_panda_states(PubMaster *pm, const std::vector<Panda *>
     pandaStates.push_back(health);
   }
 
+  if (stale) {
+    LOGE("panda health is stale, the control thread is stuck");
+    evt.setValid(false);
+  }
+
   for (uint32_t i = 0; i < pandas_cnt; i++) {
     auto panda = pandas[i];
     const auto &health = pandaStates[i];
 
     // Make sure CAN buses are live: safety_setter_thread does not work if Panda CAN are silent and there is only one other CAN node
-    if (health.safety_mode_pkt == (uint8_t)(cereal::CarParams::SafetyModel::SILENT)) {
-      panda->set_safety_model(cereal::CarParams::SafetyModel::NO_OUTPUT);
+    if (!stale && health.safety_mode_pkt == (uint8_t)(cereal::CarParams::SafetyModel::SILENT)) {
+      control.post(PandaControl::Request::SafetyModel, panda, [=] { panda->set_safety_model(cereal::CarParams::SafetyModel::NO_OUTPUT); });
     }
 
     bool power_save_desired = !ignition_local;
-    if (health.power_save_enabled_pkt != power_save_desired) {
-      panda->set_power_saving(power_save_desired);
+    if (!stale && health.power_save_enabled_pkt != power_save_desired) {
+      control.post(PandaControl::Request::PowerSaving, panda, [=] { panda->set_power_saving(power_save_desired); });
     }
 
     // set safety mode to NO_OUTPUT when car is off. ELM327 is an alternative if we want to leverage athenad/connect
-    if (!ignition_local && (health.safety_mode_pkt != (uint8_t)(cereal::CarParams::SafetyModel::NO_OUTPUT))) {
-      panda->set_safety_model(cereal::CarParams::SafetyModel::NO_OUTPUT);
+    if (!stale && !ignition_local && (health.safety_mode_pkt != (uint8_t)(cereal::CarParams::SafetyModel::NO_OUTPUT))) {
+      control.post(PandaControl::Request::SafetyModel, panda, [=] { panda->set_safety_model(cereal::CarParams::SafetyModel::NO_OUTPUT); });
     }
 
     if (!panda->comms_healthy()) {
@@ -286,6 +289,7 @@ std::optional<bool> send_panda_states(PubMaster *pm, const std::vector<Panda *>
   }
 
   pm->send("pandaStates", msg);
+  if (stale) return std::nullopt;
   return ignition_local;
 }
 
@@ -312,7 +316,7 @@ void send_peripheral_state(Panda *panda, PubMaster *pm) {
   pm->send("peripheralState", msg);
 }
 
-void process_panda_state(std::vector<Panda *> &pandas, PubMaster *pm, bool spoofing_started) {
+void process_panda_state(std::vector<Panda *> &pandas, PubMaster *pm, PandaControl &control, bool spoofing_started) {
   static SubMaster sm({"selfdriveState"});
 
   std::vector<std::string> connected_serials;
@@ -321,7 +325,7 @@ void process_panda_state(std::vector<Panda *> &pandas, PubMaster *pm, bool spoof
   }
 
   {
-    auto ignition_opt = send_panda_states(pm, pandas, spoofing_started);
+    auto ignition_opt = send_panda_states(pm, pandas, control, spoofing_started);
     if (!ignition_opt) {
       LOGE("Failed to get ignition_opt");
       return;
@@ -339,26 +343,28 @@ void process_panda_state(std::vector<Panda *> &pandas, PubMaster *pm, bool spoof
         do_exit = true;
 
       } else {
-        // check for new pandas
-        for (std::string &s : Panda::list(true)) {
-          if (!std::count(connected_serials.begin(), connected_serials.end(), s)) {
-            LOGW("Reconnecting to new panda: %s", s.c_str());
-            do_exit = true;
-            break;
+        // check for new pandas, listing them takes a while
+        control.post(PandaControl::Request::ListPandas, nullptr, [connected_serials]() {
+          for (std::string &s : Panda::list(true)) {
+            if (!std::count(connected_serials.begin(), connected_serials.end(), s)) {
+              LOGW("Reconnecting to new panda: %s", s.c_str());
+              do_exit = true;
+              break;
+            }
           }
-        }
+        });
       }
     }
 
     sm.update(0);
     const bool engaged = sm.allAliveAndValid({"selfdriveState"}) && sm["selfdriveState"].getSelfdriveState().getEnabled();
-    for (const auto &panda : pandas) {
-      panda->send_heartbeat(engaged);
+    for (Panda *panda : pandas) {
+      control.post(PandaControl::Request::Heartbeat, panda, [=] { panda->send_heartbeat(engaged); });
     }
   }
 }
 
-void process_peripheral_state(Panda *panda, PubMaster *pm, bool no_fan_control) {
+void process_peripheral_state(Panda *panda, PandaControl &control, bool no_fan_control) {
   static SubMaster sm({"deviceState", "driverCameraState"});
 
   static uint64_t last_driver_camera_t = 0;
@@ -374,7 +380,7 @@ void process_peripheral_state(Panda *panda, PubMaster *pm, bool no_fan_control)
       // Fan speed
       uint16_t fan_speed = sm["deviceState"].getDeviceState().getFanSpeedPercentDesired();
       if (fan_speed != prev_fan_speed || sm.frame % 100 == 0) {
-        panda->set_fan_speed(fan_speed);
+        control.post(PandaControl::Request::FanSpeed, panda, [=] { panda->set_fan_speed(fan_speed); });
         prev_fan_speed = fan_speed;
       }
     }
@@ -401,7 +407,7 @@ void process_peripheral_state(Panda *panda, PubMaster *pm, bool no_fan_control)
     }
 
     if (ir_pwr != prev_ir_pwr || sm.frame % 100 == 0 || ir_pwr >= 50.0) {
-      panda->set_ir_pwr(ir_pwr);
+      control.post(PandaControl::Request::IrPower, panda, [=, pwr = ir_pwr] { panda->set_ir_pwr(pwr); });
       prev_ir_pwr = ir_pwr;
     }
   }
@@ -416,9 +422,12 @@ void pandad_run(std::vector<Panda *> &pandas) {
   std::thread send_thread(can_send_thread, pandas, fake_send);
 
   RateKeeper rk("pandad", 100);
-  PubMaster pm({"can", "pandaStates", "peripheralState"});
+  PubMaster pm({"can", "pandaStates"});
+  PubMaster peripheral_pm({"peripheralState"});  // used on the control thread
   PandaSafety panda_safety(pandas);
   Panda *peripheral_panda = pandas[0];
+  // owns every control transfer, destroyed first so none runs after this scope
+  PandaControl control(pandas);
 
   // Main loop: receive CAN data and process states
   while (!do_exit && check_all_connected(pandas)) {
@@ -426,18 +435,19 @@ void pandad_run(std::vector<Panda *> &pandas) {
 
     // Process peripheral state at 20 Hz
     if (rk.frame() % 5 == 0) {
-      process_peripheral_state(peripheral_panda, &pm, no_fan_control);
+      process_peripheral_state(peripheral_panda, control, no_fan_control);
     }
 
     // Process panda state at 10 Hz
     if (rk.frame() % 10 == 0) {
-      process_panda_state(pandas, &pm, spoofing_started);
-      panda_safety.configureSafetyMode();
+      process_panda_state(pandas, &pm, control, spoofing_started);
+      // reads params and sets the safety mode
+      control.post(PandaControl::Request::ConfigureSafety, nullptr, [&panda_safety] { panda_safety.configureSafetyMode(); });
     }
 
-    // Send out peripheralState at 2Hz
+    // Send out peripheralState at 2Hz, reading hwmon and the fan speed takes a while
     if (rk.frame() % 50 == 0) {
-      send_peripheral_state(peripheral_panda, &pm);
+      control.post(PandaControl::Request::PeripheralState, peripheral_panda, [=, &peripheral_pm] { send_peripheral_state(peripheral_panda, &peripheral_pm); });
     }
 
     rk.keepTime();
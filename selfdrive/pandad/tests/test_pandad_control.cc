@@ -0,0 +1,200 @@
+#define CATCH_CONFIG_MAIN
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "catch2/catch.hpp"
+#include "common/alloc_tracker.h"
+#include "common/timing.h"
+#include "common/util.h"
+#include "selfdrive/pandad/panda_control.h"
+
+// every transfer takes the bus for a programmable time, as the real handles lock it
+class MockCommsHandle : public PandaCommsHandle {
+public:
+  MockCommsHandle(int control_ms, int bulk_ms) : PandaCommsHandle(""), control_ms(control_ms), bulk_ms(bulk_ms) {}
+  void cleanup() override {}
+
+  int control_write(uint8_t request, uint16_t param1, uint16_t param2, unsigned int timeout) override {
+    transfer(control_ms);
+    std::lock_guard lk(writes_lock);
+    writes.push_back({request, param1});
+    return 0;
+  }
+  int control_read(uint8_t request, uint16_t param1, uint16_t param2, unsigned char *data, uint16_t length, unsigned int timeout) override {
+    transfer(control_ms);
+    if (fail) return -1;
+    memset(data, 0, length);
+    if (request == 0xd2) {
+      ((health_t *)data)->uptime_pkt = ++health_reads;
+    } else if (request == 0xc2) {
+      ((can_health_t *)data)->can_speed = 100 * (param1 + 1);
+    }
+    return length;
+  }
+  int bulk_write(unsigned char endpoint, unsigned char *data, int length, unsigned int timeout) override {
+    transfer(bulk_ms);
+    return length;
+  }
+  int bulk_read(unsigned char endpoint, unsigned char *data, int length, unsigned int timeout) override {
+    transfer(bulk_ms);
+    return 0;
+  }
+
+  void transfer(int ms) {
+    std::lock_guard lk(bus);
+    util::sleep_for(ms);
+  }
+
+  const int control_ms, bulk_ms;
+  std::atomic<bool> fail = false;
+  std::atomic<uint32_t> health_reads = 0;
+  std::mutex bus, writes_lock;
+  std::vector<std::pair<uint8_t, uint16_t>> writes;
+};
+
+struct MockPanda : public Panda {
+  MockPanda(MockCommsHandle *mock) : Panda(std::unique_ptr<PandaCommsHandle>(mock), 0), mock(mock) {}
+  MockCommsHandle *mock;
+};
+
+bool wait_for(std::function<bool()> cond, int timeout_ms = 1000) {
+  for (int i = 0; i < timeout_ms && !cond(); ++i) util::sleep_for(1);
+  return cond();
+}
+
+TEST_CASE("PandaControl health snapshot") {
+  MockPanda panda(new MockCommsHandle(0, 0));
+  PandaControl control({&panda}, 100);
+  REQUIRE(wait_for([&] { return control.health(0).health.uptime_pkt >= 3; }));
+
+  auto health = control.health(0);
+  REQUIRE(health.valid);
+  REQUIRE(health.mono_time > 0);
+  for (uint32_t bus = 0; bus < PANDA_CAN_CNT; ++bus) {
+    REQUIRE(health.can_health[bus].can_speed == 100 * (bus + 1));
+  }
+
+  panda.mock->fail = true;
+  REQUIRE(wait_for([&] { return !control.health(0).valid; }));
+}
+
+TEST_CASE("PandaControl health doesn't allocate") {
+  MockPanda panda(new MockCommsHandle(0, 0));
+  PandaControl control({&panda}, 100);
+  REQUIRE(wait_for([&] { return control.health(0).valid; }));
+
+  // read from the CAN loop every frame
+  bool valid = true;
+  uint64_t violations = 0;
+  {
+    NoAllocScope no_alloc(NoAllocScope::Action::Count);
+    for (int i = 0; i < 1000; ++i) {
+      valid &= control.health(0).valid;
+    }
+    violations = no_alloc.violations();
+  }
+  REQUIRE(valid);
+  REQUIRE(violations == 0);
+}
+
+TEST_CASE("PandaControl runs requests in order") {
+  MockPanda panda(new MockCommsHandle(1, 0));
+  PandaControl control({&panda}, 10);
+  const auto main_thread = std::this_thread::get_id();
+  std::atomic<bool> other_thread = false;
+  control.post(PandaControl::Request::FanSpeed, &panda, [&] {
+    other_thread = std::this_thread::get_id() != main_thread;
+    panda.set_fan_speed(1);
+  });
+  control.post(PandaControl::Request::IrPower, &panda, [&] { panda.set_ir_pwr(2); });
+  control.post(PandaControl::Request::Heartbeat, &panda, [&] { panda.send_heartbeat(true); });
+  REQUIRE(wait_for([&] {
+    std::lock_guard lk(panda.mock->writes_lock);
+    return panda.mock->writes.size() == 3;
+  }));
+  REQUIRE(other_thread);
+  REQUIRE((panda.mock->writes[0] == std::pair<uint8_t, uint16_t>(0xb1, 1)));
+  REQUIRE((panda.mock->writes[1] == std::pair<uint8_t, uint16_t>(0xb0, 2)));
+  REQUIRE((panda.mock->writes[2] == std::pair<uint8_t, uint16_t>(0xf3, 1)));
+}
+
+TEST_CASE("PandaControl coalesces queued requests") {
+  MockPanda panda(new MockCommsHandle(0, 0));
+  PandaControl control({&panda}, 10);
+  // hold the control thread, as a slow transfer would
+  std::atomic<bool> release = false;
+  control.post(PandaControl::Request::ListPandas, nullptr, [&] { while (!release) util::sleep_for(1); });
+  util::sleep_for(10);
+  for (uint16_t speed = 1; speed <= 100; ++speed) {
+    control.post(PandaControl::Request::FanSpeed, &panda, [&, speed] { panda.set_fan_speed(speed); });
+    control.post(PandaControl::Request::IrPower, &panda, [&, speed] { panda.set_ir_pwr(speed); });
+  }
+  release = true;
+
+  REQUIRE(wait_for([&] {
+    std::lock_guard lk(panda.mock->writes_lock);
+    return panda.mock->writes.size() == 2;
+  }));
+  util::sleep_for(50);
+  std::lock_guard lk(panda.mock->writes_lock);
+  REQUIRE(panda.mock->writes.size() == 2);
+  REQUIRE((panda.mock->writes[0] == std::pair<uint8_t, uint16_t>(0xb1, 100)));
+  REQUIRE((panda.mock->writes[1] == std::pair<uint8_t, uint16_t>(0xb0, 100)));
+}
+
+TEST_CASE("PandaControl runs a coalesced request at its newest position") {
+  MockPanda panda(new MockCommsHandle(1, 0));
+  PandaControl control({&panda}, 10);
+  std::atomic<bool> release = false;
+  control.post(PandaControl::Request::ListPandas, nullptr, [&] { while (!release) util::sleep_for(1); });
+  util::sleep_for(10);
+  control.post(PandaControl::Request::FanSpeed, &panda, [&] { panda.set_fan_speed(1); });
+  control.post(PandaControl::Request::IrPower, &panda, [&] { panda.set_ir_pwr(1); });
+  control.post(PandaControl::Request::Heartbeat, &panda, [&] { panda.send_heartbeat(true); });
+  control.post(PandaControl::Request::FanSpeed, &panda, [&] { panda.set_fan_speed(2); });
+  control.post(PandaControl::Request::IrPower, &panda, [&] { panda.set_ir_pwr(2); });
+  release = true;
+
+  REQUIRE(wait_for([&] {
+    std::lock_guard lk(panda.mock->writes_lock);
+    return panda.mock->writes.size() == 3;
+  }));
+  util::sleep_for(50);
+  std::lock_guard lk(panda.mock->writes_lock);
+  REQUIRE(panda.mock->writes.size() == 3);
+  REQUIRE((panda.mock->writes[0] == std::pair<uint8_t, uint16_t>(0xf3, 1)));
+  REQUIRE((panda.mock->writes[1] == std::pair<uint8_t, uint16_t>(0xb1, 2)));
+  REQUIRE((panda.mock->writes[2] == std::pair<uint8_t, uint16_t>(0xb0, 2)));
+}
+
+TEST_CASE("PandaControl health is stale after three polls") {
+  MockPanda panda(new MockCommsHandle(0, 0));
+  REQUIRE(PandaControl({&panda}, 10).maxHealthAgeNs() == 300000000ULL);
+  REQUIRE(PandaControl({&panda}, 20).maxHealthAgeNs() == 150000000ULL);
+}
+
+TEST_CASE("PandaControl doesn't delay CAN receive") {
+  // 3 pandas polled inline would block the CAN loop for 3 * 4 control transfers
+  const int control_ms = 3;
+  std::vector<std::unique_ptr<MockPanda>> mocks;
+  std::vector<Panda *> pandas;
+  for (int i = 0; i < 3; ++i) {
+    mocks.push_back(std::make_unique<MockPanda>(new MockCommsHandle(control_ms, 0)));
+    pandas.push_back(mocks.back().get());
+  }
+  PandaControl control(pandas, 10);
+
+  double max_ms = 0;
+  std::vector<can_frame> frames;
+  for (int frame = 0; frame < 100; ++frame) {
+    double start = millis_since_boot();
+    for (Panda *p : pandas) p->can_receive(frames);
+    max_ms = std::max(max_ms, millis_since_boot() - start);
+    util::sleep_for(10);
+  }
+  INFO("max CAN receive " << max_ms << " ms");
+  REQUIRE(mocks[0]->mock->health_reads >= 5);
+  REQUIRE(max_ms < pandas.size() * PANDA_CAN_CNT * control_ms);
+}
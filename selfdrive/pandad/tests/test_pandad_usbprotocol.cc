@@ -3,6 +3,7 @@
 
 #include "catch2/catch.hpp"
 #include "cereal/messaging/messaging.h"
+#include "common/alloc_tracker.h"
 #include "common/util.h"
 #include "selfdrive/pandad/panda.h"
 
@@ -11,12 +12,14 @@ struct PandaTest : public Panda {
   void test_can_send();
   void test_can_recv(uint32_t chunk_size = 0);
   void test_chunked_can_recv();
+  void test_can_loop(std::vector<can_frame> &frames);
 
   std::map<int, std::string> test_data;
   int can_list_size = 0;
   int total_pakets_size = 0;
   MessageBuilder msg;
   capnp::List<cereal::CanData>::Reader can_data_list;
+  bool unpack_ok = true;
 };
 
 PandaTest::PandaTest(uint32_t bus_offset_, int can_list_size, cereal::PandaState::PandaType hw_type) : can_list_size(can_list_size), Panda(bus_offset_) {
@@ -102,6 +105,15 @@ void PandaTest::test_can_recv(uint32_t rx_chunk_size) {
   }
 }
 
+// one sendcan packed and unpacked again, reusing the frames as the CAN loop does
+void PandaTest::test_can_loop(std::vector<can_frame> &frames) {
+  frames.clear();
+  // no more than two captures, or the std::function allocates
+  this->pack_can_buffer(can_data_list, [this, &frames](uint8_t *data, uint32_t size) {
+    unpack_ok &= this->unpack_can_buffer(data, size, frames);
+  });
+}
+
 TEST_CASE("send/recv CAN 2.0 packets") {
   auto bus_offset = GENERATE(0, 4);
   auto can_list_size = GENERATE(1, 3, 5, 10, 30, 60, 100, 200);
@@ -133,3 +145,23 @@ TEST_CASE("send/recv CAN FD packets") {
     test.test_can_recv(0x40);
   }
 }
+
+TEST_CASE("send/recv CAN 2.0 packets don't allocate") {
+  if (!alloc_tracker::hooked()) return;
+
+  PandaTest test(0, 200, cereal::PandaState::PandaType::DOS);
+  std::vector<can_frame> frames;
+  test.test_can_loop(frames);
+
+  uint64_t violations = 0;
+  {
+    NoAllocScope no_alloc(NoAllocScope::Action::Count);
+    for (int i = 0; i < 100; ++i) {
+      test.test_can_loop(frames);
+    }
+    violations = no_alloc.violations();
+  }
+  REQUIRE(test.unpack_ok);
+  REQUIRE(frames.size() == 200);
+  REQUIRE(violations == 0);
+}
@@ -27,6 +27,11 @@ void AnnotatedCameraWidget::updateState(const UIState &s) {
   dmon.updateState(s);
 }
 
+void AnnotatedCameraWidget::vipcFrameReceived() {
+  // repainted by the UI update, with the messages received up to now
+  uiState()->requestUpdate();
+}
+
 void AnnotatedCameraWidget::initializeGL() {
   CameraWidget::initializeGL();
   qInfo() << "OpenGL version:" << QString((const char*)glGetString(GL_VERSION));
@@ -133,6 +138,9 @@ void AnnotatedCameraWidget::paintGL() {
   dmon.draw(painter, rect());
   hud.updateState(*s);
   hud.draw(painter, rect());
+  if (show_frame_times) {
+    drawFrameTimes(painter);
+  }
 
   double cur_draw_t = millis_since_boot();
   double dt = cur_draw_t - prev_draw_t;
@@ -142,13 +150,33 @@ void AnnotatedCameraWidget::paintGL() {
   }
   prev_draw_t = cur_draw_t;
 
+  s->framePainted(start_draw_t);
+
   // publish debug msg
   MessageBuilder msg;
   auto m = msg.initEvent().initUiDebug();
   m.setDrawTimeMillis(cur_draw_t - start_draw_t);
+  m.setUpdateTimeMillis(s->frame_times.last_update);
+  m.setSwapTimeMillis(s->frame_times.last_swap);
   pm->send("uiDebug", msg);
 }
 
+void AnnotatedCameraWidget::drawFrameTimes(QPainter &p) {
+  const auto &times = uiState()->frame_times;
+  const std::pair<const char *, const FrameTimeHistogram &> rows[] = {
+    {"update", times.update}, {"paint", times.paint}, {"swap", times.swap}};
+
+  QStringList lines;
+  for (const auto &[name, h] : rows) {
+    lines << QString("%1: p50 %2 p90 %3 p99 %4 max %5 ms").arg(name)
+                 .arg(h.percentile(50), 0, 'f', 1).arg(h.percentile(90), 0, 'f', 1)
+                 .arg(h.percentile(99), 0, 'f', 1).arg(h.max(), 0, 'f', 1);
+  }
+  p.setPen(Qt::white);
+  p.setFont(InterFont(36));
+  p.drawText(rect().adjusted(UI_BORDER_SIZE * 2, 0, 0, -UI_BORDER_SIZE * 2), Qt::AlignBottom | Qt::AlignLeft, lines.join("\n"));
+}
+
 void AnnotatedCameraWidget::showEvent(QShowEvent *event) {
   CameraWidget::showEvent(event);
 
@@ -30,8 +30,11 @@ protected:
   void paintGL() override;
   void initializeGL() override;
   void showEvent(QShowEvent *event) override;
+  void vipcFrameReceived() override;
   mat4 calcFrameMatrix() override;
+  void drawFrameTimes(QPainter &p);
 
   double prev_draw_t = 0;
   FirstOrderFilter fps_filter;
+  bool show_frame_times = getenv("SHOW_FRAME_TIMES") != nullptr;
 };
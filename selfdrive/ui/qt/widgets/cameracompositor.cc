@@ -0,0 +1,439 @@
+#include "selfdrive/ui/qt/widgets/cameracompositor.h"
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+#include <QApplication>
+#include <QPainter>
+
+#include "common/timing.h"
+
+// the receive thread polls every connected stream in turn, a frame waits at most this long per other stream
+const int POLL_TIMEOUT_MS = 2;
+
+CameraCompositor::CameraCompositor(std::string stream_name, QWidget *parent) : stream_name(stream_name), QOpenGLWidget(parent) {
+  setAttribute(Qt::WA_OpaquePaintEvent);
+  qRegisterMetaType<std::set<VisionStreamType>>("availableStreams");
+  QObject::connect(this, &CameraCompositor::vipcThreadConnected, this, &CameraCompositor::vipcConnected, Qt::BlockingQueuedConnection);
+  QObject::connect(this, &CameraCompositor::vipcThreadFrameReceived, this, [this]() { update(); }, Qt::QueuedConnection);
+  QObject::connect(QApplication::instance(), &QCoreApplication::aboutToQuit, this, &CameraCompositor::stopVipcThread);
+}
+
+CameraCompositor::~CameraCompositor() {
+  makeCurrent();
+  stopVipcThread();
+  if (isValid()) {
+    glDeleteVertexArrays(1, &frame_vao);
+    glDeleteBuffers(1, &frame_vbo);
+    glDeleteBuffers(1, &frame_ibo);
+    for (auto &[_, s] : streams) {
+      releaseTextures(s);
+    }
+  }
+  doneCurrent();
+}
+
+void CameraCompositor::setTiles(const std::vector<CameraTile> &tiles) {
+  tiles_ = tiles;
+  {
+    std::lock_guard lk(lock);
+    shown_streams.clear();
+    for (const auto &tile : tiles_) {
+      shown_streams.insert(tile.stream);
+      streams[tile.stream];
+    }
+  }
+  update();
+}
+
+CameraStreamStats CameraCompositor::stats(VisionStreamType type) {
+  std::lock_guard lk(lock);
+  auto it = streams.find(type);
+  return it != streams.end() ? it->second.stats : CameraStreamStats{};
+}
+
+std::vector<CameraTile> CameraCompositor::gridLayout(const std::vector<VisionStreamType> &types, int columns) {
+  std::vector<CameraTile> tiles;
+  const int rows = (types.size() + columns - 1) / columns;
+  for (int i = 0; i < types.size(); ++i) {
+    const double w = 1.0 / columns, h = 1.0 / rows;
+    tiles.push_back({types[i], QRectF((i % columns) * w, (i / columns) * h, w, h)});
+  }
+  return tiles;
+}
+
+std::vector<CameraTile> CameraCompositor::pipLayout(VisionStreamType main, VisionStreamType inset, float inset_scale) {
+  const double margin = 0.02;
+  return {{main, QRectF(0, 0, 1, 1)},
+          {inset, QRectF(1 - inset_scale - margin, 1 - inset_scale - margin, inset_scale, inset_scale)}};
+}
+
+void CameraCompositor::initializeGL() {
+  initializeOpenGLFunctions();
+
+  program = std::make_unique<QOpenGLShaderProgram>(context());
+  bool ret = program->addShaderFromSourceCode(QOpenGLShader::Vertex, frame_vertex_shader);
+  assert(ret);
+  ret = program->addShaderFromSourceCode(QOpenGLShader::Fragment, frame_fragment_shader);
+  assert(ret);
+
+  program->link();
+  GLint frame_pos_loc = program->attributeLocation("aPosition");
+  GLint frame_texcoord_loc = program->attributeLocation("aTexCoord");
+
+  // one quad for all tiles, the driver camera is mirrored by its tile matrix
+  const uint8_t frame_indicies[] = {0, 1, 2, 0, 2, 3};
+  const float frame_coords[4][4] = {
+    {-1.0, -1.0, 0.0, 1.0}, // bl
+    {-1.0,  1.0, 0.0, 0.0}, // tl
+    { 1.0,  1.0, 1.0, 0.0}, // tr
+    { 1.0, -1.0, 1.0, 1.0}, // br
+  };
+
+  glGenVertexArrays(1, &frame_vao);
+  glBindVertexArray(frame_vao);
+  glGenBuffers(1, &frame_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, frame_vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(frame_coords), frame_coords, GL_STATIC_DRAW);
+  glEnableVertexAttribArray(frame_pos_loc);
+  glVertexAttribPointer(frame_pos_loc, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(frame_coords[0]), (const void *)0);
+  glEnableVertexAttribArray(frame_texcoord_loc);
+  glVertexAttribPointer(frame_texcoord_loc, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(frame_coords[0]), (const void *)(sizeof(float) * 2));
+  glGenBuffers(1, &frame_ibo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, frame_ibo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(frame_indicies), frame_indicies, GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  glUseProgram(program->programId());
+#ifdef QCOM2
+  glUniform1i(program->uniformLocation("uTexture"), 0);
+#else
+  glUniform1i(program->uniformLocation("uTextureY"), 0);
+  glUniform1i(program->uniformLocation("uTextureUV"), 1);
+#endif
+}
+
+void CameraCompositor::showEvent(QShowEvent *event) {
+  if (!vipc_thread && !pushed_frames) {
+    vipc_thread = new QThread();
+    connect(vipc_thread, &QThread::started, [=]() { vipcThread(); });
+    connect(vipc_thread, &QThread::finished, vipc_thread, &QObject::deleteLater);
+    vipc_thread->start();
+  }
+}
+
+void CameraCompositor::stopVipcThread() {
+  makeCurrent();
+  if (vipc_thread) {
+    vipc_thread->requestInterruption();
+    vipc_thread->quit();
+    vipc_thread->wait();
+    vipc_thread = nullptr;
+  }
+  for (auto &[_, s] : streams) {
+    s.buf = nullptr;
+#ifdef QCOM2
+    EGLDisplay egl_display = eglGetCurrentDisplay();
+    assert(egl_display != EGL_NO_DISPLAY);
+    for (auto &pair : s.egl_images) {
+      eglDestroyImageKHR(egl_display, pair.second);
+      assert(eglGetError() == EGL_SUCCESS);
+    }
+    s.egl_images.clear();
+#endif
+  }
+}
+
+void CameraCompositor::releaseTextures(Stream &s) {
+  glDeleteTextures(2, s.textures);
+  s.textures[0] = s.textures[1] = 0;
+}
+
+mat4 CameraCompositor::calcTileMatrix(const CameraTile &tile, int stream_width, int stream_height) {
+  // Scale the frame to fit the tile while maintaining the aspect ratio.
+  float tile_aspect_ratio = (tile.rect.width() * width()) / (tile.rect.height() * height());
+  float frame_aspect_ratio = (float)stream_width / stream_height;
+  float zx = std::min(frame_aspect_ratio / tile_aspect_ratio, 1.0f) * tile.rect.width();
+  float zy = std::min(tile_aspect_ratio / frame_aspect_ratio, 1.0f) * tile.rect.height();
+  if (tile.stream == VISION_STREAM_DRIVER) zx = -zx;
+
+  // the center of the tile in normalized device coordinates
+  float cx = tile.rect.center().x() * 2.0 - 1.0;
+  float cy = 1.0 - tile.rect.center().y() * 2.0;
+  return mat4{{
+    zx, 0.0, 0.0, cx,
+    0.0, zy, 0.0, cy,
+    0.0, 0.0, 1.0, 0.0,
+    0.0, 0.0, 0.0, 1.0,
+  }};
+}
+
+void CameraCompositor::paintGL() {
+  glClearColor(bg.redF(), bg.greenF(), bg.blueF(), bg.alphaF());
+  glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+
+  glViewport(0, 0, width() * devicePixelRatio(), height() * devicePixelRatio());
+  glBindVertexArray(frame_vao);
+  glUseProgram(program->programId());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glEnableVertexAttribArray(0);
+
+  {
+    std::lock_guard lk(lock);
+    const uint64_t now = nanos_since_boot();
+    for (const auto &tile : tiles_) {
+      Stream &s = streams[tile.stream];
+      if (s.pushed) {
+        s.pushed = false;
+        setupStream(s, s.pushed_buffers);
+      }
+      if (!s.buf) continue;
+
+      // a stream shown in several tiles is uploaded once
+      if (s.fresh) {
+        s.fresh = false;
+        float latency_ms = (now - s.received_time) / 1e6;
+        s.stats.avg_latency_ms += (latency_ms - s.stats.avg_latency_ms) / ++s.stats.drawn;
+        s.stats.max_latency_ms = std::max(s.stats.max_latency_ms, latency_ms);
+#ifndef QCOM2
+        // fallback to copy
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, s.stride);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, s.textures[0]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, s.width, s.height, GL_RED, GL_UNSIGNED_BYTE, s.buf->y);
+        assert(glGetError() == GL_NO_ERROR);
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, s.stride/2);
+        glActiveTexture(GL_TEXTURE0 + 1);
+        glBindTexture(GL_TEXTURE_2D, s.textures[1]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, s.width/2, s.height/2, GL_RG, GL_UNSIGNED_BYTE, s.buf->uv);
+        assert(glGetError() == GL_NO_ERROR);
+#endif
+      }
+
+#ifdef QCOM2
+      // no frame copy
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_EXTERNAL_OES, s.textures[0]);
+      glEGLImageTargetTexture2DOES(GL_TEXTURE_EXTERNAL_OES, s.egl_images[s.buf->idx]);
+      assert(glGetError() == GL_NO_ERROR);
+#else
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, s.textures[0]);
+      glActiveTexture(GL_TEXTURE0 + 1);
+      glBindTexture(GL_TEXTURE_2D, s.textures[1]);
+#endif
+
+      auto frame_mat = calcTileMatrix(tile, s.width, s.height);
+      glUniformMatrix4fv(program->uniformLocation("uTransform"), 1, GL_TRUE, frame_mat.v);
+      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, (const void *)0);
+    }
+  }
+
+  glDisableVertexAttribArray(0);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+  if (show_stats) drawStats();
+}
+
+void CameraCompositor::drawStats() {
+  QPainter p(this);
+  p.setPen(Qt::white);
+  p.setFont(QFont(font().family(), 10));
+  for (const auto &tile : tiles_) {
+    auto s = stats(tile.stream);
+    QRectF r(tile.rect.x() * width(), tile.rect.y() * height(), tile.rect.width() * width(), tile.rect.height() * height());
+    QString text = QString("stream %1: %2 received, %3 dropped, latency %4 / %5 ms")
+                       .arg(tile.stream).arg(s.received).arg(s.dropped)
+                       .arg(s.avg_latency_ms, 0, 'f', 1).arg(s.max_latency_ms, 0, 'f', 1);
+    p.drawText(r.adjusted(5, 5, -5, -5), Qt::AlignTop | Qt::AlignLeft, text);
+  }
+}
+
+void CameraCompositor::vipcConnected(VisionIpcClient *vipc_client) {
+  makeCurrent();
+  std::lock_guard lk(lock);
+  Stream &s = streams[vipc_client->type];
+  s.buf = nullptr;
+  s.fresh = false;
+  std::vector<VisionBuf *> buffers;
+  for (int i = 0; i < vipc_client->num_buffers; i++) {
+    buffers.push_back(&vipc_client->buffers[i]);
+  }
+  setupStream(s, buffers);
+}
+
+void CameraCompositor::setupStream(Stream &s, const std::vector<VisionBuf *> &buffers) {
+  releaseTextures(s);
+#ifdef QCOM2
+  EGLDisplay egl_display = eglGetCurrentDisplay();
+  assert(egl_display != EGL_NO_DISPLAY);
+  for (auto &pair : s.egl_images) {
+    eglDestroyImageKHR(egl_display, pair.second);
+  }
+  s.egl_images.clear();
+#endif
+  if (buffers.empty()) {
+    s.width = s.height = s.stride = 0;
+    return;
+  }
+  s.width = buffers[0]->width;
+  s.height = buffers[0]->height;
+  s.stride = buffers[0]->stride;
+
+#ifdef QCOM2
+  for (auto buf : buffers) {  // import buffers into OpenGL
+    int fd = dup(buf->fd);  // eglDestroyImageKHR will close, so duplicate
+    EGLint img_attrs[] = {
+      EGL_WIDTH, (int)buf->width,
+      EGL_HEIGHT, (int)buf->height,
+      EGL_LINUX_DRM_FOURCC_EXT, DRM_FORMAT_NV12,
+      EGL_DMA_BUF_PLANE0_FD_EXT, fd,
+      EGL_DMA_BUF_PLANE0_OFFSET_EXT, 0,
+      EGL_DMA_BUF_PLANE0_PITCH_EXT, (int)buf->stride,
+      EGL_DMA_BUF_PLANE1_FD_EXT, fd,
+      EGL_DMA_BUF_PLANE1_OFFSET_EXT, (int)buf->uv_offset,
+      EGL_DMA_BUF_PLANE1_PITCH_EXT, (int)buf->stride,
+      EGL_NONE
+    };
+    s.egl_images[buf->idx] = eglCreateImageKHR(egl_display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, 0, img_attrs);
+    assert(eglGetError() == EGL_SUCCESS);
+  }
+  glGenTextures(1, s.textures);
+#else
+  glGenTextures(2, s.textures);
+  const std::pair<GLint, GLenum> formats[] = {{GL_R8, GL_RED}, {GL_RG8, GL_RG}};
+  for (int i = 0; i < 2; ++i) {
+    glBindTexture(GL_TEXTURE_2D, s.textures[i]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, formats[i].first, s.width >> i, s.height >> i, 0, formats[i].second, GL_UNSIGNED_BYTE, nullptr);
+    assert(glGetError() == GL_NO_ERROR);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+#endif
+}
+
+void CameraCompositor::pushBuffers(VisionStreamType type, const std::vector<VisionBuf *> &buffers) {
+  std::set<VisionStreamType> available;
+  {
+    std::lock_guard lk(lock);
+    // the textures are set up in the next paint, with the GL context current
+    Stream &s = streams[type];
+    s.buf = nullptr;
+    s.fresh = false;
+    s.pushed_buffers = buffers;
+    s.pushed = true;
+    for (auto &[t, stream] : streams) {
+      if (!stream.pushed_buffers.empty()) available.insert(t);
+    }
+  }
+  emit vipcAvailableStreamsUpdated(available);
+  emit vipcThreadFrameReceived();
+}
+
+void CameraCompositor::pushFrame(VisionStreamType type, VisionBuf *buf, const VisionIpcBufExtra &meta) {
+  {
+    std::lock_guard lk(lock);
+    // like the vipc thread, only the shown streams are received
+    if (shown_streams.count(type) == 0) return;
+    frameReceived(streams[type], buf, meta, nanos_since_boot());
+  }
+  emit vipcThreadFrameReceived();
+}
+
+void CameraCompositor::frameReceived(Stream &s, VisionBuf *buf, const VisionIpcBufExtra &meta, uint64_t time) {
+  if (s.fresh) s.stats.dropped++;
+  if (s.stats.received > 0 && meta.frame_id > s.frame_id + 1) s.stats.dropped += meta.frame_id - s.frame_id - 1;
+  s.stats.received++;
+  s.buf = buf;
+  s.frame_id = meta.frame_id;
+  s.received_time = time;
+  s.fresh = true;
+}
+
+void CameraCompositor::vipcThread() {
+  std::map<VisionStreamType, std::unique_ptr<VisionIpcClient>> clients;
+  std::map<VisionStreamType, uint64_t> last_frame_time;
+  uint64_t next_connect = 0;
+
+  while (!QThread::currentThread()->isInterruptionRequested()) {
+    std::set<VisionStreamType> shown;
+    {
+      std::lock_guard lk(lock);
+      shown = shown_streams;
+      // the buffers of the streams no longer shown go away with their clients
+      for (auto it = clients.begin(); it != clients.end();) {
+        if (shown.count(it->first) == 0) {
+          streams[it->first].buf = nullptr;
+          it = clients.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    const uint64_t now = nanos_since_boot();
+    bool disconnected = false;
+    for (auto type : shown) {
+      auto &client = clients[type];
+      if (!client) client.reset(new VisionIpcClient(stream_name, type, false));
+      disconnected |= !client->connected;
+    }
+    if (disconnected && now >= next_connect) {
+      next_connect = now + 100 * 1e6;
+      auto available = VisionIpcClient::getAvailableStreams(stream_name, false);
+      if (!available.empty()) {
+        emit vipcAvailableStreamsUpdated(available);
+        for (auto &[type, client] : clients) {
+          if (!client->connected && available.count(type) && client->connect(false)) {
+            last_frame_time[type] = now;
+            emit vipcThreadConnected(client.get());
+          }
+        }
+      }
+    }
+
+    bool received = false;
+    int connected = 0;
+    for (auto &[type, client] : clients) {
+      if (!client->connected) continue;
+      ++connected;
+
+      VisionIpcBufExtra meta = {};
+      VisionBuf *buf = client->recv(&meta, received ? 0 : POLL_TIMEOUT_MS);
+      if (!buf) {
+        if (!isVisible() && nanos_since_boot() - last_frame_time[type] > 1e9) {
+          client->connected = false;
+        }
+        continue;
+      }
+
+      received = true;
+      last_frame_time[type] = nanos_since_boot();
+      std::lock_guard lk(lock);
+      frameReceived(streams[type], buf, meta, last_frame_time[type]);
+    }
+
+    if (received) {
+      emit vipcThreadFrameReceived();
+    } else if (connected == 0) {
+      QThread::msleep(100);
+    }
+  }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLWidget>
+#include <QRectF>
+#include <QThread>
+
+#include "selfdrive/ui/qt/widgets/cameraview.h"
+
+struct CameraTile {
+  VisionStreamType stream;
+  QRectF rect;  // area of the widget, normalized to [0, 1]
+};
+
+struct CameraStreamStats {
+  uint64_t received = 0;
+  uint64_t drawn = 0;
+  uint64_t dropped = 0;  // skipped by the sender, or replaced before being drawn
+  float avg_latency_ms = 0;  // from receive to draw
+  float max_latency_ms = 0;
+};
+
+// Draws any number of camera streams in one GL context. There is one shader program, one quad,
+// one receive thread and one texture set per stream, and all tiles are drawn in the same paint,
+// instead of a CameraWidget with its own context, thread and uploads per stream.
+class CameraCompositor : public QOpenGLWidget, protected QOpenGLFunctions {
+  Q_OBJECT
+
+public:
+  explicit CameraCompositor(std::string stream_name, QWidget *parent = nullptr);
+  ~CameraCompositor();
+  void setTiles(const std::vector<CameraTile> &tiles);
+  const std::vector<CameraTile> &tiles() const { return tiles_; }
+  void setBackgroundColor(const QColor &color) { bg = color; }
+  void setShowStats(bool show) { show_stats = show; }
+  CameraStreamStats stats(VisionStreamType type);
+  void stopVipcThread();
+  // Show frames handed over in the process, e.g. by a replay, instead of receiving them over
+  // VisionIPC. Call before the widget is shown, the vipc thread isn't started then.
+  void usePushedFrames() { pushed_frames = true; }
+  // The buffers of the frames of `type`, empty to release them. Can be called from any thread.
+  void pushBuffers(VisionStreamType type, const std::vector<VisionBuf *> &buffers);
+  // `buf` is one of the pushed buffers. Can be called from any thread.
+  void pushFrame(VisionStreamType type, VisionBuf *buf, const VisionIpcBufExtra &meta);
+
+  static std::vector<CameraTile> gridLayout(const std::vector<VisionStreamType> &types, int columns);
+  // `inset` in the bottom right corner of `main`, scaled by `inset_scale`
+  static std::vector<CameraTile> pipLayout(VisionStreamType main, VisionStreamType inset, float inset_scale = 0.3);
+
+signals:
+  void clicked();
+  void vipcThreadConnected(VisionIpcClient *);
+  void vipcThreadFrameReceived();
+  void vipcAvailableStreamsUpdated(std::set<VisionStreamType>);
+
+protected:
+  void paintGL() override;
+  void initializeGL() override;
+  void showEvent(QShowEvent *event) override;
+  void mouseReleaseEvent(QMouseEvent *event) override { emit clicked(); }
+  mat4 calcTileMatrix(const CameraTile &tile, int stream_width, int stream_height);
+  void drawStats();
+  void vipcThread();
+
+  struct Stream {
+    // shared with the vipc thread
+    VisionBuf *buf = nullptr;
+    uint32_t frame_id = 0;
+    uint64_t received_time = 0;
+    bool fresh = false;  // buf is not uploaded yet
+    CameraStreamStats stats;
+    std::vector<VisionBuf *> pushed_buffers;
+    bool pushed = false;  // pushed_buffers are not set up yet
+
+    int width = 0, height = 0, stride = 0;
+    GLuint textures[2] = {};
+#ifdef QCOM2
+    std::map<int, EGLImageKHR> egl_images;
+#endif
+  };
+  void releaseTextures(Stream &s);
+  void setupStream(Stream &s, const std::vector<VisionBuf *> &buffers);
+  void frameReceived(Stream &s, VisionBuf *buf, const VisionIpcBufExtra &meta, uint64_t time);
+
+  GLuint frame_vao = 0, frame_vbo = 0, frame_ibo = 0;
+  std::unique_ptr<QOpenGLShaderProgram> program;
+  QColor bg = QColor("#000000");
+  bool show_stats = false;
+  bool pushed_frames = false;
+
+  std::string stream_name;
+  std::vector<CameraTile> tiles_;
+  QThread *vipc_thread = nullptr;
+  std::mutex lock;
+  std::set<VisionStreamType> shown_streams;
+  std::map<VisionStreamType, Stream> streams;
+
+protected slots:
+  void vipcConnected(VisionIpcClient *vipc_client);
+};
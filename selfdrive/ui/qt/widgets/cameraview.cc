@@ -9,8 +9,6 @@
 #include <cmath>
 #include <QApplication>
 
-namespace {
-
 const char frame_vertex_shader[] =
 #ifdef __APPLE__
   "#version 330 core\n"
@@ -60,8 +58,6 @@ const char frame_fragment_shader[] =
   "}\n";
 #endif
 
-} // namespace
-
 CameraWidget::CameraWidget(std::string stream_name, VisionStreamType type, QWidget* parent) :
                           stream_name(stream_name), active_stream_type(type), requested_stream_type(type), QOpenGLWidget(parent) {
   setAttribute(Qt::WA_OpaquePaintEvent);
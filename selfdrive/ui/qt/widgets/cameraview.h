@@ -27,6 +27,10 @@
 
 const int FRAME_BUFFER_SIZE = 5;
 
+// shaders drawing a NV12 frame (an EGL image on QCOM2) on a quad transformed by uTransform
+extern const char frame_vertex_shader[];
+extern const char frame_fragment_shader[];
+
 class CameraWidget : public QOpenGLWidget, protected QOpenGLFunctions {
   Q_OBJECT
 
@@ -82,7 +86,7 @@ protected:
 
 protected slots:
   void vipcConnected(VisionIpcClient *vipc_client);
-  void vipcFrameReceived();
+  virtual void vipcFrameReceived();
   void availableStreamsUpdated(std::set<VisionStreamType> streams);
 };
 
@@ -0,0 +1,83 @@
+#include "catch2/catch.hpp"
+
+#include "selfdrive/ui/qt/widgets/cameracompositor.h"
+
+TEST_CASE("UI: CameraCompositor gridLayout") {
+  SECTION("fills the rows, leaving the rest of the last one empty") {
+    auto tiles = CameraCompositor::gridLayout({VISION_STREAM_ROAD, VISION_STREAM_WIDE_ROAD, VISION_STREAM_DRIVER}, 2);
+    REQUIRE(tiles.size() == 3);
+    REQUIRE(tiles[0].stream == VISION_STREAM_ROAD);
+    REQUIRE(tiles[0].rect == QRectF(0, 0, 0.5, 0.5));
+    REQUIRE(tiles[1].stream == VISION_STREAM_WIDE_ROAD);
+    REQUIRE(tiles[1].rect == QRectF(0.5, 0, 0.5, 0.5));
+    REQUIRE(tiles[2].stream == VISION_STREAM_DRIVER);
+    REQUIRE(tiles[2].rect == QRectF(0, 0.5, 0.5, 0.5));
+  }
+  SECTION("one row") {
+    auto tiles = CameraCompositor::gridLayout({VISION_STREAM_ROAD, VISION_STREAM_DRIVER}, 3);
+    REQUIRE(tiles.size() == 2);
+    REQUIRE(tiles[0].rect.height() == 1);
+    REQUIRE(tiles[1].rect.x() == Approx(1.0 / 3));
+    REQUIRE(tiles[1].rect.width() == Approx(1.0 / 3));
+  }
+  SECTION("no streams") {
+    REQUIRE(CameraCompositor::gridLayout({}, 2).empty());
+  }
+}
+
+TEST_CASE("UI: CameraCompositor pipLayout") {
+  auto tiles = CameraCompositor::pipLayout(VISION_STREAM_ROAD, VISION_STREAM_DRIVER, 0.25);
+  REQUIRE(tiles.size() == 2);
+  REQUIRE(tiles[0].stream == VISION_STREAM_ROAD);
+  REQUIRE(tiles[0].rect == QRectF(0, 0, 1, 1));
+
+  // the inset is drawn last, on top of the main stream, in the bottom right corner
+  const QRectF inset = tiles[1].rect;
+  REQUIRE(tiles[1].stream == VISION_STREAM_DRIVER);
+  REQUIRE(inset.width() == Approx(0.25));
+  REQUIRE(inset.height() == Approx(0.25));
+  REQUIRE(tiles[0].rect.contains(inset));
+  REQUIRE(inset.right() > 0.9);
+  REQUIRE(inset.bottom() > 0.9);
+}
+
+TEST_CASE("UI: CameraCompositor dropped frames") {
+  // the widget is never shown, so frames are only received and never drawn
+  CameraCompositor compositor("camerad");
+  compositor.usePushedFrames();
+  compositor.setTiles(CameraCompositor::gridLayout({VISION_STREAM_ROAD}, 1));
+
+  VisionBuf buf = {};
+  auto push = [&](VisionStreamType type, uint32_t frame_id) {
+    VisionIpcBufExtra meta = {};
+    meta.frame_id = frame_id;
+    compositor.pushFrame(type, &buf, meta);
+  };
+
+  push(VISION_STREAM_ROAD, 10);
+  auto stats = compositor.stats(VISION_STREAM_ROAD);
+  REQUIRE(stats.received == 1);
+  REQUIRE(stats.dropped == 0);
+  REQUIRE(stats.drawn == 0);
+
+  SECTION("a frame replaced before it was drawn") {
+    push(VISION_STREAM_ROAD, 11);
+    stats = compositor.stats(VISION_STREAM_ROAD);
+    REQUIRE(stats.received == 2);
+    REQUIRE(stats.dropped == 1);
+  }
+  SECTION("frames skipped by the sender") {
+    push(VISION_STREAM_ROAD, 14);
+    stats = compositor.stats(VISION_STREAM_ROAD);
+    REQUIRE(stats.received == 2);
+    // 11, 12 and 13 never arrived, and 10 was replaced
+    REQUIRE(stats.dropped == 4);
+  }
+  SECTION("frames of a stream that isn't shown") {
+    push(VISION_STREAM_DRIVER, 1);
+    push(VISION_STREAM_DRIVER, 5);
+    REQUIRE(compositor.stats(VISION_STREAM_DRIVER).received == 0);
+    REQUIRE(compositor.stats(VISION_STREAM_DRIVER).dropped == 0);
+    REQUIRE(compositor.stats(VISION_STREAM_ROAD).received == 1);
+  }
+}
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+# Records the frame times of the onroad UI, run under Xvfb:
+#   source selfdrive/test/setup_xvfb.sh && python3 selfdrive/ui/tests/test_ui/frame_times.py
+import argparse
+import json
+import time
+import numpy as np
+
+from msgq.visionipc import VisionIpcServer
+from cereal.messaging import PubMaster, sub_sock, drain_sock
+from openpilot.common.params import Params
+from openpilot.common.prefix import OpenpilotPrefix
+from openpilot.selfdrive.test.helpers import with_processes
+from openpilot.selfdrive.ui.tests.test_ui.run import DATA, STREAMS, load_route_data
+
+WARMUP_FRAMES = 100
+FIELDS = {"update": "updateTimeMillis", "paint": "drawTimeMillis", "swap": "swapTimeMillis"}
+
+
+@with_processes(["ui"])
+def record(duration: float) -> dict[str, list[float]]:
+  pm = PubMaster(list(DATA.keys()))
+  vipc_server = VisionIpcServer("camerad")
+  for stream_type, cam, _ in STREAMS:
+    vipc_server.create_buffers(stream_type, 5, cam.width, cam.height)
+  vipc_server.start_listener()
+
+  uidebug_sock = sub_sock('uiDebug', conflate=False)
+  times: dict[str, list[float]] = {name: [] for name in FIELDS}
+  frame_id = 0
+  start = time.monotonic()
+  while time.monotonic() - start < duration:
+    for service, data in DATA.items():
+      if data:
+        data.clear_write_flag()
+        pm.send(service, data)
+    for stream_type, _, image in STREAMS:
+      vipc_server.send(stream_type, image, frame_id, frame_id, frame_id)
+
+    for msg in drain_sock(uidebug_sock):
+      for name, field in FIELDS.items():
+        times[name].append(getattr(msg.uiDebug, field))
+
+    frame_id += 1
+    time.sleep(0.05)
+  return times
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description="Record update, paint and swap times of the onroad UI")
+  parser.add_argument("--duration", type=float, default=30., help="seconds to record, after a warm up")
+  parser.add_argument("--output", help="write the frame times to this json file")
+  args = parser.parse_args()
+
+  load_route_data()
+  with OpenpilotPrefix():
+    Params().put("DongleId", "123456789012345")
+    times = record(args.duration + 5)
+
+  print(f"{len(times['paint'])} frames")
+  for name, t in times.items():
+    t = np.array(t[WARMUP_FRAMES:])
+    if len(t) == 0:
+      continue
+    hist, edges = np.histogram(t, bins=[0, 1, 2, 5, 10, 16.7, 33.3, 50, np.inf])
+    print(f"{name:>6}: p50 {np.percentile(t, 50):.2f} p90 {np.percentile(t, 90):.2f} "
+          f"p99 {np.percentile(t, 99):.2f} max {t.max():.2f} ms")
+    print("        " + "  ".join(f"<{e:g}: {n}" for e, n in zip(edges[1:], hist, strict=True)))
+
+  if args.output:
+    with open(args.output, "w") as f:
+      json.dump(times, f)
@@ -252,12 +252,7 @@ def create_html_report():
   with open(OUTPUT_FILE, "w") as f:
     f.write(template.render(cases=cases))
 
-def create_screenshots():
-  if TEST_OUTPUT_DIR.exists():
-    shutil.rmtree(TEST_OUTPUT_DIR)
-
-  SCREENSHOTS_DIR.mkdir(parents=True)
-
+def load_route_data():
   route = Route(TEST_ROUTE)
 
   segnum = 2
@@ -280,6 +275,13 @@ def create_screenshots():
   driver_img = FrameReader(route.dcamera_paths()[segnum]).get(0, pix_fmt="nv12")[0]
   STREAMS.append((VisionStreamType.VISION_STREAM_DRIVER, cam.dcam, driver_img.flatten().tobytes()))
 
+def create_screenshots():
+  if TEST_OUTPUT_DIR.exists():
+    shutil.rmtree(TEST_OUTPUT_DIR)
+
+  SCREENSHOTS_DIR.mkdir(parents=True)
+  load_route_data()
+
   t = TestUI()
 
   for name, setup in CASES.items():
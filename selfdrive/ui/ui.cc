@@ -52,7 +52,12 @@ static void update_state(UIState *s) {
   } else if ((s->sm->frame - s->sm->rcv_frame("pandaStates")) > 5*UI_FREQ) {
     scene.pandaType = cereal::PandaState::PandaType::UNKNOWN;
   }
-  if (sm.updated("wideRoadCameraState")) {
+  FrameMeta wide_meta;
+  if (s->wide_frame_meta->latest(&wide_meta) && (nanos_since_boot() - wide_meta.timestamp_eof) < 1e9) {
+    // read straight from camerad's shared metadata, no capnp decoding needed
+    float scale = (wide_meta.sensor == (uint16_t)cereal::FrameData::ImageSensor::AR0231) ? 6.0f : 1.0f;
+    scene.light_sensor = std::max(100.0f - scale * wide_meta.exposure_val_percent, 0.0f);
+  } else if (sm.updated("wideRoadCameraState")) {
     auto cam_state = sm["wideRoadCameraState"].getWideRoadCameraState();
     float scale = (cam_state.getSensor() == cereal::FrameData::ImageSensor::AR0231) ? 6.0f : 1.0f;
     scene.light_sensor = std::max(100.0f - scale * cam_state.getExposureValPercent(), 0.0f);
@@ -95,16 +100,51 @@ UIState::UIState(QObject *parent) : QObject(parent) {
     "pandaStates", "carParams", "driverMonitoringState", "carState", "driverStateV2",
     "wideRoadCameraState", "managerState", "selfdriveState", "longitudinalPlan",
   });
+  wide_frame_meta = std::make_unique<FrameMetaChannel>(VISION_STREAM_WIDE_ROAD, false);
   prime_state = new PrimeState(this);
   language = QString::fromStdString(Params().get("LanguageSetting"));
 
   // update timer
   timer = new QTimer(this);
-  QObject::connect(timer, &QTimer::timeout, this, &UIState::update);
+  QObject::connect(timer, &QTimer::timeout, [this]() {
+    // no frames for a while, don't wait for a swap that isn't coming
+    awaiting_swap = update_pending = false;
+    update();
+  });
   timer->start(1000 / UI_FREQ);
 }
 
+void UIState::setFrameSource(QOpenGLWidget *w) {
+  frame_source = w;
+  QObject::connect(w, &QOpenGLWidget::frameSwapped, this, &UIState::frameSwapped);
+}
+
+void UIState::requestUpdate() {
+  frame_requested = true;
+  if (awaiting_swap) {
+    update_pending = true;
+  } else {
+    update();
+  }
+}
+
+void UIState::framePainted(double paint_start_t) {
+  paint_end_t = millis_since_boot();
+  frame_times.paint.add(paint_end_t - paint_start_t);
+}
+
+void UIState::frameSwapped() {
+  frame_times.last_swap = millis_since_boot() - paint_end_t;
+  frame_times.swap.add(frame_times.last_swap);
+  awaiting_swap = false;
+  if (update_pending) {
+    update_pending = false;
+    update();
+  }
+}
+
 void UIState::update() {
+  const double start_t = millis_since_boot();
   update_sockets(this);
   update_state(this);
   updateStatus();
@@ -113,6 +153,36 @@ void UIState::update() {
     watchdog_kick(nanos_since_boot());
   }
   emit uiUpdate(*this);
+
+  // repaint the frame source with the state of this update, only if its inputs changed
+  const bool paced = frame_source && frame_source->isVisible();
+  if (paced && (frame_requested || sm->updated("modelV2") || sm->updated("carState"))) {
+    frame_source->update();
+    awaiting_swap = true;
+  } else if (!paced) {
+    awaiting_swap = update_pending = false;
+  }
+  frame_requested = false;
+
+  // while frames drive the updates, the timer only runs when they stop
+  timer->start(paced ? 1500 / UI_FREQ : 1000 / UI_FREQ);
+  frame_times.last_update = millis_since_boot() - start_t;
+  frame_times.update.add(frame_times.last_update);
+}
+
+void FrameTimeHistogram::add(double ms) {
+  buckets[std::clamp<int>(ms / BUCKET_MS, 0, buckets.size() - 1)]++;
+  count_++;
+  max_ = std::max(max_, ms);
+}
+
+double FrameTimeHistogram::percentile(double p) const {
+  uint64_t target = std::ceil(count_ * p / 100.0), n = 0;
+  for (int i = 0; i < buckets.size(); ++i) {
+    n += buckets[i];
+    if (n >= target && n > 0) return std::min((i + 1) * BUCKET_MS, max_);
+  }
+  return 0;
 }
 
 Device::Device(QObject *parent) : brightness_filter(BACKLIGHT_OFFROAD, BACKLIGHT_TS, BACKLIGHT_DT), QObject(parent) {
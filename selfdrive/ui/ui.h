@@ -1,17 +1,20 @@
 #pragma once
 
 #include <eigen3/Eigen/Dense>
+#include <array>
 #include <memory>
 #include <string>
 
 #include <QTimer>
 #include <QColor>
 #include <QFuture>
+#include <QOpenGLWidget>
 
 #include "cereal/messaging/messaging.h"
 #include "common/mat.h"
 #include "common/params.h"
 #include "common/util.h"
+#include "system/camerad/cameras/frame_meta.h"
 #include "system/hardware/hw.h"
 #include "selfdrive/ui/qt/prime_state.h"
 
@@ -62,6 +65,28 @@ typedef struct UIScene {
   uint64_t started_frame;
 } UIScene;
 
+// frame times in ms, in buckets of 0.5 ms up to 100 ms
+class FrameTimeHistogram {
+public:
+  void add(double ms);
+  double percentile(double p) const;
+  inline uint64_t count() const { return count_; }
+  inline double max() const { return max_; }
+
+private:
+  static constexpr double BUCKET_MS = 0.5;
+  std::array<uint32_t, 201> buckets = {};  // the last one holds everything longer
+  uint64_t count_ = 0;
+  double max_ = 0;
+};
+
+struct FrameTimes {
+  FrameTimeHistogram update;  // processing the messages and updating the widgets
+  FrameTimeHistogram paint;   // drawing the camera view
+  FrameTimeHistogram swap;    // from the end of the paint to the swap, including the wait for vsync
+  double last_update = 0, last_swap = 0;
+};
+
 class UIState : public QObject {
   Q_OBJECT
 
@@ -71,12 +96,20 @@ public:
   inline bool engaged() const {
     return scene.started && (*sm)["selfdriveState"].getSelfdriveState().getEnabled();
   }
+  // Pace the updates by the frames of `w` while it's visible. A new camera frame requests an
+  // update, which processes the messages right before `w` is repainted, and waits for the
+  // previous frame to be swapped. The timer only updates when no frames arrive.
+  void setFrameSource(QOpenGLWidget *w);
+  void requestUpdate();
+  void framePainted(double paint_start_t);
 
   std::unique_ptr<SubMaster> sm;
+  std::unique_ptr<FrameMetaChannel> wide_frame_meta;
   UIStatus status;
   UIScene scene = {};
   QString language;
   PrimeState *prime_state;
+  FrameTimes frame_times;
 
 signals:
   void uiUpdate(const UIState &s);
@@ -84,10 +117,16 @@ signals:
 
 private slots:
   void update();
+  void frameSwapped();
 
 private:
   QTimer *timer;
   bool started_prev = false;
+  QOpenGLWidget *frame_source = nullptr;
+  bool frame_requested = false;
+  bool awaiting_swap = false;
+  bool update_pending = false;
+  double paint_end_t = 0;
 };
 
 UIState *uiState();
@@ -3,7 +3,7 @@
 
 #include "selfdrive/ui/qt/qt_window.h"
 #include "selfdrive/ui/qt/util.h"
-#include "selfdrive/ui/qt/widgets/cameraview.h"
+#include "selfdrive/ui/qt/widgets/cameracompositor.h"
 
 int main(int argc, char *argv[]) {
   initApp(argc, argv);
@@ -16,18 +16,15 @@ int main(int argc, char *argv[]) {
   layout->setMargin(0);
   layout->setSpacing(0);
 
-  {
-    QHBoxLayout *hlayout = new QHBoxLayout();
-    layout->addLayout(hlayout);
-    hlayout->addWidget(new CameraWidget("camerad", VISION_STREAM_ROAD));
-  }
-
-  {
-    QHBoxLayout *hlayout = new QHBoxLayout();
-    layout->addLayout(hlayout);
-    hlayout->addWidget(new CameraWidget("camerad", VISION_STREAM_DRIVER));
-    hlayout->addWidget(new CameraWidget("camerad", VISION_STREAM_WIDE_ROAD));
-  }
+  // road camera on top, driver and wide road camera below
+  CameraCompositor *cameras = new CameraCompositor("camerad");
+  cameras->setTiles({
+    {VISION_STREAM_ROAD, QRectF(0, 0, 1, 0.5)},
+    {VISION_STREAM_DRIVER, QRectF(0, 0.5, 0.5, 0.5)},
+    {VISION_STREAM_WIDE_ROAD, QRectF(0.5, 0.5, 0.5, 0.5)},
+  });
+  cameras->setShowStats(getenv("SHOW_STATS") != nullptr);
+  layout->addWidget(cameras);
 
   return a.exec();
 }
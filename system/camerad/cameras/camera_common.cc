@@ -115,7 +115,10 @@ bool CameraBuf::acquire(int expo_time) {
   } else {
     cur_yuv_buf = vipc_server->get_buffer(stream_type, cur_buf_idx);
   }
+  return true;
+}
 
+void CameraBuf::send() {
   VisionIpcBufExtra extra = {
     cur_frame_data.frame_id,
     cur_frame_data.timestamp_sof,
@@ -123,8 +126,6 @@ bool CameraBuf::acquire(int expo_time) {
   };
   cur_yuv_buf->set_frame_id(cur_frame_data.frame_id);
   vipc_server->send(cur_yuv_buf, &extra);
-
-  return true;
 }
 
 void CameraBuf::queue(size_t buf_idx) {
@@ -45,6 +45,7 @@ public:
   ~CameraBuf();
   void init(cl_device_id device_id, cl_context context, SpectraCamera *cam, VisionIpcServer * v, int frame_cnt, VisionStreamType type);
   bool acquire(int expo_time);
+  void send();
   void queue(size_t buf_idx);
 };
 
@@ -1,4 +1,5 @@
 #include "system/camerad/cameras/camera_common.h"
+#include "system/camerad/cameras/frame_meta.h"
 #include "system/camerad/cameras/spectra.h"
 
 #include <poll.h>
@@ -227,28 +228,45 @@ void CameraState::run() {
   std::vector<const char*> pubs = {camera.cc.publish_name};
   if (camera.cc.stream_type == VISION_STREAM_ROAD) pubs.push_back("thumbnail");
   PubMaster pm(pubs);
+  FrameMetaChannel meta_channel(camera.cc.stream_type, true);
 
   for (uint32_t cnt = 0; !do_exit; ++cnt) {
     // Acquire the buffer; continue if acquisition fails
     if (!camera.buf.acquire(exposure_time)) continue;
 
-    MessageBuilder msg;
-    auto framed = (msg.initEvent().*camera.cc.init_camera_state)();
+    // Fill the shared metadata before the frame goes out, so VisionIPC consumers can always find it
     const FrameMetadata &meta = camera.buf.cur_frame_data;
-    framed.setFrameId(meta.frame_id);
-    framed.setRequestId(meta.request_id);
-    framed.setTimestampEof(meta.timestamp_eof);
-    framed.setTimestampSof(meta.timestamp_sof);
-    framed.setIntegLines(exposure_time);
-    framed.setGain(analog_gain_frac * get_gain_factor());
-    framed.setHighConversionGain(dc_gain_enabled);
-    framed.setMeasuredGreyFraction(measured_grey_fraction);
-    framed.setTargetGreyFraction(target_grey_fraction);
-    framed.setProcessingTime(meta.processing_time);
-
     const float ev = cur_ev[meta.frame_id % 3];
-    const float perc = util::map_val(ev, camera.sensor->min_ev, camera.sensor->max_ev, 0.0f, 100.0f);
-    framed.setExposureValPercent(perc);
+    const FrameMeta frame_meta = {
+      .frame_id = meta.frame_id,
+      .request_id = meta.request_id,
+      .timestamp_sof = meta.timestamp_sof,
+      .timestamp_eof = meta.timestamp_eof,
+      .processing_time = meta.processing_time,
+      .integ_lines = exposure_time,
+      .gain = analog_gain_frac * get_gain_factor(),
+      .measured_grey_fraction = measured_grey_fraction,
+      .target_grey_fraction = target_grey_fraction,
+      .exposure_val_percent = util::map_val(ev, camera.sensor->min_ev, camera.sensor->max_ev, 0.0f, 100.0f),
+      .sensor = (uint16_t)camera.sensor->image_sensor,
+      .high_conversion_gain = dc_gain_enabled,
+    };
+    meta_channel.write(frame_meta);
+    camera.buf.send();
+
+    MessageBuilder msg;
+    auto framed = (msg.initEvent().*camera.cc.init_camera_state)();
+    framed.setFrameId(frame_meta.frame_id);
+    framed.setRequestId(frame_meta.request_id);
+    framed.setTimestampEof(frame_meta.timestamp_eof);
+    framed.setTimestampSof(frame_meta.timestamp_sof);
+    framed.setIntegLines(frame_meta.integ_lines);
+    framed.setGain(frame_meta.gain);
+    framed.setHighConversionGain(frame_meta.high_conversion_gain);
+    framed.setMeasuredGreyFraction(frame_meta.measured_grey_fraction);
+    framed.setTargetGreyFraction(frame_meta.target_grey_fraction);
+    framed.setProcessingTime(frame_meta.processing_time);
+    framed.setExposureValPercent(frame_meta.exposure_val_percent);
     framed.setSensor(camera.sensor->image_sensor);
 
     // Log raw frames for road camera
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "common/util.h"
+#include "msgq/visionipc/visionipc.h"
+
+// Fixed-layout per-frame metadata shared by camerad through /dev/shm, so VisionIPC
+// consumers can look up exposure and timestamps by frame_id without a SubMaster.
+// camerad keeps publishing the capnp *CameraState messages for logging.
+// The UI is the only reader. encoderd needs nothing beyond VisionIpcBufExtra, and
+// modeld reads roadCameraState from Python, which has no binding for this ring.
+
+const int FRAME_META_SLOTS = 64;
+
+struct FrameMeta {
+  uint32_t frame_id;
+  uint32_t request_id;
+  uint64_t timestamp_sof;
+  uint64_t timestamp_eof;
+  float processing_time;
+  int32_t integ_lines;
+  float gain;
+  float measured_grey_fraction;
+  float target_grey_fraction;
+  float exposure_val_percent;
+  uint16_t sensor;  // cereal::FrameData::ImageSensor
+  bool high_conversion_gain;
+};
+
+class FrameMetaChannel {
+public:
+  FrameMetaChannel(VisionStreamType type, bool writer) : writer_(writer) {
+    std::string prefix = util::getenv("OPENPILOT_PREFIX", "");
+    path_ = "/dev/shm/" + (prefix.empty() ? "" : prefix + "/") + "framemeta_" + std::to_string((int)type);
+    open_shm();
+  }
+
+  ~FrameMetaChannel() {
+    if (shm_) munmap(shm_, sizeof(Shm));
+  }
+
+  // single writer (the camera thread), seqlock per slot
+  void write(const FrameMeta &meta) {
+    if (!shm_) return;
+    Slot &slot = shm_->slots[meta.frame_id % FRAME_META_SLOTS];
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.meta = meta;
+    slot.seq.store(seq + 2, std::memory_order_release);
+    shm_->latest_frame_id.store(meta.frame_id, std::memory_order_release);
+  }
+
+  // returns false if frame_id was never written or has already been overwritten
+  bool read(uint32_t frame_id, FrameMeta *meta) {
+    if (!shm_ && !open_shm()) return false;
+    const Slot &slot = shm_->slots[frame_id % FRAME_META_SLOTS];
+    for (int tries = 0; tries < 4; ++tries) {
+      uint32_t seq0 = slot.seq.load(std::memory_order_acquire);
+      if (seq0 == 0 || (seq0 & 1)) continue;
+      *meta = slot.meta;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) == seq0) {
+        return meta->frame_id == frame_id;
+      }
+    }
+    return false;
+  }
+
+  bool latest(FrameMeta *meta) {
+    if (!shm_ && !open_shm()) return false;
+    return read(shm_->latest_frame_id.load(std::memory_order_acquire), meta);
+  }
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    FrameMeta meta;
+  };
+  struct Shm {
+    std::atomic<uint32_t> latest_frame_id;
+    Slot slots[FRAME_META_SLOTS];
+  };
+  static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+  bool open_shm() {
+    // readers attach lazily, camerad may start after them
+    int flags = writer_ ? (O_RDWR | O_CREAT) : O_RDONLY;
+    unique_fd fd = HANDLE_EINTR(open(path_.c_str(), flags, 0666));
+    if (fd < 0) return false;
+    if (writer_ && ftruncate(fd, sizeof(Shm)) != 0) return false;
+
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Shm)) return false;
+
+    int prot = writer_ ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void *p = mmap(nullptr, sizeof(Shm), prot, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return false;
+    shm_ = (Shm *)p;
+    return true;
+  }
+
+  bool writer_;
+  std::string path_;
+  Shm *shm_ = nullptr;
+};
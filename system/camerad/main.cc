@@ -3,12 +3,10 @@
 #include <cassert>
 
 #include "common/params.h"
-#include "common/util.h"
+#include "common/realtime.h"
 
 int main(int argc, char *argv[]) {
-  int ret = util::set_realtime_priority(53);
-  assert(ret == 0);
-  ret = util::set_core_affinity({6});
+  int ret = config_realtime_process("camerad");
   assert(ret == 0 || Params().getBool("IsOffroad")); // failure ok while offroad due to offlining cores
 
   camerad_thread();
@@ -0,0 +1,70 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "common/prefix.h"
+#include "msgq/visionipc/visionipc_client.h"
+#include "msgq/visionipc/visionipc_server.h"
+#include "system/camerad/cameras/frame_meta.h"
+
+static FrameMeta fake_meta(uint32_t frame_id) {
+  return {
+    .frame_id = frame_id,
+    .request_id = frame_id + 1,
+    .timestamp_sof = frame_id * 50000000ULL,
+    .timestamp_eof = frame_id * 50000000ULL + 1000,
+    .integ_lines = (int32_t)frame_id % 100,
+    .gain = frame_id * 0.5f,
+    .exposure_val_percent = (frame_id % 100) * 1.0f,
+    .high_conversion_gain = frame_id % 2 == 0,
+  };
+}
+
+TEST_CASE("FrameMetaChannel matches VisionIPC frames by frame_id") {
+  OpenpilotPrefix prefix;
+
+  // fake camerad: a VisionIPC server plus the metadata writer
+  VisionIpcServer server("camerad");
+  server.create_buffers(VISION_STREAM_ROAD, 4, 64, 32);
+  server.start_listener();
+  FrameMetaChannel writer(VISION_STREAM_ROAD, true);
+
+  VisionIpcClient client("camerad", VISION_STREAM_ROAD, false);
+  REQUIRE(client.connect(true));
+  FrameMetaChannel reader(VISION_STREAM_ROAD, false);
+
+  for (uint32_t frame_id = 0; frame_id < FRAME_META_SLOTS * 2; ++frame_id) {
+    writer.write(fake_meta(frame_id));
+    VisionBuf *buf = server.get_buffer(VISION_STREAM_ROAD);
+    VisionIpcBufExtra extra = {.frame_id = frame_id};
+    server.send(buf, &extra);
+
+    VisionIpcBufExtra recv_extra = {};
+    REQUIRE(client.recv(&recv_extra, 1000) != nullptr);
+    REQUIRE(recv_extra.frame_id == frame_id);
+
+    FrameMeta meta;
+    REQUIRE(reader.read(recv_extra.frame_id, &meta));
+    REQUIRE(meta.timestamp_eof == fake_meta(frame_id).timestamp_eof);
+    REQUIRE(meta.gain == fake_meta(frame_id).gain);
+    REQUIRE(meta.high_conversion_gain == fake_meta(frame_id).high_conversion_gain);
+  }
+
+  // older frames have been overwritten by the ring
+  FrameMeta meta;
+  REQUIRE_FALSE(reader.read(0, &meta));
+  REQUIRE(reader.latest(&meta));
+  REQUIRE(meta.frame_id == FRAME_META_SLOTS * 2 - 1);
+}
+
+TEST_CASE("FrameMetaChannel reader attaches after the writer starts") {
+  OpenpilotPrefix prefix;
+
+  FrameMetaChannel reader(VISION_STREAM_DRIVER, false);
+  FrameMeta meta;
+  REQUIRE_FALSE(reader.latest(&meta));
+
+  FrameMetaChannel writer(VISION_STREAM_DRIVER, true);
+  writer.write(fake_meta(42));
+  REQUIRE(reader.latest(&meta));
+  REQUIRE(meta.request_id == 43);
+}
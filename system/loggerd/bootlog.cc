@@ -1,11 +1,19 @@
+#include <dirent.h>
+
 #include <cassert>
 #include <string>
 
 #include "cereal/messaging/messaging.h"
 #include "common/params.h"
 #include "common/swaglog.h"
+#include "common/timing.h"
+#include "system/loggerd/journal.h"
 #include "system/loggerd/logger.h"
 
+// the journal is compressed into chunks of about this much input
+const size_t JOURNAL_CHUNK_SIZE = 1024 * 1024;
+// cap on the compressed journal size, override with BOOTLOG_JOURNAL_MAX_BYTES
+const int JOURNAL_MAX_BYTES = 16 * 1024 * 1024;
 
 static kj::Array<capnp::word> build_boot_log() {
   MessageBuilder msg;
@@ -13,23 +21,25 @@ static kj::Array<capnp::word> build_boot_log() {
 
   boot.setWallTimeNanos(nanos_since_epoch());
 
-  std::string pstore = "/sys/fs/pstore";
-  std::map<std::string, std::string> pstore_map = util::read_files_in_dir(pstore);
-
-  int i = 0;
-  auto lpstore = boot.initPstore().initEntries(pstore_map.size());
-  for (auto& kv : pstore_map) {
+  // read pstore entries straight into the message
+  const std::string pstore = "/sys/fs/pstore";
+  std::vector<std::string> pstore_files;
+  if (DIR *d = opendir(pstore.c_str())) {
+    while (struct dirent *de = readdir(d)) {
+      if (de->d_type != DT_DIR) pstore_files.push_back(de->d_name);
+    }
+    closedir(d);
+  }
+  auto lpstore = boot.initPstore().initEntries(pstore_files.size());
+  for (int i = 0; i < pstore_files.size(); i++) {
     auto lentry = lpstore[i];
-    lentry.setKey(kv.first);
-    lentry.setValue(capnp::Data::Reader((const kj::byte*)kv.second.data(), kv.second.size()));
-    i++;
+    lentry.setKey(pstore_files[i]);
+    const std::string value = util::read_file(pstore + "/" + pstore_files[i]);
+    lentry.setValue(capnp::Data::Reader((const kj::byte*)value.data(), value.size()));
   }
 
-  // Gather output of commands
-  std::vector<std::string> bootlog_commands = {
-    "[ -x \"$(command -v journalctl)\" ] && journalctl",
-  };
-
+  // Gather output of commands. the journal is written separately in chunks
+  std::vector<std::string> bootlog_commands;
   if (Hardware::TICI()) {
     bootlog_commands.push_back("[ -e /dev/nvme0 ] && sudo nvme smart-log --output-format=json /dev/nvme0");
   }
@@ -48,6 +58,24 @@ static kj::Array<capnp::word> build_boot_log() {
   return capnp::messageToFlatArray(msg);
 }
 
+static void write_journal(RawFile &file, Params &params) {
+  const size_t max_bytes = util::getenv("BOOTLOG_JOURNAL_MAX_BYTES", JOURNAL_MAX_BYTES);
+  JournalChunkWriter writer([&file](kj::Array<capnp::word> chunk) { file.write(chunk.asBytes()); },
+                            JOURNAL_CHUNK_SIZE, max_bytes);
+
+  // only the entries since the previous bootlog
+  const double start_ts = millis_since_boot();
+  const std::string cursor = journal_read(params.get("BootlogJournalCursor"), [&writer](const JournalEntry &entry) {
+    return writer.add(entry);
+  });
+  writer.finish();
+  params.put("BootlogJournalCursor", cursor);
+
+  LOGW("bootlog journal: %zu entries in %zu chunks, %zu -> %zu bytes%s, took %.1f ms",
+       writer.entries, writer.chunks, writer.uncompressed_bytes, writer.compressed_bytes,
+       writer.truncated ? " (truncated)" : "", millis_since_boot() - start_ts);
+}
+
 int main(int argc, char** argv) {
   const std::string id = logger_get_identifier("BootCount");
   const std::string path = Path::log_root() + "/boot/" + id;
@@ -57,14 +85,22 @@ int main(int argc, char** argv) {
   bool r = util::create_directories(Path::log_root() + "/boot/", 0775);
   assert(r);
 
+  Params params;
   RawFile file(path.c_str());
   // Write initdata
+  double start_ts = millis_since_boot();
   file.write(logger_build_init_data().asBytes());
+  const double init_data_ms = millis_since_boot() - start_ts;
   // Write bootlog
+  start_ts = millis_since_boot();
   file.write(build_boot_log().asBytes());
+  const double boot_log_ms = millis_since_boot() - start_ts;
+  // Write journal chunks
+  write_journal(file, params);
+  LOGW("bootlog timing: init data %.1f ms, boot log %.1f ms", init_data_ms, boot_log_ms);
 
   // Write out bootlog param to match routes with bootlog
-  Params().put("CurrentBootlog", id.c_str());
+  params.put("CurrentBootlog", id.c_str());
 
   return 0;
 }
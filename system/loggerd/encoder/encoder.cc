@@ -1,5 +1,7 @@
 #include "system/loggerd/encoder/encoder.h"
 
+#include <algorithm>
+
 VideoEncoder::VideoEncoder(const EncoderInfo &encoder_info, int in_width, int in_height)
     : encoder_info(encoder_info), in_width(in_width), in_height(in_height) {
 
@@ -12,6 +14,17 @@ VideoEncoder::VideoEncoder(const EncoderInfo &encoder_info, int in_width, int in
     pubs.push_back(encoder_info.thumbnail_name);
   }
   pm.reset(new PubMaster(pubs));
+
+  // ENCODER_INLINE_DATA keeps the packets in the messages, for consumers on another device (e.g. over the bridge)
+  if (encoder_info.packet_ring && getenv("ENCODER_INLINE_DATA") == nullptr) {
+    // enough for several seconds of packets, so a briefly stalled loggerd doesn't lose any
+    size_t capacity = encoder_info.encode_type == cereal::EncodeIndex::Type::BIG_BOX_LOSSLESS
+                        ? (size_t)out_width * out_height * 3 / 2 * encoder_info.fps * 2
+                        : (size_t)encoder_info.bitrate / 8 * 10;
+    capacity = std::max(capacity, PacketRing::DEFAULT_CAPACITY / 8);
+    ring.reset(new PacketRing(packet_ring_name(encoder_info.publish_name), true, capacity));
+    if (!ring->is_open()) ring.reset();
+  }
 }
 
 void VideoEncoder::publisher_publish(VideoEncoder *e, int segment_num, uint32_t idx, VisionIpcBufExtra &extra,
@@ -33,7 +46,11 @@ void VideoEncoder::publisher_publish(VideoEncoder *e, int segment_num, uint32_t
   edata.setSegmentId(idx);
   edata.setFlags(flags);
   edata.setLen(dat.size());
-  edat.setData(dat);
+  if (e->ring && dat.size() <= e->ring->max_packet_size()) {
+    edat.setRingOffset(e->ring->write(dat.begin(), dat.size()));
+  } else {
+    edat.setData(dat);
+  }
   edat.setWidth(out_width);
   edat.setHeight(out_height);
   if (flags & V4L2_BUF_FLAG_KEYFRAME) edat.setHeader(header);
@@ -17,6 +17,7 @@
 #include "cereal/messaging/messaging.h"
 #include "msgq/visionipc/visionipc.h"
 #include "common/queue.h"
+#include "system/loggerd/encoder/packet_ring.h"
 #include "system/loggerd/loggerd.h"
 
 class VideoEncoder {
@@ -40,5 +41,6 @@ private:
   // total frames encoded
   int cnt = 0;
   std::unique_ptr<PubMaster> pm;
+  std::unique_ptr<PacketRing> ring;
   std::vector<capnp::byte> msg_cache;
 };
@@ -0,0 +1,118 @@
+#include "system/loggerd/encoder/packet_ring.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstring>
+
+#include "common/swaglog.h"
+#include "common/util.h"
+
+std::string packet_ring_name(const char *publish_name) {
+  std::string prefix = util::getenv("OPENPILOT_PREFIX", "");
+  return "/dev/shm/" + (prefix.empty() ? "" : prefix + "/") + "encoder_ring_" + publish_name;
+}
+
+PacketRing::PacketRing(const std::string &name, bool writer, size_t capacity)
+    : path(name), writer(writer), capacity(capacity) {
+  if (!open_shm() && writer) {
+    LOGE("failed to create packet ring %s: %s", path.c_str(), strerror(errno));
+  }
+}
+
+PacketRing::~PacketRing() {
+  if (hdr) munmap(hdr, map_size);
+}
+
+bool PacketRing::open_shm() {
+  const size_t size = sizeof(Header) + capacity;
+  unique_fd fd = HANDLE_EINTR(open(path.c_str(), writer ? O_RDWR : O_RDONLY));
+  struct stat st = {};
+  if (fd >= 0 && fstat(fd, &st) != 0) return false;
+
+  if (writer && (fd < 0 || st.st_size != (off_t)size)) {
+    // keep an existing ring (and its offsets) around across encoderd restarts, but one of another
+    // size is replaced instead of truncated, readers that still map it would fault
+    if (fd >= 0 && st.st_size >= (off_t)sizeof(Header)) {
+      if (void *p = mmap(nullptr, sizeof(Header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0); p != MAP_FAILED) {
+        ((Header *)p)->replaced.store(true, std::memory_order_release);
+        munmap(p, sizeof(Header));
+      }
+    }
+    unique_fd new_fd = create_shm(size);
+    return new_fd >= 0 && map_shm(new_fd, size);
+  }
+  if (fd < 0 || (!writer && st.st_size < (off_t)sizeof(Header))) return false;
+  return map_shm(fd, writer ? size : st.st_size);
+}
+
+// a new zeroed ring file, renamed into place so readers never see it half-sized
+int PacketRing::create_shm(size_t size) {
+  std::string tmp = path + ".tmp.XXXXXX";
+  int fd = mkstemp(tmp.data());
+  if (fd < 0) return -1;
+
+  if (fchmod(fd, 0666) != 0 || ftruncate(fd, size) != 0 || rename(tmp.c_str(), path.c_str()) != 0) {
+    unlink(tmp.c_str());
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool PacketRing::map_shm(int fd, size_t size) {
+  void *p = mmap(nullptr, size, writer ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) return false;
+
+  map_size = size;
+  hdr = (Header *)p;
+  data = (uint8_t *)p + sizeof(Header);
+  if (writer) {
+    hdr->capacity = capacity;
+  } else {
+    capacity = hdr->capacity;
+    if (capacity == 0 || map_size < sizeof(Header) + capacity) {
+      munmap(p, map_size);
+      hdr = nullptr;
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t PacketRing::write(const uint8_t *buf, size_t len) {
+  assert(writer && hdr && len <= capacity);
+
+  // packets are kept contiguous, skip the tail of the ring if it doesn't fit
+  uint64_t offset = hdr->write_pos.load(std::memory_order_relaxed);
+  const size_t pos = offset % capacity;
+  if (pos + len > capacity) {
+    offset += capacity - pos;
+  }
+
+  hdr->reserve_pos.store(offset + len, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(data + (offset % capacity), buf, len);
+  hdr->write_pos.store(offset + len, std::memory_order_release);
+  return offset;
+}
+
+const uint8_t *PacketRing::get(uint64_t offset, size_t len) {
+  if (hdr && hdr->replaced.load(std::memory_order_acquire)) {
+    munmap(hdr, map_size);
+    hdr = nullptr;
+  }
+  if (!hdr && !open_shm()) return nullptr;
+  if (len > capacity || (offset % capacity) + len > capacity) return nullptr;
+  if (offset + len > hdr->write_pos.load(std::memory_order_acquire)) return nullptr;
+  if (!valid(offset)) return nullptr;
+  return data + (offset % capacity);
+}
+
+bool PacketRing::valid(uint64_t offset) const {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return hdr && hdr->reserve_pos.load(std::memory_order_relaxed) <= offset + capacity;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Shared memory byte ring that encoderd writes encoded packets into. Only a small
+// index message (ring offset, length, flags, frame id) is published over msgq,
+// consumers read the packet bytes straight out of the ring.
+//
+// Offsets are absolute and only ever grow, so a reader can tell if a packet has
+// been overwritten by comparing it with the writer's reserve position.
+//
+// The file is never resized, readers may have it mapped. A writer that needs another
+// capacity creates a new file in its place and marks the old one replaced, readers
+// then map the new one.
+class PacketRing {
+public:
+  PacketRing(const std::string &name, bool writer, size_t capacity = DEFAULT_CAPACITY);
+  ~PacketRing();
+  bool is_open() const { return hdr != nullptr; }
+
+  // writer: copies the packet in and returns its offset
+  uint64_t write(const uint8_t *data, size_t len);
+
+  // reader: returns nullptr if the packet isn't (or is no longer) in the ring.
+  // since the writer doesn't wait for readers, call valid() after consuming the bytes.
+  const uint8_t *get(uint64_t offset, size_t len);
+  bool valid(uint64_t offset) const;
+
+  size_t max_packet_size() const { return capacity; }
+
+  static constexpr size_t DEFAULT_CAPACITY = 32 * 1024 * 1024;
+
+private:
+  struct Header {
+    std::atomic<uint64_t> reserve_pos;  // end of the packet currently being written
+    std::atomic<uint64_t> write_pos;    // end of the last complete packet
+    uint64_t capacity;
+    std::atomic<bool> replaced;         // a ring of another capacity took this one's place
+  };
+  bool open_shm();
+  int create_shm(size_t size);
+  bool map_shm(int fd, size_t size);
+
+  std::string path;
+  bool writer;
+  size_t capacity;
+  size_t map_size = 0;
+  Header *hdr = nullptr;
+  uint8_t *data = nullptr;
+};
+
+std::string packet_ring_name(const char *publish_name);
@@ -1,5 +1,6 @@
 #include <cassert>
 
+#include "common/realtime.h"
 #include "system/loggerd/loggerd.h"
 
 #ifdef QCOM2
@@ -141,10 +142,7 @@ void encoderd_thread(const LogCameraInfo (&cameras)[N]) {
 
 int main(int argc, char* argv[]) {
   if (!Hardware::PC()) {
-    int ret;
-    ret = util::set_realtime_priority(52);
-    assert(ret == 0);
-    ret = util::set_core_affinity({3});
+    int ret = config_realtime_process("encoderd");
     assert(ret == 0);
   }
   if (argc > 1) {
@@ -0,0 +1,226 @@
+#include "system/loggerd/journal.h"
+
+#include <cassert>
+#include <cstring>
+
+#ifdef __linux__
+#include <systemd/sd-journal.h>
+#endif
+
+#include "common/swaglog.h"
+
+// ***** export format *****
+
+void journal_append_field(std::string &out, const char *field, size_t len) {
+  const char *eq = (const char *)memchr(field, '=', len);
+  if (!eq) return;
+
+  const size_t key_len = eq - field;
+  const char *value = eq + 1;
+  const size_t value_len = len - key_len - 1;
+  bool binary = false;
+  for (size_t i = 0; i < value_len && !binary; ++i) {
+    binary = value[i] == '\n' || ((uint8_t)value[i] < ' ' && value[i] != '\t');
+  }
+
+  if (!binary) {
+    out.append(field, len);
+    out.push_back('\n');
+  } else {
+    // FIELD\n<little endian uint64 size><value>\n
+    out.append(field, key_len);
+    out.push_back('\n');
+    uint64_t size = value_len;
+    for (int i = 0; i < 8; ++i) out.push_back((char)((size >> (i * 8)) & 0xff));
+    out.append(value, value_len);
+    out.push_back('\n');
+  }
+}
+
+bool journal_read_export(FILE *f, const JournalEntryCallback &cb) {
+  JournalEntry entry;
+  char *line = nullptr;
+  size_t cap = 0;
+  ssize_t len;
+  bool ret = true;
+
+  while ((len = getline(&line, &cap, f)) > 0) {
+    if (len == 1 && line[0] == '\n') {
+      // end of entry
+      if (!entry.data.empty()) {
+        entry.data.push_back('\n');
+        if (!cb(entry)) break;
+      }
+      entry = {};
+      continue;
+    }
+
+    entry.data.append(line, len);
+    if (memchr(line, '=', len) != nullptr) {
+      if (strncmp(line, "__CURSOR=", 9) == 0) {
+        entry.cursor.assign(line + 9, len - 10);
+      }
+    } else {
+      // binary field, the size and value follow the name
+      uint8_t size_le[8];
+      if (fread(size_le, 1, sizeof(size_le), f) != sizeof(size_le)) { ret = false; break; }
+      uint64_t size = 0;
+      for (int i = 7; i >= 0; --i) size = (size << 8) | size_le[i];
+      entry.data.append((const char *)size_le, sizeof(size_le));
+
+      const size_t pos = entry.data.size();
+      entry.data.resize(pos + size + 1);
+      if (fread(&entry.data[pos], 1, size + 1, f) != size + 1) { ret = false; break; }
+    }
+  }
+
+  // the last entry might not be followed by an empty line
+  if (ret && !entry.data.empty()) {
+    entry.data.push_back('\n');
+    cb(entry);
+  }
+  free(line);
+  return ret;
+}
+
+// ***** sd-journal *****
+
+#ifdef __linux__
+std::string journal_read(const std::string &after_cursor, const JournalEntryCallback &cb) {
+  sd_journal *j = nullptr;
+  if (int err = sd_journal_open(&j, SD_JOURNAL_LOCAL_ONLY); err < 0) {
+    LOGE("sd_journal_open failed: %s", strerror(-err));
+    return after_cursor;
+  }
+
+  // bound the range to what's in the journal right now
+  std::string tail_cursor = after_cursor;
+  char *cursor = nullptr;
+  if (sd_journal_seek_tail(j) >= 0 && sd_journal_previous(j) > 0 && sd_journal_get_cursor(j, &cursor) >= 0) {
+    tail_cursor = cursor;
+    free(cursor);
+  }
+
+  if (after_cursor.empty() || sd_journal_seek_cursor(j, after_cursor.c_str()) < 0) {
+    sd_journal_seek_head(j);
+  } else if (sd_journal_next(j) > 0 && sd_journal_test_cursor(j, after_cursor.c_str()) <= 0) {
+    // the cursor's entry has been rotated away, we're already on the first new one
+    sd_journal_previous(j);
+  }
+
+  std::string last_cursor = after_cursor;
+  JournalEntry entry;
+  while (sd_journal_next(j) > 0) {
+    entry.data.clear();
+    if (sd_journal_get_cursor(j, &cursor) < 0) continue;
+    entry.cursor = cursor;
+    free(cursor);
+
+    uint64_t realtime = 0, monotonic = 0;
+    sd_id128_t boot_id;
+    sd_journal_get_realtime_usec(j, &realtime);
+    sd_journal_get_monotonic_usec(j, &monotonic, &boot_id);
+    char boot_id_str[SD_ID128_STRING_MAX];
+    entry.data += "__CURSOR=" + entry.cursor + "\n";
+    entry.data += "__REALTIME_TIMESTAMP=" + std::to_string(realtime) + "\n";
+    entry.data += "__MONOTONIC_TIMESTAMP=" + std::to_string(monotonic) + "\n";
+    entry.data += std::string("_BOOT_ID=") + sd_id128_to_string(boot_id, boot_id_str) + "\n";
+
+    const void *field;
+    size_t len;
+    SD_JOURNAL_FOREACH_DATA(j, field, len) {
+      journal_append_field(entry.data, (const char *)field, len);
+    }
+    entry.data.push_back('\n');
+
+    // an entry the callback refused is read again next time
+    if (!cb(entry)) break;
+    last_cursor = entry.cursor;
+    if (entry.cursor == tail_cursor) break;
+  }
+
+  sd_journal_close(j);
+  return last_cursor;
+}
+#else
+std::string journal_read(const std::string &after_cursor, const JournalEntryCallback &cb) {
+  return after_cursor;
+}
+#endif
+
+// ***** JournalChunkWriter *****
+
+JournalChunkWriter::JournalChunkWriter(EmitCallback emit, size_t chunk_size, size_t max_bytes)
+    : emit(emit), chunk_size(chunk_size), max_bytes(max_bytes) {
+  cctx = ZSTD_createCCtx();
+  assert(cctx);
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, 3);
+}
+
+JournalChunkWriter::~JournalChunkWriter() {
+  ZSTD_freeCCtx(cctx);
+}
+
+void JournalChunkWriter::compress(const std::string &data, ZSTD_EndDirective mode) {
+  ZSTD_inBuffer input = {data.data(), data.size(), 0};
+  size_t remaining;
+  do {
+    if (out.capacity() - out.size() < ZSTD_CStreamOutSize()) {
+      out.reserve(out.size() + ZSTD_CStreamOutSize() * 2);
+    }
+    const size_t pos = out.size();
+    out.resize(out.capacity());
+    ZSTD_outBuffer output = {out.data() + pos, out.size() - pos, 0};
+    remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+    assert(!ZSTD_isError(remaining));
+    out.resize(pos + output.pos);
+  } while (mode == ZSTD_e_end ? remaining != 0 : input.pos < input.size);
+}
+
+bool JournalChunkWriter::add(const JournalEntry &entry) {
+  if (truncated) return false;
+
+  // worst case the current chunk doesn't compress at all
+  const size_t frame_overhead = 64;
+  if (compressed_bytes + chunk_uncompressed + entry.data.size() + frame_overhead > max_bytes) {
+    truncated = true;
+    return false;
+  }
+
+  compress(entry.data, ZSTD_e_continue);
+  last_cursor = entry.cursor;
+  ++chunk_entries;
+  ++entries;
+  chunk_uncompressed += entry.data.size();
+  uncompressed_bytes += entry.data.size();
+
+  if (chunk_uncompressed >= chunk_size) {
+    flush_chunk();
+  }
+  return true;
+}
+
+void JournalChunkWriter::flush_chunk() {
+  if (chunk_entries == 0 && !truncated) return;
+
+  compress({}, ZSTD_e_end);
+
+  MessageBuilder msg;
+  auto chunk = msg.initEvent().initBoot().initJournalChunk();
+  chunk.setIndex(chunks);
+  chunk.setEntries(chunk_entries);
+  chunk.setUncompressedSize(chunk_uncompressed);
+  chunk.setData(capnp::Data::Reader(out.data(), out.size()));
+  chunk.setLastCursor(last_cursor);
+  chunk.setTruncated(truncated);
+  emit(capnp::messageToFlatArray(msg));
+
+  ++chunks;
+  compressed_bytes += out.size();
+  out.clear();
+  chunk_entries = chunk_uncompressed = 0;
+}
+
+void JournalChunkWriter::finish() {
+  flush_chunk();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <zstd.h>
+
+#include "cereal/messaging/messaging.h"
+
+// One journal entry serialized in journalctl's export format, including the trailing empty line.
+struct JournalEntry {
+  std::string cursor;
+  std::string data;
+};
+
+// return false from the callback to stop reading
+typedef std::function<bool(const JournalEntry &)> JournalEntryCallback;
+
+// Reads the local journal through sd-journal, starting after `after_cursor` (or from the
+// start if empty) and ending at the tail as seen on entry. Returns the cursor of the last entry
+// the callback accepted, `after_cursor` if there was none, so the next read resumes after it.
+std::string journal_read(const std::string &after_cursor, const JournalEntryCallback &cb);
+
+// Appends a "FIELD=value" data field of sd-journal in export format, values that aren't
+// single-line text are written as binary fields.
+void journal_append_field(std::string &out, const char *field, size_t len);
+
+// Reads a journal export stream, e.g. from `journalctl -o export`.
+bool journal_read_export(FILE *f, const JournalEntryCallback &cb);
+
+// Compresses entries incrementally and emits a boot event for every chunk.
+class JournalChunkWriter {
+public:
+  typedef std::function<void(kj::Array<capnp::word>)> EmitCallback;
+
+  JournalChunkWriter(EmitCallback emit, size_t chunk_size, size_t max_bytes);
+  ~JournalChunkWriter();
+  // returns false once the size cap is reached
+  bool add(const JournalEntry &entry);
+  void finish();
+
+  size_t chunks = 0;
+  size_t entries = 0;
+  size_t uncompressed_bytes = 0;
+  size_t compressed_bytes = 0;
+  bool truncated = false;
+
+private:
+  void compress(const std::string &data, ZSTD_EndDirective mode);
+  void flush_chunk();
+
+  EmitCallback emit;
+  const size_t chunk_size, max_bytes;
+  ZSTD_CCtx *cctx;
+  std::vector<uint8_t> out;
+  size_t chunk_entries = 0, chunk_uncompressed = 0;
+  std::string last_cursor;
+};
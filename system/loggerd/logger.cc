@@ -41,22 +41,24 @@ kj::Array<capnp::word> logger_build_init_data() {
 
   // log params
   Params params(util::getenv("PARAMS_COPY_PATH", ""));
-  std::map<std::string, std::string> params_map = params.readAll();
+  ParamsSnapshot snapshot;
+  params.snapshot(&snapshot);
 
-  init.setGitCommit(params_map["GitCommit"]);
-  init.setGitCommitDate(params_map["GitCommitDate"]);
-  init.setGitBranch(params_map["GitBranch"]);
-  init.setGitRemote(params_map["GitRemote"]);
+  init.setGitCommit(snapshot.c_str("GitCommit"));
+  init.setGitCommitDate(snapshot.c_str("GitCommitDate"));
+  init.setGitBranch(snapshot.c_str("GitBranch"));
+  init.setGitRemote(snapshot.c_str("GitRemote"));
   init.setPassive(false);
-  init.setDongleId(params_map["DongleId"]);
+  init.setDongleId(snapshot.c_str("DongleId"));
 
-  auto lparams = init.initParams().initEntries(params_map.size());
+  auto lparams = init.initParams().initEntries(snapshot.entries().size());
   int j = 0;
-  for (auto& [key, value] : params_map) {
+  for (const auto &entry : snapshot.entries()) {
     auto lentry = lparams[j];
-    lentry.setKey(key);
-    if ( !(params.getKeyType(key) & DONT_LOG) ) {
-      lentry.setValue(capnp::Data::Reader((const kj::byte*)value.data(), value.size()));
+    // the keys are file names, NUL terminated in the snapshot
+    lentry.setKey(entry.key.data());
+    if ( !(entry.type & DONT_LOG) ) {
+      lentry.setValue(capnp::Data::Reader((const kj::byte*)entry.value.data(), entry.value.size()));
     }
     j++;
   }
@@ -1,5 +1,6 @@
 #include <sys/xattr.h>
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <string>
@@ -7,12 +8,20 @@
 #include <vector>
 
 #include "common/params.h"
+#include "common/realtime.h"
+#include "common/spsc_queue.h"
 #include "system/loggerd/encoder/encoder.h"
 #include "system/loggerd/loggerd.h"
 #include "system/loggerd/video_writer.h"
 
 ExitHandler do_exit;
 
+const int SCHEDULER_FREQ = 100;  // Hz, scheduling passes over the non-encoder sockets
+const int RECV_BUDGET_MS = 100;  // a socket may catch up this much of its nominal traffic per pass
+const int MIN_RECV_BUDGET = 4;
+const int MAX_RECV_BUDGET = 200;
+const int ENCODER_HANDOFF_SIZE = 1024;
+
 struct LoggerdState {
   LoggerState logger;
   std::atomic<double> last_camera_seen_tms{0.0};
@@ -55,6 +64,7 @@ void rotate_if_needed(LoggerdState *s) {
 
 struct RemoteEncoder {
   std::unique_ptr<VideoWriter> writer;
+  std::unique_ptr<PacketRing> ring;
   int encoderd_segment_offset;
   int current_segment = -1;
   std::vector<Message *> q;
@@ -137,7 +147,21 @@ int handle_encoder_msg(LoggerdState *s, Message *msg, std::string &name, struct
     // if we are actually writing the video file, do so
     if (re.writer) {
       auto data = edata.getData();
-      re.writer->write((uint8_t *)data.begin(), data.size(), idx.getTimestampEof()/1000, false, flags & V4L2_BUF_FLAG_KEYFRAME);
+      if (data.size() == 0 && idx.getLen() > 0) {
+        // the packet is in encoderd's shared memory ring
+        if (!re.ring) re.ring.reset(new PacketRing(packet_ring_name(encoder_info.publish_name), false));
+        const uint64_t offset = edata.getRingOffset();
+        if (const uint8_t *dat = re.ring->get(offset, idx.getLen())) {
+          re.writer->write((uint8_t *)dat, idx.getLen(), idx.getTimestampEof()/1000, false, flags & V4L2_BUF_FLAG_KEYFRAME);
+          if (!re.ring->valid(offset)) {
+            LOGE("%s: packet %d overwritten while writing", name.c_str(), idx.getEncodeId());
+          }
+        } else {
+          LOGE("%s: packet %d is no longer in the ring", name.c_str(), idx.getEncodeId());
+        }
+      } else {
+        re.writer->write((uint8_t *)data.begin(), data.size(), idx.getTimestampEof()/1000, false, flags & V4L2_BUF_FLAG_KEYFRAME);
+      }
     }
 
     // put it in log stream as the idx packet
@@ -197,15 +221,88 @@ void handle_user_flag(LoggerdState *s) {
   prev_segment = s->logger.segment();
 }
 
+struct ServiceState {
+  std::string name;
+  int counter, freq;
+  int budget;  // max messages read per scheduling pass, proportional to the service frequency
+  bool encoder, user_flag;
+
+  // receive stats, reset every time they are logged
+  uint64_t msgs = 0, bytes = 0;
+  uint64_t deferred = 0;  // passes that ended with the budget exhausted
+  std::atomic<uint64_t> handoff_full = 0;  // encoder packets that waited for room in the handoff
+  // from the packet being received (encoders) or the socket being seen readable, to being logged
+  double lag_sum_ms = 0, lag_max_ms = 0;
+  double ready_since_tms = 0;  // socket readable and not drained yet, 0 if drained
+};
+
+struct EncoderPacket {
+  SubSocket *sock;
+  Message *msg;
+  double recv_tms;
+};
+
+// Encoder packets are received on their own thread so that bursts on high
+// frequency services never delay them, then handed off to the logging thread.
+void encoder_recv_thread(std::vector<SubSocket *> socks, std::unordered_map<SubSocket *, ServiceState> *service_state,
+                         SpscQueue<EncoderPacket> *handoff, LoggerdState *s) {
+  util::set_thread_name("loggerd_encoder");
+  std::unique_ptr<Poller> poller(Poller::create());
+  for (auto sock : socks) poller->registerSocket(sock);
+
+  while (!do_exit) {
+    for (auto sock : poller->poll(100)) {
+      Message *msg = nullptr;
+      while (!do_exit && (msg = sock->receive(true))) {
+        const double tms = millis_since_boot();
+        s->last_camera_seen_tms = tms;
+        // never drop, wait for the logging thread to catch up. the following packets stay queued in msgq meanwhile
+        if (!handoff->try_push({sock, msg, tms})) {
+          ServiceState &service = service_state->at(sock);
+          if (service.handoff_full++ == 0) {
+            LOGE("%s: encoder handoff full, waiting for the logging thread", service.name.c_str());
+          }
+          while (!handoff->try_push({sock, msg, tms})) {
+            if (do_exit) {
+              delete msg;
+              break;
+            }
+            util::sleep_for(1);
+          }
+        }
+      }
+    }
+  }
+}
+
+static void update_recv_stats(ServiceState &service, Message *msg, double since_tms) {
+  ++service.msgs;
+  service.bytes += msg->getSize();
+
+  const double lag_ms = millis_since_boot() - since_tms;
+  service.lag_sum_ms += lag_ms;
+  service.lag_max_ms = std::max(service.lag_max_ms, lag_ms);
+}
+
+static void log_recv_stats(std::unordered_map<SubSocket *, ServiceState> &service_state) {
+  for (auto &[_, service] : service_state) {
+    if (service.msgs == 0 && service.handoff_full == 0) continue;
+    LOGD("%s: %" PRIu64 " msgs, %" PRIu64 " bytes, lag avg %.2f ms max %.2f ms, deferred %" PRIu64 ", handoff full %" PRIu64,
+         service.name.c_str(), service.msgs, service.bytes, service.msgs ? service.lag_sum_ms / service.msgs : 0.,
+         service.lag_max_ms, service.deferred, service.handoff_full.load());
+    if (service.deferred > 0 || service.handoff_full > 0) {
+      LOGW("%s: receive behind, deferred %" PRIu64 " handoff full %" PRIu64, service.name.c_str(), service.deferred, service.handoff_full.load());
+    }
+    service.msgs = service.bytes = service.deferred = service.handoff_full = 0;
+    service.lag_sum_ms = service.lag_max_ms = 0;
+  }
+}
+
 void loggerd_thread() {
   // setup messaging
-  typedef struct ServiceState {
-    std::string name;
-    int counter, freq;
-    bool encoder, user_flag;
-  } ServiceState;
   std::unordered_map<SubSocket*, ServiceState> service_state;
   std::unordered_map<SubSocket*, struct RemoteEncoder> remote_encoders;
+  std::vector<SubSocket *> encoder_socks;
 
   std::unique_ptr<Context> ctx(Context::create());
   std::unique_ptr<Poller> poller(Poller::create());
@@ -219,14 +316,18 @@ void loggerd_thread() {
 
     SubSocket * sock = SubSocket::create(ctx.get(), it.name);
     assert(sock != NULL);
-    poller->registerSocket(sock);
-    service_state[sock] = {
-      .name = it.name,
-      .counter = 0,
-      .freq = it.decimation,
-      .encoder = encoder,
-      .user_flag = it.name == "userFlag",
-    };
+    if (encoder) {
+      encoder_socks.push_back(sock);
+    } else {
+      poller->registerSocket(sock);
+    }
+    ServiceState &service = service_state[sock];
+    service.name = it.name;
+    service.counter = 0;
+    service.freq = it.decimation;
+    service.budget = std::clamp(it.frequency * RECV_BUDGET_MS / 1000, MIN_RECV_BUDGET, MAX_RECV_BUDGET);
+    service.encoder = encoder;
+    service.user_flag = it.name == "userFlag";
   }
 
   LoggerdState s;
@@ -242,48 +343,80 @@ void loggerd_thread() {
     }
   }
 
+  SpscQueue<EncoderPacket> encoder_handoff(ENCODER_HANDOFF_SIZE);
+  std::thread encoder_thread(encoder_recv_thread, encoder_socks, &service_state, &encoder_handoff, &s);
+
   uint64_t msg_count = 0, bytes_count = 0;
   double start_ts = millis_since_boot();
+  int last_stats_segment = s.logger.segment();
+
+  auto log_msg_count = [&]() {
+    if ((++msg_count % 1000) == 0) {
+      double seconds = (millis_since_boot() - start_ts) / 1000.0;
+      LOGD("%" PRIu64 " messages, %.2f msg/sec, %.2f KB/sec", msg_count, msg_count / seconds, bytes_count * 0.001 / seconds);
+    }
+  };
+
+  // encoder packets always go first, and are all logged on exit
+  auto drain_encoder_handoff = [&]() {
+    EncoderPacket pkt;
+    while (encoder_handoff.try_pop(pkt)) {
+      ServiceState &service = service_state[pkt.sock];
+      service.counter++;
+      update_recv_stats(service, pkt.msg, pkt.recv_tms);
+      bytes_count += handle_encoder_msg(&s, pkt.msg, service.name, remote_encoders[pkt.sock], encoder_infos_dict[service.name]);
+      rotate_if_needed(&s);
+      log_msg_count();
+    }
+  };
+
   while (!do_exit) {
-    // poll for new messages on all sockets
-    for (auto sock : poller->poll(1000)) {
+    drain_encoder_handoff();
+
+    // poll for new messages on all non-encoder sockets. short timeout so the encoder handoff is serviced promptly
+    auto ready = poller->poll(1000 / SCHEDULER_FREQ);
+    const double poll_tms = millis_since_boot();
+    for (auto sock : ready) {
       if (do_exit) break;
 
       ServiceState &service = service_state[sock];
+      if (service.ready_since_tms == 0) service.ready_since_tms = poll_tms;
       if (service.user_flag) {
         handle_user_flag(&s);
       }
 
-      // drain socket
+      // read up to the service's budget, the rest is picked up on the next pass
       int count = 0;
       Message *msg = nullptr;
-      while (!do_exit && (msg = sock->receive(true))) {
+      while (!do_exit && count < service.budget && (msg = sock->receive(true))) {
         const bool in_qlog = service.freq != -1 && (service.counter++ % service.freq == 0);
-        if (service.encoder) {
-          s.last_camera_seen_tms = millis_since_boot();
-          bytes_count += handle_encoder_msg(&s, msg, service.name, remote_encoders[sock], encoder_infos_dict[service.name]);
-        } else {
-          s.logger.write((uint8_t *)msg->getData(), msg->getSize(), in_qlog);
-          bytes_count += msg->getSize();
-          delete msg;
-        }
+        update_recv_stats(service, msg, service.ready_since_tms);
+        s.logger.write((uint8_t *)msg->getData(), msg->getSize(), in_qlog);
+        bytes_count += msg->getSize();
+        delete msg;
 
         rotate_if_needed(&s);
-
-        if ((++msg_count % 1000) == 0) {
-          double seconds = (millis_since_boot() - start_ts) / 1000.0;
-          LOGD("%" PRIu64 " messages, %.2f msg/sec, %.2f KB/sec", msg_count, msg_count / seconds, bytes_count * 0.001 / seconds);
-        }
-
+        log_msg_count();
         count++;
-        if (count >= 200) {
-          LOGD("large volume of '%s' messages", service.name.c_str());
-          break;
-        }
       }
+      if (count >= service.budget) {
+        service.deferred++;
+      } else {
+        service.ready_since_tms = 0;
+      }
+
+      drain_encoder_handoff();
+    }
+
+    if (s.logger.segment() != last_stats_segment) {
+      log_recv_stats(service_state);
+      last_stats_segment = s.logger.segment();
     }
   }
 
+  encoder_thread.join();
+  drain_encoder_handoff();
+
   LOGW("closing logger");
   s.logger.setExitSignal(do_exit.signal);
 
@@ -299,12 +432,8 @@ void loggerd_thread() {
 
 int main(int argc, char** argv) {
   if (!Hardware::PC()) {
-    int ret;
-    ret = util::set_core_affinity({0, 1, 2, 3});
+    int ret = config_realtime_process("loggerd");
     assert(ret == 0);
-    // TODO: why does this impact camerad timings?
-    //ret = util::set_realtime_priority(1);
-    //assert(ret == 0);
   }
 
   loggerd_thread();
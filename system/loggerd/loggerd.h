@@ -35,6 +35,7 @@ public:
   const char *thumbnail_name = NULL;
   const char *filename = NULL;
   bool record = true;
+  bool packet_ring = false;  // publish the packet data through encoderd's shared memory ring
   int frame_width = -1;
   int frame_height = -1;
   int fps = MAIN_FPS;
@@ -57,12 +58,14 @@ public:
 const EncoderInfo main_road_encoder_info = {
   .publish_name = "roadEncodeData",
   .filename = "fcamera.hevc",
+  .packet_ring = true,
   INIT_ENCODE_FUNCTIONS(RoadEncode),
 };
 
 const EncoderInfo main_wide_road_encoder_info = {
   .publish_name = "wideRoadEncodeData",
   .filename = "ecamera.hevc",
+  .packet_ring = true,
   INIT_ENCODE_FUNCTIONS(WideRoadEncode),
 };
 
@@ -70,6 +73,7 @@ const EncoderInfo main_driver_encoder_info = {
   .publish_name = "driverEncodeData",
   .filename = "dcamera.hevc",
   .record = Params().getBool("RecordFront"),
+  .packet_ring = true,
   INIT_ENCODE_FUNCTIONS(DriverEncode),
 };
 
@@ -105,6 +109,7 @@ const EncoderInfo qcam_encoder_info = {
   .encode_type = cereal::EncodeIndex::Type::QCAMERA_H264,
   .frame_width = 526,
   .frame_height = 330,
+  .packet_ring = true,
   INIT_ENCODE_FUNCTIONS(QRoadEncode),
 };
 
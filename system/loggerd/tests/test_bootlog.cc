@@ -0,0 +1,250 @@
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <systemd/sd-journal.h>
+#endif
+
+#include "catch2/catch.hpp"
+#include "system/loggerd/journal.h"
+
+// synthetic journalctl -o export output, with a binary field every few entries
+static std::string synthetic_export(int count, std::vector<std::string> &cursors) {
+  std::string out;
+  for (int i = 0; i < count; ++i) {
+    cursors.push_back("s=deadbeef;i=" + std::to_string(i));
+    out += "__CURSOR=" + cursors.back() + "\n";
+    out += "__REALTIME_TIMESTAMP=" + std::to_string(1700000000000000ULL + i) + "\n";
+    out += "__MONOTONIC_TIMESTAMP=" + std::to_string(i * 1000) + "\n";
+    out += "_SYSTEMD_UNIT=comma.service\n";
+    if (i % 7 == 0) {
+      const std::string value = "line one\nline two " + std::to_string(i);
+      out += "MESSAGE\n";
+      for (int b = 0; b < 8; ++b) out.push_back((char)((value.size() >> (b * 8)) & 0xff));
+      out += value + "\n";
+    } else {
+      out += "MESSAGE=entry " + std::to_string(i) + " " + std::string(i % 300, 'x') + "\n";
+    }
+    out += "\n";
+  }
+  return out;
+}
+
+static std::string decompress(capnp::Data::Reader data) {
+  std::string out;
+  ZSTD_DCtx *dctx = ZSTD_createDCtx();
+  ZSTD_inBuffer input = {data.begin(), data.size(), 0};
+  std::vector<char> buf(ZSTD_DStreamOutSize());
+  while (input.pos < input.size) {
+    ZSTD_outBuffer output = {buf.data(), buf.size(), 0};
+    size_t ret = ZSTD_decompressStream(dctx, &output, &input);
+    REQUIRE(!ZSTD_isError(ret));
+    out.append(buf.data(), output.pos);
+  }
+  ZSTD_freeDCtx(dctx);
+  return out;
+}
+
+TEST_CASE("bootlog journal chunks") {
+  std::vector<std::string> cursors;
+  const std::string journal = synthetic_export(5000, cursors);
+  FILE *f = fmemopen((void *)journal.data(), journal.size(), "r");
+  REQUIRE(f != nullptr);
+
+  std::vector<kj::Array<capnp::word>> events;
+  auto emit = [&events](kj::Array<capnp::word> event) { events.push_back(kj::mv(event)); };
+
+  SECTION("round trip") {
+    JournalChunkWriter writer(emit, 64 * 1024, SIZE_MAX);
+    int i = 0;
+    REQUIRE(journal_read_export(f, [&](const JournalEntry &entry) {
+      REQUIRE(entry.cursor == cursors[i++]);
+      return writer.add(entry);
+    }));
+    writer.finish();
+    REQUIRE(i == cursors.size());
+    REQUIRE(writer.entries == cursors.size());
+    REQUIRE(writer.uncompressed_bytes == journal.size());
+    REQUIRE(writer.chunks == events.size());
+    REQUIRE(events.size() > 1);
+
+    std::string decompressed;
+    for (int j = 0; j < events.size(); ++j) {
+      capnp::FlatArrayMessageReader reader(events[j]);
+      auto chunk = reader.getRoot<cereal::Event>().getBoot().getJournalChunk();
+      REQUIRE(chunk.getIndex() == j);
+      REQUIRE_FALSE(chunk.getTruncated());
+      const std::string data = decompress(chunk.getData());
+      REQUIRE(data.size() == chunk.getUncompressedSize());
+      decompressed += data;
+    }
+    REQUIRE(decompressed == journal);
+    capnp::FlatArrayMessageReader last(events.back());
+    REQUIRE(last.getRoot<cereal::Event>().getBoot().getJournalChunk().getLastCursor() == cursors.back());
+  }
+
+  SECTION("size cap") {
+    const size_t max_bytes = 16 * 1024;
+    JournalChunkWriter writer(emit, 4 * 1024, max_bytes);
+    REQUIRE(journal_read_export(f, [&](const JournalEntry &entry) { return writer.add(entry); }));
+    writer.finish();
+    REQUIRE(writer.truncated);
+    REQUIRE(writer.entries < cursors.size());
+    REQUIRE(writer.compressed_bytes <= max_bytes);
+
+    // the chunks end at the last entry that fit, which is where the next read resumes
+    std::string decompressed;
+    for (auto &event : events) {
+      capnp::FlatArrayMessageReader reader(event);
+      decompressed += decompress(reader.getRoot<cereal::Event>().getBoot().getJournalChunk().getData());
+    }
+    const std::string last_emitted = "__CURSOR=" + cursors[writer.entries - 1] + "\n";
+    const std::string first_dropped = "__CURSOR=" + cursors[writer.entries] + "\n";
+    REQUIRE(decompressed.find(last_emitted) != std::string::npos);
+    REQUIRE(decompressed.find(first_dropped) == std::string::npos);
+    REQUIRE(decompressed == journal.substr(0, decompressed.size()));
+    REQUIRE(journal.compare(decompressed.size(), first_dropped.size(), first_dropped) == 0);
+
+    capnp::FlatArrayMessageReader last(events.back());
+    auto chunk = last.getRoot<cereal::Event>().getBoot().getJournalChunk();
+    REQUIRE(chunk.getTruncated());
+    REQUIRE(chunk.getLastCursor() == cursors[writer.entries - 1]);
+  }
+
+  fclose(f);
+}
+
+TEST_CASE("journal_append_field") {
+  std::string out;
+  const std::string text = "MESSAGE=tab\tseparated";
+  journal_append_field(out, text.data(), text.size());
+  REQUIRE(out == text + "\n");
+
+  // not single-line text, written as FIELD\n<little endian uint64 size><value>\n
+  const std::string value = std::string("line one\nline two") + '\x01';
+  const std::string binary = "MESSAGE=" + value;
+  std::string binary_export = "MESSAGE\n";
+  for (int b = 0; b < 8; ++b) binary_export.push_back((char)((value.size() >> (b * 8)) & 0xff));
+  binary_export += value + "\n";
+  out.clear();
+  journal_append_field(out, binary.data(), binary.size());
+  REQUIRE(out == binary_export);
+
+  // not a field
+  out.clear();
+  journal_append_field(out, "MESSAGE", 7);
+  REQUIRE(out.empty());
+
+  // reads back as the same entry
+  std::string entry_data = "__CURSOR=c\n";
+  journal_append_field(entry_data, text.data(), text.size());
+  journal_append_field(entry_data, binary.data(), binary.size());
+  entry_data += "\n";
+  FILE *f = fmemopen((void *)entry_data.data(), entry_data.size(), "r");
+  REQUIRE(f != nullptr);
+  std::vector<JournalEntry> entries;
+  REQUIRE(journal_read_export(f, [&](const JournalEntry &entry) {
+    entries.push_back(entry);
+    return true;
+  }));
+  fclose(f);
+  REQUIRE(entries.size() == 1);
+  REQUIRE(entries[0].cursor == "c");
+  REQUIRE(entries[0].data == entry_data);
+}
+
+#ifdef __linux__
+static std::string journal_tail() {
+  std::string tail;
+  sd_journal *j = nullptr;
+  if (sd_journal_open(&j, SD_JOURNAL_LOCAL_ONLY) < 0) return tail;
+  char *cursor = nullptr;
+  if (sd_journal_seek_tail(j) >= 0 && sd_journal_previous(j) > 0 && sd_journal_get_cursor(j, &cursor) >= 0) {
+    tail = cursor;
+    free(cursor);
+  }
+  sd_journal_close(j);
+  return tail;
+}
+
+TEST_CASE("journal_read") {
+  const std::string start = journal_tail();
+  const std::string tag = "test_bootlog_" + std::to_string(getpid());
+  for (int i = 0; i < 3; ++i) {
+    if (sd_journal_send("MESSAGE=entry %d", i, "BOOTLOG_TEST=%s", tag.c_str(), "BOOTLOG_BINARY=a\nb", nullptr) < 0) {
+      WARN("journald isn't running");
+      return;
+    }
+  }
+
+  // journald writes the entries asynchronously
+  std::vector<JournalEntry> tagged;
+  for (int retry = 0; retry < 200 && tagged.size() < 3; ++retry) {
+    usleep(10 * 1000);
+    tagged.clear();
+    journal_read(start, [&](const JournalEntry &entry) {
+      if (entry.data.find("BOOTLOG_TEST=" + tag + "\n") != std::string::npos) tagged.push_back(entry);
+      return true;
+    });
+  }
+  REQUIRE(tagged.size() == 3);
+
+  SECTION("export format") {
+    std::string binary_export = "BOOTLOG_BINARY\n";
+    binary_export.push_back(3);
+    binary_export.append(7, '\0');
+    binary_export += "a\nb\n";
+    std::string data;
+    for (int i = 0; i < tagged.size(); ++i) {
+      REQUIRE(tagged[i].data.rfind("__CURSOR=" + tagged[i].cursor + "\n", 0) == 0);
+      REQUIRE(tagged[i].data.find("MESSAGE=entry " + std::to_string(i) + "\n") != std::string::npos);
+      REQUIRE(tagged[i].data.find(binary_export) != std::string::npos);
+      data += tagged[i].data;
+    }
+
+    // what journal_read_export reads from journalctl -o export
+    FILE *f = fmemopen((void *)data.data(), data.size(), "r");
+    REQUIRE(f != nullptr);
+    int i = 0;
+    REQUIRE(journal_read_export(f, [&](const JournalEntry &entry) {
+      REQUIRE(entry.cursor == tagged[i].cursor);
+      REQUIRE(entry.data == tagged[i].data);
+      ++i;
+      return true;
+    }));
+    fclose(f);
+    REQUIRE(i == 3);
+  }
+
+  SECTION("resumes after the last accepted entry") {
+    // nothing accepted, nothing skipped
+    REQUIRE(journal_read(start, [](const JournalEntry &) { return false; }) == start);
+
+    // refuse the entry after the first tagged one, as a full JournalChunkWriter does
+    bool seen_first = false;
+    std::string refused;
+    const std::string cursor = journal_read(start, [&](const JournalEntry &entry) {
+      if (seen_first) {
+        refused = entry.cursor;
+        return false;
+      }
+      seen_first = entry.cursor == tagged[0].cursor;
+      return true;
+    });
+    REQUIRE(cursor == tagged[0].cursor);
+    REQUIRE_FALSE(refused.empty());
+
+    // the refused entry is the first one of the next read
+    std::string next;
+    journal_read(cursor, [&](const JournalEntry &entry) {
+      next = entry.cursor;
+      return false;
+    });
+    REQUIRE(next == refused);
+  }
+}
+#endif
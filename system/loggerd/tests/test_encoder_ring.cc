@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "common/prefix.h"
+#include "system/loggerd/encoder/ffmpeg_encoder.h"
+#include "system/loggerd/encoder/packet_ring.h"
+
+TEST_CASE("PacketRing wraps and detects overwritten packets") {
+  OpenpilotPrefix prefix;
+  const std::string name = packet_ring_name("testEncodeData");
+  PacketRing writer(name, true, 1024);
+  PacketRing reader(name, false);
+  REQUIRE(writer.is_open());
+
+  std::vector<uint8_t> pkt(300);
+  std::vector<uint64_t> offsets;
+  for (int i = 0; i < 10; ++i) {
+    std::fill(pkt.begin(), pkt.end(), i);
+    offsets.push_back(writer.write(pkt.data(), pkt.size()));
+
+    // packets are never split across the end of the ring
+    REQUIRE((offsets.back() % 1024) + pkt.size() <= 1024);
+    const uint8_t *dat = reader.get(offsets.back(), pkt.size());
+    REQUIRE(dat != nullptr);
+    REQUIRE(std::all_of(dat, dat + pkt.size(), [i](uint8_t b) { return b == i; }));
+  }
+  REQUIRE(reader.get(offsets[0], pkt.size()) == nullptr);
+  REQUIRE_FALSE(reader.valid(offsets[0]));
+  REQUIRE(reader.get(offsets.back() + 1024, pkt.size()) == nullptr);
+}
+
+TEST_CASE("PacketRing of another capacity replaces the old one") {
+  OpenpilotPrefix prefix;
+  const std::string name = packet_ring_name("testEncodeData");
+  auto writer = std::make_unique<PacketRing>(name, true, 64 * 1024);
+  PacketRing reader(name, false);
+
+  std::vector<uint8_t> pkt(300, 1);
+  uint64_t offset = 0;
+  while (offset < 32 * 1024) offset = writer->write(pkt.data(), pkt.size());
+  const uint8_t *dat = reader.get(offset, pkt.size());
+  REQUIRE(dat != nullptr);
+
+  // encoderd restarted with a smaller ring, what the reader has mapped stays readable
+  writer = std::make_unique<PacketRing>(name, true, 1024);
+  REQUIRE(writer->is_open());
+  REQUIRE(std::all_of(dat, dat + pkt.size(), [](uint8_t b) { return b == 1; }));
+  REQUIRE(reader.valid(offset));
+
+  // and the reader moves to the new ring on its next packet
+  std::fill(pkt.begin(), pkt.end(), 2);
+  offset = writer->write(pkt.data(), pkt.size());
+  dat = reader.get(offset, pkt.size());
+  REQUIRE(dat != nullptr);
+  REQUIRE(std::all_of(dat, dat + pkt.size(), [](uint8_t b) { return b == 2; }));
+  REQUIRE(reader.max_packet_size() == 1024);
+
+  // the same capacity keeps the ring and its offsets
+  writer = std::make_unique<PacketRing>(name, true, 1024);
+  REQUIRE(writer->write(pkt.data(), pkt.size()) == offset + pkt.size());
+  REQUIRE(reader.get(offset, pkt.size()) == dat);
+}
+
+TEST_CASE("FfmpegEncoder publishes packets through the ring") {
+  OpenpilotPrefix prefix;
+  const int width = 320, height = 240, frames = 600;
+
+  // the ring encoder and an inline reference encoder see the same frames
+  EncoderInfo ring_info = main_road_encoder_info;
+  EncoderInfo inline_info = stream_road_encoder_info;
+  ring_info.encode_type = inline_info.encode_type = cereal::EncodeIndex::Type::BIG_BOX_LOSSLESS;
+  REQUIRE(ring_info.packet_ring);
+  REQUIRE_FALSE(inline_info.packet_ring);
+
+  std::unique_ptr<Context> ctx(Context::create());
+  std::unique_ptr<SubSocket> ring_sock(SubSocket::create(ctx.get(), ring_info.publish_name, "127.0.0.1", false, true, 100));
+  std::unique_ptr<SubSocket> inline_sock(SubSocket::create(ctx.get(), inline_info.publish_name, "127.0.0.1", false, true, 100));
+
+  FfmpegEncoder ring_encoder(ring_info, width, height);
+  FfmpegEncoder inline_encoder(inline_info, width, height);
+  ring_encoder.encoder_open(nullptr);
+  inline_encoder.encoder_open(nullptr);
+  PacketRing ring(packet_ring_name(ring_info.publish_name), false);
+
+  auto receive = [](SubSocket *sock, auto get_data) {
+    std::unique_ptr<Message> msg(sock->receive());
+    REQUIRE(msg);
+    capnp::FlatArrayMessageReader cmsg(kj::ArrayPtr<capnp::word>((capnp::word *)msg->getData(), msg->getSize() / sizeof(capnp::word)));
+    auto edata = (cmsg.getRoot<cereal::Event>().*get_data)();
+    auto data = edata.getData();
+    return std::make_tuple(edata.getIdx().getFrameId(), edata.getIdx().getLen(), edata.getRingOffset(),
+                           std::string(data.begin(), data.end()));
+  };
+
+  // synthetic NV12 noise, so packets are large and the ring wraps many times
+  VisionBuf buf = {};
+  buf.allocate(width * height * 3 / 2);
+  buf.init_yuv(width, height, width, width * height);
+  std::mt19937 rng(1234);
+
+  uint64_t prev_offset = 0;
+  for (uint32_t i = 0; i < frames; ++i) {
+    std::generate((uint8_t *)buf.addr, (uint8_t *)buf.addr + buf.len, [&]() { return rng() & 0xff; });
+    VisionIpcBufExtra extra = {.frame_id = i};
+    REQUIRE(ring_encoder.encode_frame(&buf, &extra) >= 0);
+    REQUIRE(inline_encoder.encode_frame(&buf, &extra) >= 0);
+
+    auto [frame_id, len, offset, data] = receive(ring_sock.get(), ring_info.get_encode_data_func);
+    auto [ref_frame_id, ref_len, ref_offset, ref_data] = receive(inline_sock.get(), inline_info.get_encode_data_func);
+    REQUIRE(frame_id == i);
+    REQUIRE(ref_frame_id == i);
+    REQUIRE(data.empty());
+    REQUIRE(len == ref_data.size());
+    REQUIRE((i == 0 || offset > prev_offset));
+    prev_offset = offset;
+
+    const uint8_t *dat = ring.get(offset, len);
+    REQUIRE(dat != nullptr);
+    REQUIRE(memcmp(dat, ref_data.data(), len) == 0);
+    REQUIRE(ring.valid(offset));
+  }
+  REQUIRE(prev_offset > ring.max_packet_size() * 4);
+
+  ring_encoder.encoder_close();
+  inline_encoder.encoder_close();
+  buf.free();
+}
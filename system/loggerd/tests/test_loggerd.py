@@ -8,6 +8,7 @@ import time
 from collections import defaultdict
 from pathlib import Path
 import pytest
+import zstandard as zstd
 
 import cereal.messaging as messaging
 from cereal import log
@@ -194,16 +195,22 @@ class TestLoggerd:
     lr = list(LogReader(str(bootlog_path)))
 
     # check length
-    assert len(lr) == 2  # boot + initData
+    assert len(lr) >= 2  # initData + boot + journal chunks
 
     self._check_init_data(lr)
 
     # check msgs
     bootlog_msgs = [m for m in lr if m.which() == 'boot']
-    assert len(bootlog_msgs) == 1
+    assert len(bootlog_msgs) == len(lr) - 1
+
+    # journal chunks follow the main boot event
+    chunks = [m.boot.journalChunk for m in bootlog_msgs[1:]]
+    assert [c.index for c in chunks] == list(range(len(chunks)))
+    for c in chunks:
+      assert len(zstd.ZstdDecompressor().decompressobj().decompress(c.data)) == c.uncompressedSize
 
     # sanity check values
-    boot = bootlog_msgs.pop().boot
+    boot = bootlog_msgs[0].boot
     assert abs(boot.wallTimeNanos - time.time_ns()) < 5*1e9 # within 5s
     assert boot.launchLog == launch_log
 
@@ -1,5 +1,3 @@
-#include <sys/resource.h>
-
 #include <chrono>
 #include <thread>
 #include <vector>
@@ -11,6 +9,7 @@
 #include "cereal/messaging/messaging.h"
 #include "common/i2c.h"
 #include "common/ratekeeper.h"
+#include "common/realtime.h"
 #include "common/swaglog.h"
 #include "common/timing.h"
 #include "common/util.h"
@@ -132,8 +131,7 @@ int sensor_loop(I2CBus *i2c_bus_imu) {
   }
 
   // increase interrupt quality by pinning interrupt and process to core 1
-  setpriority(PRIO_PROCESS, 0, -18);
-  util::set_core_affinity({1});
+  config_realtime_process("sensord");
 
   // TODO: get the IRQ number from gpiochip
   std::string irq_path = "/proc/irq/336/smp_affinity_list";
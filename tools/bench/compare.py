@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+import argparse
+import json
+import math
+import sys
+
+ENVIRONMENT_KEYS = ("cpu", "cpu_count", "cpu_governor", "machine")
+
+
+def welch_p_value(a: dict, b: dict) -> float:
+  # two-sided Welch's t-test from the summary statistics, with a normal approximation of the
+  # t distribution, catch2 defaults to 100 samples
+  se = math.sqrt(a["stddev"] ** 2 / a["samples"] + b["stddev"] ** 2 / b["samples"])
+  if se == 0:
+    return 1.0 if a["mean"] == b["mean"] else 0.0
+  z = abs(b["mean"] - a["mean"]) / se
+  return math.erfc(z / math.sqrt(2))
+
+
+def compare(base: dict, new: dict, alpha: float, threshold: float) -> list[dict]:
+  base_results = {r["id"]: r for r in base["results"]}
+  new_results = {r["id"]: r for r in new["results"]}
+  rows = []
+  for id_ in sorted(base_results.keys() | new_results.keys()):
+    a, b = base_results.get(id_), new_results.get(id_)
+    if a is None or b is None:
+      rows.append({"id": id_, "status": "added" if a is None else "removed"})
+      continue
+
+    change = b["mean"] / a["mean"] - 1 if a["mean"] > 0 else 0.0
+    p = welch_p_value(a, b)
+    status = "same"
+    if p < alpha and abs(change) >= threshold:
+      status = "regression" if change > 0 else "improvement"
+    rows.append({"id": id_, "status": status, "base": a["mean"], "new": b["mean"], "change": change, "p": p})
+  return rows
+
+
+def format_time(ns: float) -> str:
+  for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+    if ns >= scale:
+      return f"{ns / scale:.2f} {unit}"
+  return f"{ns:.1f} ns"
+
+
+def main():
+  parser = argparse.ArgumentParser(description="Compare two benchmark result files from tools/bench/run.py",
+                                   formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+  parser.add_argument("base")
+  parser.add_argument("new")
+  parser.add_argument("--alpha", type=float, default=0.01, help="Significance level")
+  parser.add_argument("--threshold", type=float, default=0.05, help="Smallest relative change that's reported")
+  parser.add_argument("--all", action="store_true", help="Also print unchanged benchmarks")
+  args = parser.parse_args()
+
+  with open(args.base) as f:
+    base = json.load(f)
+  with open(args.new) as f:
+    new = json.load(f)
+
+  for key in ENVIRONMENT_KEYS:
+    if base["environment"].get(key) != new["environment"].get(key):
+      print(f"WARNING: {key} differs: {base['environment'].get(key)} vs {new['environment'].get(key)}")
+  for env in (base["environment"], new["environment"]):
+    if env.get("dirty"):
+      print(f"WARNING: {env['commit'][:8]} was run from a dirty tree")
+
+  rows = compare(base, new, args.alpha, args.threshold)
+  for row in rows:
+    if row["status"] in ("added", "removed"):
+      print(f"{row['status']:>11}  {row['id']}")
+    elif row["status"] != "same" or args.all:
+      print(f"{row['status']:>11}  {row['id']}: {format_time(row['base'])} -> {format_time(row['new'])} "
+            f"({row['change']:+.1%}, p={row['p']:.2g})")
+
+  regressions = sum(row["status"] == "regression" for row in rows)
+  print(f"{regressions} regressions, {sum(row['status'] == 'improvement' for row in rows)} improvements in {len(rows)} benchmarks")
+  return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+import argparse
+import datetime
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+import xml.etree.ElementTree as ET
+
+from openpilot.common.basedir import BASEDIR
+
+# catch2 programs with hidden [benchmark] test cases, built by `scons bench`
+SUITES = [
+  "common/tests/test_common",
+  "tools/cabana/tests/test_cabana",
+  "tools/replay/tests/test_replay",
+]
+
+
+def parse_catch2_xml(suite: str, xml: str) -> list[dict]:
+  results = []
+  root = ET.fromstring(xml)
+  for test_case in root.iter("TestCase"):
+    for bench in test_case.iter("BenchmarkResults"):
+      mean = bench.find("mean")
+      stddev = bench.find("standardDeviation")
+      outliers = bench.find("outliers")
+      results.append({
+        "id": f"{suite}::{test_case.get('name')}::{bench.get('name')}",
+        "suite": suite,
+        "test_case": test_case.get("name"),
+        "name": bench.get("name"),
+        "samples": int(bench.get("samples")),
+        "iterations": int(bench.get("iterations")),
+        # all times in nanoseconds
+        "mean": float(mean.get("value")),
+        "mean_lower": float(mean.get("lowerBound")),
+        "mean_upper": float(mean.get("upperBound")),
+        "stddev": float(stddev.get("value")),
+        "outlier_variance": float(outliers.get("variance")) if outliers is not None else 0.0,
+      })
+  return results
+
+
+def run_suite(suite: str, filter_: str, samples: int) -> list[dict]:
+  binary = os.path.join(BASEDIR, suite)
+  if not os.path.isfile(binary):
+    raise FileNotFoundError(f"{suite} isn't built, run `scons bench`")
+
+  with tempfile.NamedTemporaryFile(suffix=".xml") as f:
+    cmd = [binary, filter_, "-r", "xml", "-o", f.name, "--benchmark-samples", str(samples)]
+    proc = subprocess.run(cmd, cwd=os.path.dirname(binary), stdout=subprocess.DEVNULL, check=False)
+    xml = f.read().decode()
+  if proc.returncode != 0:
+    raise RuntimeError(f"{suite} failed with {proc.returncode}")
+  return parse_catch2_xml(suite, xml)
+
+
+def read_first_line(path: str) -> str | None:
+  try:
+    with open(path) as f:
+      return f.readline().strip()
+  except OSError:
+    return None
+
+
+def environment() -> dict:
+  def git(*args):
+    return subprocess.check_output(["git", *args], cwd=BASEDIR, encoding="utf8").strip()
+
+  cpu_model = platform.processor()
+  try:
+    with open("/proc/cpuinfo") as f:
+      cpu_model = next((l.split(":", 1)[1].strip() for l in f if l.startswith("model name")), cpu_model)
+  except OSError:
+    pass
+
+  return {
+    "time": datetime.datetime.now(datetime.UTC).isoformat(),
+    "commit": git("rev-parse", "HEAD"),
+    "branch": git("rev-parse", "--abbrev-ref", "HEAD"),
+    "dirty": git("status", "--porcelain", "--untracked-files=no") != "",
+    "hostname": platform.node(),
+    "platform": platform.platform(),
+    "machine": platform.machine(),
+    "cpu": cpu_model,
+    "cpu_count": os.cpu_count(),
+    "cpu_governor": read_first_line("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor"),
+    "load_average": os.getloadavg(),
+  }
+
+
+def main():
+  parser = argparse.ArgumentParser(description="Run the catch2 benchmarks and write the results as json",
+                                   formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+  parser.add_argument("-o", "--output", help="Result file, bench_<commit>.json by default")
+  parser.add_argument("--suite", action="append", choices=SUITES, help="Only run these suites")
+  parser.add_argument("--filter", default="[benchmark]", help="catch2 test spec")
+  parser.add_argument("--samples", type=int, default=100, help="Samples per benchmark")
+  args = parser.parse_args()
+
+  env = environment()
+  results, failed = [], []
+  for suite in args.suite or SUITES:
+    print(f"running {suite}", file=sys.stderr)
+    try:
+      results += run_suite(suite, args.filter, args.samples)
+    except (FileNotFoundError, RuntimeError) as e:
+      print(e, file=sys.stderr)
+      failed.append(suite)
+
+  output = args.output or f"bench_{env['commit'][:8]}.json"
+  with open(output, "w") as f:
+    json.dump({"environment": env, "samples": args.samples, "failed": failed, "results": results}, f, indent=2)
+  print(f"{len(results)} results written to {output}", file=sys.stderr)
+  return 1 if failed else 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -0,0 +1,58 @@
+from openpilot.tools.bench.compare import compare, welch_p_value
+from openpilot.tools.bench.run import parse_catch2_xml
+
+CATCH2_XML = """<?xml version="1.0" encoding="UTF-8"?>
+<Catch name="test_common">
+  <Group name="test_common">
+    <TestCase name="swaglog_benchmark" tags="[.][benchmark]" filename="common/tests/test_swaglog.cc" line="133">
+      <BenchmarkResults name="LOGD" samples="100" resamples="100000" iterations="12" clockResolution="20.5" estimatedDuration="1.2e+06">
+        <!--All values in nano seconds-->
+        <mean value="230.5" lowerBound="228.1" upperBound="233.9" ci="0.95"/>
+        <standardDeviation value="14.2" lowerBound="10.3" upperBound="19.8" ci="0.95"/>
+        <outliers variance="0.5" lowMild="0" lowSevere="0" highMild="2" highSevere="1"/>
+      </BenchmarkResults>
+      <OverallResult success="true"/>
+    </TestCase>
+    <OverallResults successes="0" failures="0" expectedFailures="0"/>
+  </Group>
+</Catch>
+"""
+
+
+def result(id_, mean, stddev, samples=100):
+  return {"id": id_, "mean": mean, "stddev": stddev, "samples": samples}
+
+
+class TestBench:
+  def test_parse_catch2_xml(self):
+    results = parse_catch2_xml("common/tests/test_common", CATCH2_XML)
+    assert len(results) == 1
+    r = results[0]
+    assert r["id"] == "common/tests/test_common::swaglog_benchmark::LOGD"
+    assert r["samples"] == 100
+    assert r["iterations"] == 12
+    assert r["mean"] == 230.5
+    assert r["stddev"] == 14.2
+    assert r["outlier_variance"] == 0.5
+
+  def test_welch_p_value(self):
+    assert welch_p_value(result("a", 100, 10), result("a", 100, 10)) == 1.0
+    assert welch_p_value(result("a", 100, 10), result("a", 101, 10)) > 0.4
+    assert welch_p_value(result("a", 100, 10), result("a", 110, 10)) < 1e-6
+    assert welch_p_value(result("a", 100, 0), result("a", 110, 0)) == 0.0
+
+  def test_compare(self):
+    base = {"results": [result("same", 100, 10), result("slower", 100, 5), result("faster", 100, 5),
+                        result("noisy", 100, 80), result("small", 100, 0.1), result("removed", 1, 1)]}
+    new = {"results": [result("same", 101, 10), result("slower", 120, 5), result("faster", 80, 5),
+                       result("noisy", 115, 80), result("small", 102, 0.1), result("added", 1, 1)]}
+    status = {row["id"]: row["status"] for row in compare(base, new, alpha=0.01, threshold=0.05)}
+    assert status == {
+      "same": "same",
+      "slower": "regression",
+      "faster": "improvement",
+      "noisy": "same",  # not significant
+      "small": "same",  # significant, but below the threshold
+      "removed": "removed",
+      "added": "added",
+    }
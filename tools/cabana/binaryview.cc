@@ -36,6 +36,7 @@ BinaryView::BinaryView(QWidget *parent) : QTableView(parent) {
 
   QObject::connect(dbc(), &DBCManager::DBCFileChanged, this, &BinaryView::refresh);
   QObject::connect(UndoStack::instance(), &QUndoStack::indexChanged, this, &BinaryView::refresh);
+  QObject::connect(can, &AbstractStream::timeRangeChanged, this, &BinaryView::updateState);
 
   addShortcuts();
   setWhatsThis(R"(
@@ -195,6 +196,7 @@ void BinaryView::leaveEvent(QEvent *event) {
 
 void BinaryView::setMessage(const MessageId &message_id) {
   model->msg_id = message_id;
+  model->bit_index.clear();
   verticalScrollBar()->setValue(0);
   refresh();
 }
@@ -303,6 +305,15 @@ void BinaryViewModel::updateState() {
     endInsertRows();
   }
 
+  // only scans the events merged since the last update, and the ends of the time range
+  const auto &events = can->events(msg_id);
+  bit_index.update(events);
+  if (auto range = can->timeRange()) {
+    bit_stats = bit_index.queryTime(events, can->toMonoTime(range->first), can->toMonoTime(range->second));
+  } else {
+    bit_stats = bit_index.query(events, 0, events.size());
+  }
+
   const double max_f = 255.0;
   const double factor = 0.25;
   const double scaler = max_f / log2(1.0 + factor);
@@ -312,9 +323,10 @@ void BinaryViewModel::updateState() {
       int val = ((binary[i] >> (7 - j)) & 1) != 0 ? 1 : 0;
       // Bit update frequency based highlighting
       double offset = !item.sigs.empty() ? 50 : 0;
-      auto n = last_msg.last_changes[i].bit_change_counts[j];
+      const int bit = i * 8 + j;
+      auto n = bit < bit_stats.flips.size() ? bit_stats.flips[bit] : 0;
       double min_f = n == 0 ? offset : offset + 25;
-      double alpha = std::clamp(offset + log2(1.0 + factor * (double)n / (double)last_msg.count) * scaler, min_f, max_f);
+      double alpha = std::clamp(offset + log2(1.0 + factor * (double)n / std::max(1u, bit_stats.count)) * scaler, min_f, max_f);
       auto color = item.bg_color;
       color.setAlpha(alpha);
       updateItem(i, j, val, color);
@@ -336,7 +348,20 @@ QVariant BinaryViewModel::headerData(int section, Qt::Orientation orientation, i
 
 QVariant BinaryViewModel::data(const QModelIndex &index, int role) const {
   auto item = (const BinaryViewModel::Item *)index.internalPointer();
-  return role == Qt::ToolTipRole && item && !item->sigs.empty() ? signalToolTip(item->sigs.back()) : QVariant();
+  if (role != Qt::ToolTipRole || !item) return {};
+
+  QString tooltip = !item->sigs.empty() ? signalToolTip(item->sigs.back()) : QString();
+  const int bit = index.row() * 8 + index.column();
+  if (index.column() < 8 && bit < bit_stats.ones.size()) {
+    tooltip += QString("%1Bit %2: %3 flips (%4%), %5% ones, entropy %6")
+                   .arg(tooltip.isEmpty() ? "" : "<br />")
+                   .arg(flipBitPos(bit))
+                   .arg(bit_stats.flips[bit])
+                   .arg(bit_stats.flipRatio(bit) * 100, 0, 'f', 1)
+                   .arg(bit_stats.onesRatio(bit) * 100, 0, 'f', 1)
+                   .arg(bit_stats.entropy(bit), 0, 'f', 2);
+  }
+  return tooltip.isEmpty() ? QVariant() : tooltip;
 }
 
 // BinaryItemDelegate
@@ -10,6 +10,7 @@
 
 #include "tools/cabana/dbc/dbcmanager.h"
 #include "tools/cabana/streams/abstractstream.h"
+#include "tools/cabana/utils/bitstats.h"
 
 class BinaryItemDelegate : public QStyledItemDelegate {
 public:
@@ -49,6 +50,9 @@ public:
     bool valid = false;
   };
   std::vector<Item> items;
+  // the heatmap shows the bit flips over the whole route, or the chart's time range
+  BitStatsIndex bit_index;
+  BitStats bit_stats;
 
   MessageId msg_id;
   int row_count = 0;
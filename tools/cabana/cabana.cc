@@ -35,6 +35,7 @@ int main(int argc, char *argv[]) {
   cmd_parser.addOption({"zmq", "the ip address on which to receive zmq messages", "zmq"});
   cmd_parser.addOption({"data_dir", "local directory with routes", "data_dir"});
   cmd_parser.addOption({"no-vipc", "do not output video"});
+  cmd_parser.addOption({"vipc", "also publish the video over VisionIPC, for other processes"});
   cmd_parser.addOption({"dbc", "dbc file to open", "dbc"});
   cmd_parser.process(app);
 
@@ -57,6 +58,8 @@ int main(int argc, char *argv[]) {
     if (cmd_parser.isSet("qcam")) replay_flags |= REPLAY_FLAG_QCAMERA;
     if (cmd_parser.isSet("dcam")) replay_flags |= REPLAY_FLAG_DCAM;
     if (cmd_parser.isSet("no-vipc")) replay_flags |= REPLAY_FLAG_NO_VIPC;
+    // the video view gets the frames in the process
+    if (!cmd_parser.isSet("vipc")) replay_flags |= REPLAY_FLAG_NO_VIPC_PUBLISH;
 
     const QStringList args = cmd_parser.positionalArguments();
     QString route;
@@ -11,7 +11,6 @@
 #include <QGraphicsItemGroup>
 #include <QGraphicsOpacityEffect>
 #include <QMimeData>
-#include <QOpenGLWidget>
 #include <QPropertyAnimation>
 #include <QRandomGenerator>
 #include <QRubberBand>
@@ -42,6 +41,14 @@ ChartView::ChartView(const std::pair<double, double> &x_range, ChartsWidget *par
   axis_x->setRange(x_range.first, x_range.second);
 
   tip_label = new TipLabel(this);
+  // TODO: Due to a bug in CameraWidget the camera frames
+  // are drawn instead of the graphs on MacOS. Use the GPU canvas when fixed
+#ifndef __APPLE__
+  canvas = new ChartCanvas(this, viewport());
+  QObject::connect(chart(), &QChart::plotAreaChanged, [this](const QRectF &plot_area) {
+    canvas->setGeometry(plot_area.toRect());
+  });
+#endif
   createToolButtons();
   setRubberBand(QChartView::HorizontalRubberBand);
   setMouseTracking(true);
@@ -138,6 +145,7 @@ void ChartView::removeIf(std::function<bool(const SigItem &s)> predicate) {
   int prev_size = sigs.size();
   for (auto it = sigs.begin(); it != sigs.end(); /**/) {
     if (predicate(*it)) {
+      if (canvas) canvas->seriesRemoved(it->sig);
       chart()->removeSeries(it->series);
       it->series->deleteLater();
       it = sigs.erase(it);
@@ -270,11 +278,7 @@ void ChartView::updateSeriesPoints() {
       double pixels_per_point = (chart()->mapToPosition(right_pt).x() - chart()->mapToPosition(*begin).x()) / num_points;
 
       if (series_type == SeriesType::Scatter) {
-        qreal size = std::clamp(pixels_per_point / 2.0, 2.0, 8.0);
-        if (s.series->useOpenGL()) {
-          size *= devicePixelRatioF();
-        }
-        ((QScatterSeries *)s.series)->setMarkerSize(size);
+        ((QScatterSeries *)s.series)->setMarkerSize(std::clamp(pixels_per_point / 2.0, 2.0, 8.0));
       } else {
         s.series->setPointsVisible(num_points == 1 || pixels_per_point > 20);
       }
@@ -305,18 +309,22 @@ void ChartView::updateSeries(const cabana::Signal *sig, const MessageEventsMap *
       if (!msg_new_events) {
         s.vals.clear();
         s.step_vals.clear();
+        if (canvas) canvas->seriesChanged(s.sig, 0);
       }
       auto events = msg_new_events ? msg_new_events : &can->eventsMap();
       auto it = events->find(s.msg_id);
       if (it == events->end() || it->second.empty()) continue;
 
+      size_t changed_from = s.vals.size();
       if (s.vals.empty() || can->toSeconds(it->second.back()->mono_time) > s.vals.back().x()) {
         appendCanEvents(s.sig, it->second, s.vals, s.step_vals);
       } else {
         std::vector<QPointF> vals, step_vals;
         appendCanEvents(s.sig, it->second, vals, step_vals);
-        s.vals.insert(std::lower_bound(s.vals.begin(), s.vals.end(), vals.front().x(), xLessThan),
-                      vals.begin(), vals.end());
+        if (vals.empty()) continue;
+        auto pos = s.vals.insert(std::lower_bound(s.vals.begin(), s.vals.end(), vals.front().x(), xLessThan),
+                                 vals.begin(), vals.end());
+        changed_from = std::distance(s.vals.begin(), pos);
         s.step_vals.insert(std::lower_bound(s.step_vals.begin(), s.step_vals.end(), step_vals.front().x(), xLessThan),
                            step_vals.begin(), step_vals.end());
       }
@@ -324,7 +332,12 @@ void ChartView::updateSeries(const cabana::Signal *sig, const MessageEventsMap *
       if (!can->liveStreaming()) {
         s.segment_tree.build(s.vals);
       }
-      s.series->replace(QVector<QPointF>::fromStdVector(series_type == SeriesType::StepLine ? s.step_vals : s.vals));
+      if (canvas) {
+        // the canvas only uploads the changed points, steps are drawn from vals by the shader
+        canvas->seriesChanged(s.sig, changed_from);
+      } else {
+        s.series->replace(QVector<QPointF>::fromStdVector(series_type == SeriesType::StepLine ? s.step_vals : s.vals));
+      }
     }
   }
   updateAxisY();
@@ -622,6 +635,7 @@ void ChartView::dropEvent(QDropEvent *event) {
       for (auto &s : source_chart->sigs) {
         source_chart->chart()->removeSeries(s.series);
         addSeries(s.series);
+        if (canvas) canvas->seriesChanged(s.sig, 0);
       }
       sigs.insert(sigs.end(), std::move_iterator(source_chart->sigs.begin()), std::move_iterator(source_chart->sigs.end()));
       updateAxisY();
@@ -639,6 +653,7 @@ void ChartView::dropEvent(QDropEvent *event) {
 void ChartView::resetChartCache() {
   chart_pixmap = QPixmap();
   viewport()->update();
+  if (canvas) canvas->update();
 }
 
 void ChartView::startAnimation() {
@@ -703,10 +718,10 @@ void ChartView::drawForeground(QPainter *painter, const QRectF &rect) {
     painter->drawLine(QPointF{track_line_x, plot_area.top()}, QPointF{track_line_x, plot_area.bottom()});
   }
 
-  // paint points. OpenGL mode lacks certain features (such as showing points)
+  // paint points. the canvas only draws the lines
   painter->setPen(Qt::NoPen);
   for (auto &s : sigs) {
-    if (s.series->useOpenGL() && s.series->isVisible() && s.series->pointsVisible()) {
+    if (canvas && s.series->isVisible() && s.series->pointsVisible()) {
       auto first = std::lower_bound(s.vals.cbegin(), s.vals.cend(), axis_x->min(), xLessThan);
       auto last = std::lower_bound(first, s.vals.cend(), axis_x->max(), xLessThan);
       painter->setBrush(s.series->color());
@@ -787,15 +802,6 @@ QXYSeries *ChartView::createSeries(SeriesType type, QColor color) {
     chart()->legend()->setMarkerShape(QLegend::MarkerShapeCircle);
   }
   series->setColor(color);
-  // TODO: Due to a bug in CameraWidget the camera frames
-  // are drawn instead of the graphs on MacOS. Re-enable OpenGL when fixed
-#ifndef __APPLE__
-  series->setUseOpenGL(true);
-  // Qt doesn't properly apply device pixel ratio in OpenGL mode
-  QPen pen = series->pen();
-  pen.setWidthF(2.0 * devicePixelRatioF());
-  series->setPen(pen);
-#endif
   addSeries(series);
   return series;
 }
@@ -805,13 +811,6 @@ void ChartView::addSeries(QXYSeries *series) {
   chart()->addSeries(series);
   series->attachAxis(axis_x);
   series->attachAxis(axis_y);
-
-  // disables the delivery of mouse events to the opengl widget.
-  // this enables the user to select the zoom area when the mouse press on the data point.
-  auto glwidget = findChild<QOpenGLWidget *>();
-  if (glwidget && !glwidget->testAttribute(Qt::WA_TransparentForMouseEvents)) {
-    glwidget->setAttribute(Qt::WA_TransparentForMouseEvents);
-  }
 }
 
 void ChartView::setSeriesColor(QXYSeries *series, QColor color) {
@@ -838,7 +837,9 @@ void ChartView::setSeriesType(SeriesType type) {
     }
     for (auto &s : sigs) {
       s.series = createSeries(series_type, s.sig->color);
-      s.series->replace(QVector<QPointF>::fromStdVector(series_type == SeriesType::StepLine ? s.step_vals : s.vals));
+      if (!canvas) {
+        s.series->replace(QVector<QPointF>::fromStdVector(series_type == SeriesType::StepLine ? s.step_vals : s.vals));
+      }
     }
     updateSeriesPoints();
     updateTitle();
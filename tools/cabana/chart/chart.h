@@ -14,16 +14,11 @@
 #include <QtCharts/QValueAxis>
 using namespace QtCharts;
 
+#include "tools/cabana/chart/chartcanvas.h"
 #include "tools/cabana/chart/tiplabel.h"
 #include "tools/cabana/dbc/dbcmanager.h"
 #include "tools/cabana/streams/abstractstream.h"
 
-enum class SeriesType {
-  Line = 0,
-  StepLine,
-  Scatter
-};
-
 class ChartsWidget;
 class ChartView : public QChartView {
   Q_OBJECT
@@ -109,6 +104,7 @@ private:
   QGraphicsProxyWidget *close_btn_proxy;
   QGraphicsProxyWidget *manage_btn_proxy;
   TipLabel *tip_label;
+  ChartCanvas *canvas = nullptr;
   std::vector<SigItem> sigs;
   double cur_sec = 0;
   SeriesType series_type = SeriesType::Line;
@@ -120,4 +116,5 @@ private:
   QFont signal_value_font;
   ChartsWidget *charts_widget;
   friend class ChartsWidget;
+  friend class ChartCanvas;
 };
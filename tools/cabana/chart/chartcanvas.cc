@@ -0,0 +1,246 @@
+#include "tools/cabana/chart/chartcanvas.h"
+
+#include <algorithm>
+
+#include "tools/cabana/chart/chart.h"
+
+namespace {
+
+const char series_vertex_shader[] =
+#ifdef __APPLE__
+  "#version 330 core\n"
+#else
+  "#version 300 es\n"
+#endif
+  "layout(location = 0) in vec3 aP0;\n"
+  "layout(location = 1) in vec3 aP1;\n"
+  "uniform vec2 uOffsetX;\n"
+  "uniform float uOffsetY;\n"
+  "uniform vec2 uScale;\n"
+  "uniform vec2 uViewport;\n"
+  "uniform float uWidth;\n"
+  "uniform int uMode;\n"
+  "out vec2 vCorner;\n"
+  "const vec2 corners[6] = vec2[6](vec2(0.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),\n"
+  "                                vec2(0.0, -1.0), vec2(1.0, 1.0), vec2(0.0, 1.0));\n"
+  "vec2 toNdc(vec3 p) {\n"
+  "  return vec2(((p.x - uOffsetX.x) + (p.y - uOffsetX.y)) * uScale.x, (p.z - uOffsetY) * uScale.y) - 1.0;\n"
+  "}\n"
+  "void main() {\n"
+  "  vec2 c = corners[gl_VertexID % 6];\n"
+  "  vec2 px = 2.0 / uViewport;\n"
+  "  vec2 a = toNdc(aP0);\n"
+  "  vec2 b = toNdc(aP1);\n"
+  "  if (uMode == 2) {\n"
+  // scatter: a quad around the point, the fragment shader cuts out the circle
+  "    vCorner = vec2(c.x * 2.0 - 1.0, c.y);\n"
+  "    gl_Position = vec4(a + vCorner * uWidth * 0.5 * px, 0.0, 1.0);\n"
+  "    return;\n"
+  "  }\n"
+  "  if (uMode == 1) {\n"
+  // step: the first six vertices draw the horizontal segment, the next six the vertical one
+  "    vec2 corner = vec2(b.x, a.y);\n"
+  "    if (gl_VertexID < 6) b = corner; else a = corner;\n"
+  "  }\n"
+  "  vec2 d = (b - a) / px;\n"
+  "  float len = length(d);\n"
+  "  d = len > 0.0001 ? d / len : vec2(1.0, 0.0);\n"
+  "  vec2 n = vec2(-d.y, d.x);\n"
+  "  vCorner = vec2(0.0, c.y);\n"
+  // square caps, so consecutive segments join without gaps
+  "  vec2 offset = (d * (c.x * 2.0 - 1.0) + n * c.y) * uWidth * 0.5 * px;\n"
+  "  gl_Position = vec4(mix(a, b, c.x) + offset, 0.0, 1.0);\n"
+  "}\n";
+
+const char series_fragment_shader[] =
+#ifdef __APPLE__
+  "#version 330 core\n"
+#else
+  "#version 300 es\n"
+  "precision highp float;\n"
+  "precision highp int;\n"
+#endif
+  "uniform vec4 uColor;\n"
+  "uniform int uMode;\n"
+  "in vec2 vCorner;\n"
+  "out vec4 colorOut;\n"
+  "void main() {\n"
+  "  if (uMode == 2 && dot(vCorner, vCorner) > 1.0) discard;\n"
+  "  colorOut = vec4(uColor.rgb * uColor.a, uColor.a);\n"
+  "}\n";
+
+}  // namespace
+
+// ChartRenderer
+
+void ChartRenderer::initialize() {
+  initializeOpenGLFunctions();
+
+  program = std::make_unique<QOpenGLShaderProgram>();
+  bool ret = program->addShaderFromSourceCode(QOpenGLShader::Vertex, series_vertex_shader);
+  assert(ret);
+  ret = program->addShaderFromSourceCode(QOpenGLShader::Fragment, series_fragment_shader);
+  assert(ret);
+  ret = program->link();
+  assert(ret);
+
+  loc.offset_x = program->uniformLocation("uOffsetX");
+  loc.offset_y = program->uniformLocation("uOffsetY");
+  loc.scale = program->uniformLocation("uScale");
+  loc.viewport = program->uniformLocation("uViewport");
+  loc.width = program->uniformLocation("uWidth");
+  loc.mode = program->uniformLocation("uMode");
+  loc.color = program->uniformLocation("uColor");
+
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribDivisor(0, 1);
+  glVertexAttribDivisor(1, 1);
+  glBindVertexArray(0);
+}
+
+void ChartRenderer::cleanup() {
+  for (auto &[_, b] : buffers) {
+    glDeleteBuffers(1, &b.vbo);
+  }
+  buffers.clear();
+  if (vao) {
+    glDeleteVertexArrays(1, &vao);
+    vao = 0;
+  }
+  program.reset();
+}
+
+void ChartRenderer::upload(const void *key, const std::vector<QPointF> &pts, size_t from) {
+  auto &b = buffers[key];
+  if (!b.vbo) glGenBuffers(1, &b.vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, b.vbo);
+
+  if (pts.size() > b.capacity) {
+    // grow geometrically so live streaming appends rarely reallocate
+    b.capacity = std::max<size_t>(pts.size() * 3 / 2, 1024);
+    glBufferData(GL_ARRAY_BUFFER, b.capacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    from = 0;
+  }
+  from = std::min(from, pts.size());
+  staging.resize(pts.size() - from);
+  for (size_t i = from; i < pts.size(); ++i) {
+    const float x_hi = pts[i].x();
+    staging[i - from] = {x_hi, (float)(pts[i].x() - x_hi), (float)pts[i].y()};
+  }
+  if (!staging.empty()) {
+    glBufferSubData(GL_ARRAY_BUFFER, from * sizeof(Vertex), staging.size() * sizeof(Vertex), staging.data());
+  }
+  b.size = pts.size();
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ChartRenderer::remove(const void *key) {
+  if (auto it = buffers.find(key); it != buffers.end()) {
+    glDeleteBuffers(1, &it->second.vbo);
+    buffers.erase(it);
+  }
+}
+
+void ChartRenderer::draw(const void *key, const std::vector<QPointF> &pts, SeriesType type, const View &view,
+                         float width, const QColor &color, const QSize &viewport) {
+  auto it = buffers.find(key);
+  if (it == buffers.end() || view.x_max <= view.x_min || view.y_max <= view.y_min) return;
+
+  // only the visible points plus one on each side
+  const size_t size = std::min(it->second.size, pts.size());
+  auto xLess = [](const QPointF &p, double x) { return p.x() < x; };
+  size_t first = std::lower_bound(pts.cbegin(), pts.cbegin() + size, view.x_min, xLess) - pts.cbegin();
+  size_t last = std::lower_bound(pts.cbegin() + first, pts.cbegin() + size, view.x_max, xLess) - pts.cbegin();
+  first = first > 0 ? first - 1 : 0;
+  last = std::min(last + 1, size);
+  const int instances = type == SeriesType::Scatter ? last - first : (int)(last - first) - 1;
+  if (instances <= 0) return;
+
+  glUseProgram(program->programId());
+  const float offset_hi = view.x_min;
+  glUniform2f(loc.offset_x, offset_hi, (float)(view.x_min - offset_hi));
+  glUniform1f(loc.offset_y, view.y_min);
+  glUniform2f(loc.scale, 2.0 / (view.x_max - view.x_min), 2.0 / (view.y_max - view.y_min));
+  glUniform2f(loc.viewport, viewport.width(), viewport.height());
+  glUniform1f(loc.width, width);
+  glUniform1i(loc.mode, (int)type);
+  glUniform4f(loc.color, color.redF(), color.greenF(), color.blueF(), color.alphaF());
+
+  // each instance is one segment (or marker), aP0 and aP1 are consecutive points of the same buffer
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, it->second.vbo);
+  const size_t next = type == SeriesType::Scatter ? first : first + 1;
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void *)(first * sizeof(Vertex)));
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void *)(next * sizeof(Vertex)));
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  glDrawArraysInstanced(GL_TRIANGLES, 0, type == SeriesType::StepLine ? 12 : 6, instances);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+  glUseProgram(0);
+}
+
+// ChartCanvas
+
+ChartCanvas::ChartCanvas(ChartView *view, QWidget *parent) : view(view), QOpenGLWidget(parent) {
+  setAttribute(Qt::WA_AlwaysStackOnTop);
+  setAttribute(Qt::WA_TransparentForMouseEvents);
+}
+
+ChartCanvas::~ChartCanvas() {
+  makeCurrent();
+  if (isValid()) {
+    renderer.cleanup();
+  }
+  doneCurrent();
+}
+
+void ChartCanvas::seriesChanged(const cabana::Signal *sig, size_t from) {
+  auto [it, inserted] = dirty.try_emplace(sig, from);
+  if (!inserted) it->second = std::min(it->second, from);
+}
+
+void ChartCanvas::seriesRemoved(const cabana::Signal *sig) {
+  dirty.erase(sig);
+  removed.push_back(sig);
+  update();
+}
+
+void ChartCanvas::initializeGL() {
+  renderer.initialize();
+  // buffers were lost with the previous context (e.g. after reparenting)
+  for (auto &s : view->sigs) {
+    dirty[s.sig] = 0;
+  }
+}
+
+void ChartCanvas::paintGL() {
+  glClearColor(0, 0, 0, 0);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  for (auto sig : removed) {
+    if (std::none_of(view->sigs.cbegin(), view->sigs.cend(), [sig](auto &s) { return s.sig == sig; })) {
+      renderer.remove(sig);
+    }
+  }
+  removed.clear();
+
+  const qreal dpr = devicePixelRatioF();
+  const QSize viewport = size() * dpr;
+  const ChartRenderer::View range = {view->axis_x->min(), view->axis_x->max(), view->axis_y->min(), view->axis_y->max()};
+  for (auto &s : view->sigs) {
+    if (auto it = dirty.find(s.sig); it != dirty.end()) {
+      renderer.upload(s.sig, s.vals, it->second);
+      dirty.erase(it);
+    }
+    if (s.series->isVisible()) {
+      float width = view->series_type == SeriesType::Scatter ? ((QScatterSeries *)s.series)->markerSize() : 2.0;
+      renderer.draw(s.sig, s.vals, view->series_type, range, width * dpr, s.series->color(), viewport);
+    }
+  }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <QColor>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLWidget>
+#include <QPointF>
+
+#include "tools/cabana/dbc/dbc.h"
+
+enum class SeriesType {
+  Line = 0,
+  StepLine,
+  Scatter
+};
+
+// Draws chart series from per-series vertex buffers. Points are only uploaded when they
+// change (appends upload just the new tail), zoom and pan only change the transform uniforms.
+// Lines, steps and scatter markers are expanded to triangles in the vertex shader, so the
+// output doesn't depend on the line widths supported by the driver.
+class ChartRenderer : protected QOpenGLExtraFunctions {
+public:
+  struct View {
+    double x_min, x_max;
+    double y_min, y_max;
+  };
+
+  // all calls need the context current
+  void initialize();
+  void cleanup();
+  // upload pts[from:] into the buffer of key. pts[:from] must be unchanged since the last upload.
+  void upload(const void *key, const std::vector<QPointF> &pts, size_t from);
+  void remove(const void *key);
+  // width is the line width or marker size in pixels.
+  void draw(const void *key, const std::vector<QPointF> &pts, SeriesType type, const View &view,
+            float width, const QColor &color, const QSize &viewport);
+
+private:
+  struct Vertex {
+    float x_hi, x_lo;  // x split in two floats, keeps precision when zoomed into a long route
+    float y;
+  };
+  struct Buffer {
+    GLuint vbo = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+  };
+
+  std::unique_ptr<QOpenGLShaderProgram> program;
+  GLuint vao = 0;
+  std::unordered_map<const void *, Buffer> buffers;
+  std::vector<Vertex> staging;
+  struct {
+    GLint offset_x, offset_y, scale, viewport, width, mode, color;
+  } loc = {};
+};
+
+class ChartView;
+
+// Transparent overlay on the plot area of a ChartView that renders its series with ChartRenderer.
+// QtCharts still draws the axes, legend and grid from the (empty) series.
+class ChartCanvas : public QOpenGLWidget {
+  Q_OBJECT
+
+public:
+  ChartCanvas(ChartView *view, QWidget *parent);
+  ~ChartCanvas();
+  // marks the uploaded points of sig from index `from` on as stale, the next paintGL re-uploads them.
+  // doesn't schedule a repaint. also called from the eventsMerged workers, which ChartsWidget joins before returning.
+  void seriesChanged(const cabana::Signal *sig, size_t from);
+  void seriesRemoved(const cabana::Signal *sig);
+
+protected:
+  void initializeGL() override;
+  void paintGL() override;
+
+  ChartView *view;
+  ChartRenderer renderer;
+  std::unordered_map<const cabana::Signal *, size_t> dirty;
+  std::vector<const cabana::Signal *> removed;
+};
@@ -68,7 +68,9 @@ void AddSigCommand::redo() {
     msg_created = true;
     dbc()->updateMsg(id, dbc()->newMsgName(id), can->lastMessage(id).dat.size(), "", "");
   }
-  signal.name = dbc()->newSignalName(id);
+  if (signal.name.isEmpty() || dbc()->msg(id)->sig(signal.name)) {
+    signal.name = dbc()->newSignalName(id);
+  }
   signal.max = std::pow(2, signal.size) - 1;
   dbc()->addSignal(id, signal);
 }
@@ -22,6 +22,7 @@
 
 #include "tools/cabana/commands.h"
 #include "tools/cabana/streamselector.h"
+#include "tools/cabana/tools/findcounters.h"
 #include "tools/cabana/tools/findsignal.h"
 #include "tools/cabana/utils/export.h"
 
@@ -146,6 +147,7 @@ void MainWindow::createActions() {
   tools_menu = menuBar()->addMenu(tr("&Tools"));
   tools_menu->addAction(tr("Find &Similar Bits"), this, &MainWindow::findSimilarBits);
   tools_menu->addAction(tr("&Find Signal"), this, &MainWindow::findSignal);
+  tools_menu->addAction(tr("Find &Counters && Checksums"), this, &MainWindow::findCounters);
 
   // Help Menu
   QMenu *help_menu = menuBar()->addMenu(tr("&Help"));
@@ -580,6 +582,12 @@ void MainWindow::findSignal() {
   dlg->show();
 }
 
+void MainWindow::findCounters() {
+  FindCountersDlg *dlg = new FindCountersDlg(this);
+  QObject::connect(dlg, &FindCountersDlg::openMessage, messages_widget, &MessagesWidget::selectMessage);
+  dlg->show();
+}
+
 void MainWindow::onlineHelp() {
   if (auto help = findChild<HelpOverlay*>()) {
     help->close();
@@ -65,6 +65,7 @@ protected:
   void setOption();
   void findSimilarBits();
   void findSignal();
+  void findCounters();
   void undoStackCleanChanged(bool clean);
   void onlineHelp();
   void toggleFullScreen();
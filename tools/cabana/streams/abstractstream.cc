@@ -3,16 +3,28 @@
 #include <utility>
 
 #include <QApplication>
+#include <QtConcurrent>
 #include "common/timing.h"
 #include "tools/cabana/settings.h"
 
 static const int EVENT_NEXT_BUFFER_SIZE = 6 * 1024 * 1024;  // 6MB
+static const double CHECKPOINT_INTERVAL = 15.0;  // seconds of route time
+// colors fade out within two seconds, so only the frames in this window go through the full compute() on seek
+static const double SEEK_EXACT_WINDOW = 2.0;
+// bound the work of a seek when the checkpoints of a message haven't been built yet
+static const int MAX_FAST_FORWARD_EVENTS = 200000;
+// merges within this window share one checkpoint rebuild per message
+static const int CHECKPOINT_DEBOUNCE_MS = 500;
 
 AbstractStream *can = nullptr;
 
 AbstractStream::AbstractStream(QObject *parent) : QObject(parent) {
   assert(parent != nullptr);
   event_buffer_ = std::make_unique<MonotonicBuffer>(EVENT_NEXT_BUFFER_SIZE);
+  checkpoint_pool_.setMaxThreadCount(1);
+  checkpoint_timer_.setSingleShot(true);
+  checkpoint_timer_.setInterval(CHECKPOINT_DEBOUNCE_MS);
+  QObject::connect(&checkpoint_timer_, &QTimer::timeout, this, &AbstractStream::scheduleCheckpoints);
 
   QObject::connect(this, &AbstractStream::privateUpdateLastMsgsSignal, this, &AbstractStream::updateLastMessages, Qt::QueuedConnection);
   QObject::connect(this, &AbstractStream::seekedTo, this, &AbstractStream::updateLastMsgsTo);
@@ -33,14 +45,22 @@ void AbstractStream::updateMasks() {
     }
   }
   // clear bit change counts
-  for (auto &[id, m] : messages_) {
-    auto &mask = masks_[id];
+  auto clear_masked = [](CanData &m, const std::vector<uint8_t> &mask) {
     const int size = std::min(mask.size(), m.last_changes.size());
     for (int i = 0; i < size; ++i) {
       for (int j = 0; j < 8; ++j) {
         if (((mask[i] >> (7 - j)) & 1) != 0) m.last_changes[i].bit_change_counts[j] = 0;
       }
     }
+  };
+  for (auto &[id, m] : messages_) {
+    clear_masked(m, masks_[id]);
+  }
+  std::lock_guard cp_lk(checkpoints_mutex_);
+  for (auto &[id, cps] : checkpoints_) {
+    if (auto mask = masks_.find(id); mask != masks_.end()) {
+      for (auto &cp : cps) clear_masked(cp.data, mask->second);
+    }
   }
 }
 
@@ -133,24 +153,55 @@ void AbstractStream::updateLastMsgsTo(double sec) {
   uint64_t last_ts = toMonoTime(sec);
   std::unordered_map<MessageId, CanData> msgs;
   msgs.reserve(events_.size());
+  std::unordered_map<MessageId, std::vector<uint8_t>> masks;
+  {
+    std::lock_guard lk(mutex_);
+    masks = masks_;
+  }
 
+  std::lock_guard lk(checkpoints_mutex_);
   for (const auto &[id, ev] : events_) {
     auto it = std::upper_bound(ev.begin(), ev.end(), last_ts, CompareCanEvent());
     if (it != ev.begin()) {
       auto &m = msgs[id];
-      double freq = 0;
+      auto first = ev.begin();
+      // Restore the nearest checkpoint before the target
+      if (auto cps = checkpoints_.find(id); cps != checkpoints_.end()) {
+        auto cp = std::upper_bound(cps->second.cbegin(), cps->second.cend(), last_ts,
+                                   [](uint64_t ts, const Checkpoint &c) { return ts < c.mono_time; });
+        if (cp != cps->second.cbegin()) {
+          m = std::prev(cp)->data;
+          first = std::upper_bound(ev.begin(), it, std::prev(cp)->mono_time, CompareCanEvent());
+        }
+      }
+      if (std::distance(first, it) > MAX_FAST_FORWARD_EVENTS) {
+        m = {};
+        first = it - MAX_FAST_FORWARD_EVENTS;
+      }
+
       // Keep suppressed bits.
       if (auto old_m = messages_.find(id); old_m != messages_.end()) {
-        freq = old_m->second.freq;
-        m.last_changes.reserve(old_m->second.last_changes.size());
-        std::transform(old_m->second.last_changes.cbegin(), old_m->second.last_changes.cend(),
-                       std::back_inserter(m.last_changes),
-                       [](const auto &change) { return CanData::ByteLastChange{.suppressed = change.suppressed}; });
+        const auto &old_changes = old_m->second.last_changes;
+        if (m.last_changes.empty()) {
+          m.last_changes.reserve(old_changes.size());
+          std::transform(old_changes.cbegin(), old_changes.cend(), std::back_inserter(m.last_changes),
+                         [](const auto &change) { return CanData::ByteLastChange{.suppressed = change.suppressed}; });
+        } else {
+          for (int i = 0; i < std::min(m.last_changes.size(), old_changes.size()); ++i) {
+            m.last_changes[i].suppressed = old_changes[i].suppressed;
+          }
+        }
       }
 
+      // Fast-forward over the gap, then run the last frames through compute() to get the colors
+      const auto &mask = masks[id];
       auto prev = std::prev(it);
-      m.compute(id, (*prev)->dat, (*prev)->size, toSeconds((*prev)->mono_time), getSpeed(), {}, freq);
-      m.count = std::distance(ev.begin(), prev) + 1;
+      auto exact = std::lower_bound(first, prev, toMonoTime(toSeconds((*prev)->mono_time) - SEEK_EXACT_WINDOW), CompareCanEvent());
+      m.fastForward(&*first, &*first + std::distance(first, exact), beginMonoTime(), mask);
+      for (; exact != it; ++exact) {
+        m.compute(id, (*exact)->dat, (*exact)->size, toSeconds((*exact)->mono_time), getSpeed(), mask);
+      }
+      m.count = std::distance(ev.begin(), it);
     }
   }
 
@@ -189,14 +240,106 @@ void AbstractStream::mergeEvents(const std::vector<const CanEvent *> &events) {
         auto &e = events_[id];
         auto pos = std::upper_bound(e.cbegin(), e.cend(), new_e.front()->mono_time, CompareCanEvent());
         e.insert(pos, new_e.cbegin(), new_e.cend());
+        auto [it, inserted] = dirty_checkpoints_.try_emplace(id, new_e.front()->mono_time);
+        if (!inserted) it->second = std::min(it->second, new_e.front()->mono_time);
       }
     }
+    if (!checkpoint_timer_.isActive()) checkpoint_timer_.start();
     auto pos = std::upper_bound(all_events_.cbegin(), all_events_.cend(), events.front()->mono_time, CompareCanEvent());
     all_events_.insert(pos, events.cbegin(), events.cend());
     emit eventsMerged(msg_events);
   }
 }
 
+void AbstractStream::waitForCheckpoints() {
+  checkpoint_timer_.stop();
+  scheduleCheckpoints();
+  checkpoint_pool_.waitForDone();
+}
+
+// Rebuild the checkpoints of the messages merged since the last call, from the last
+// checkpoint before the first new event. Queued builds run in order on a single thread.
+// A newer build of a message supersedes a queued one that hasn't started: it resumes
+// from the earliest pending resume time, so it covers the dropped build's range too.
+void AbstractStream::scheduleCheckpoints() {
+  for (const auto &[id, first_new_time] : dirty_checkpoints_) {
+    uint64_t resume_time = 0, generation = 0;
+    {
+      std::lock_guard lk(checkpoints_mutex_);
+      if (auto it = checkpoints_.find(id); it != checkpoints_.end()) {
+        auto cp = std::lower_bound(it->second.cbegin(), it->second.cend(), first_new_time,
+                                   [](const Checkpoint &c, uint64_t ts) { return c.mono_time < ts; });
+        if (cp != it->second.cbegin()) resume_time = std::prev(cp)->mono_time;
+      }
+      auto &pending = pending_builds_[id];
+      resume_time = pending.jobs > 0 ? std::min(resume_time, pending.resume_time) : resume_time;
+      pending.resume_time = resume_time;
+      generation = ++pending.generation;
+      ++pending.jobs;
+    }
+
+    std::vector<uint8_t> mask;
+    {
+      std::lock_guard lk(mutex_);
+      if (auto it = masks_.find(id); it != masks_.end()) mask = it->second;
+    }
+
+    const auto &ev = events_.at(id);
+    auto first = std::upper_bound(ev.cbegin(), ev.cend(), resume_time, CompareCanEvent());
+    QtConcurrent::run(&checkpoint_pool_, [this, id, generation, resume_time, events = std::vector<const CanEvent *>(first, ev.cend()),
+                                          begin_mono_time = beginMonoTime(), mask = std::move(mask)]() {
+      buildCheckpoints(id, generation, resume_time, events, begin_mono_time, mask);
+    });
+  }
+  dirty_checkpoints_.clear();
+}
+
+void AbstractStream::buildCheckpoints(const MessageId &id, uint64_t generation, uint64_t resume_time,
+                                      const std::vector<const CanEvent *> &events, uint64_t begin_mono_time,
+                                      const std::vector<uint8_t> &mask) {
+  auto finish_job = [this, &id]() {
+    if (auto it = pending_builds_.find(id); it != pending_builds_.end() && --it->second.jobs == 0) {
+      pending_builds_.erase(it);
+    }
+  };
+
+  CanData m;
+  {
+    std::lock_guard lk(checkpoints_mutex_);
+    if (pending_builds_[id].generation != generation) {
+      // superseded by a newer build of this message
+      finish_job();
+      return;
+    }
+    auto &cps = checkpoints_[id];
+    cps.erase(std::upper_bound(cps.begin(), cps.end(), resume_time,
+                               [](uint64_t ts, const Checkpoint &c) { return ts < c.mono_time; }),
+              cps.end());
+    if (!cps.empty()) m = cps.back().data;
+  }
+
+  std::vector<Checkpoint> new_cps;
+  const uint64_t interval = CHECKPOINT_INTERVAL * 1e9;
+  uint64_t last_cp_time = (resume_time == 0 && !events.empty()) ? events.front()->mono_time : resume_time;
+  for (auto first = events.cbegin(); first != events.cend();) {
+    auto last = std::lower_bound(first, events.cend(), last_cp_time + interval, CompareCanEvent());
+    if (last == events.cend()) break;
+
+    ++last;
+    m.fastForward(&*first, &*first + std::distance(first, last), begin_mono_time, mask);
+    first = last;
+    last_cp_time = (*std::prev(last))->mono_time;
+    auto &cp = new_cps.emplace_back(Checkpoint{.mono_time = last_cp_time, .data = m});
+    cp.data.colors.clear();
+    cp.data.colors.shrink_to_fit();
+  }
+
+  std::lock_guard lk(checkpoints_mutex_);
+  auto &cps = checkpoints_[id];
+  cps.insert(cps.end(), std::make_move_iterator(new_cps.begin()), std::make_move_iterator(new_cps.end()));
+  finish_job();
+}
+
 namespace {
 
 enum Color { GREYISH_BLUE, CYAN, RED};
@@ -297,3 +440,83 @@ void CanData::compute(const MessageId &msg_id, const uint8_t *can_data, const in
   }
   memcpy(dat.data(), can_data, size);
 }
+
+void CanData::fastForward(const CanEvent *const *first, const CanEvent *const *last, uint64_t begin_mono_time,
+                          const std::vector<uint8_t> &mask) {
+  constexpr uint64_t LANE_ONES = 0x0101010101010101ULL;
+  constexpr int FLUSH_INTERVAL = 255;  // each byte lane of the accumulators counts up to 255
+
+  // acc[w][bit] holds the change count of `bit` for the 8 bytes of word w, one per byte lane.
+  std::vector<std::array<uint64_t, 8>> acc;
+  std::vector<uint64_t> keep;  // bits that are neither suppressed nor masked, as compute() compares them
+  int pending = 0;
+
+  auto flush = [&]() {
+    for (int w = 0; w < acc.size(); ++w) {
+      for (int bit = 0; bit < 8; ++bit) {
+        for (int lane = 0; lane < 8 && w * 8 + lane < last_changes.size(); ++lane) {
+          last_changes[w * 8 + lane].bit_change_counts[7 - bit] += (acc[w][bit] >> (lane * 8)) & 0xFF;
+        }
+      }
+      acc[w].fill(0);
+    }
+    pending = 0;
+  };
+  auto reset_lanes = [&]() {
+    acc.assign((dat.size() + 7) / 8, {});
+    keep.assign(acc.size(), 0);
+    for (int i = 0; i < std::min(dat.size(), last_changes.size()); ++i) {
+      const uint8_t mask_byte = i < mask.size() ? ~mask[i] : 0xFF;
+      if (!last_changes[i].suppressed) keep[i / 8] |= (uint64_t)mask_byte << ((i % 8) * 8);
+    }
+  };
+
+  reset_lanes();
+  for (auto it = first; it != last; ++it) {
+    const CanEvent *e = *it;
+    const double sec = e->mono_time > begin_mono_time ? (e->mono_time - begin_mono_time) / 1e9 : 0;
+    ts = sec;
+    ++count;
+
+    if (dat.size() != e->size) {
+      flush();
+      dat.assign(e->dat, e->dat + e->size);
+      last_changes.resize(e->size);
+      std::for_each(last_changes.begin(), last_changes.end(), [sec](auto &c) { c.ts = sec; });
+      reset_lanes();
+      continue;
+    }
+
+    for (int w = 0; w < acc.size(); ++w) {
+      const int n = std::min<int>(8, e->size - w * 8);
+      uint64_t prev = 0, cur = 0;
+      memcpy(&prev, dat.data() + w * 8, n);
+      memcpy(&cur, e->dat + w * 8, n);
+      prev &= keep[w];
+      cur &= keep[w];
+      const uint64_t diff = prev ^ cur;
+      if (diff == 0) continue;
+
+      for (int bit = 0; bit < 8; ++bit) {
+        acc[w][bit] += (diff >> bit) & LANE_ONES;
+      }
+      for (uint64_t d = diff; d != 0;) {
+        const int lane = __builtin_ctzll(d) / 8;
+        d &= ~(0xFFULL << (lane * 8));
+        auto &last_change = last_changes[w * 8 + lane];
+        const int delta = (int)((cur >> (lane * 8)) & 0xFF) - (int)((prev >> (lane * 8)) & 0xFF);
+        last_change.same_delta_counter += std::signbit(delta) == std::signbit(last_change.delta) ? 1 : -4;
+        last_change.same_delta_counter = std::clamp(last_change.same_delta_counter, 0, 16);
+        last_change.ts = sec;
+        last_change.delta = delta;
+      }
+    }
+    memcpy(dat.data(), e->dat, e->size);
+    if (++pending == FLUSH_INTERVAL) flush();
+  }
+  flush();
+
+  if (colors.size() != dat.size()) {
+    colors.assign(dat.size(), QColor(0, 0, 0, 0));
+  }
+}
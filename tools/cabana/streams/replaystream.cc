@@ -56,6 +56,10 @@ bool ReplayStream::loadRoute(const QString &route, const QString &data_dir, uint
   QObject::connect(replay.get(), &Replay::seeking, this, &AbstractStream::seeking);
   QObject::connect(replay.get(), &Replay::seekedTo, this, &AbstractStream::seekedTo);
   QObject::connect(replay.get(), &Replay::segmentsMerged, this, &ReplayStream::mergeSegments);
+  // play the selected time range in a loop with its segments and frames kept in memory
+  QObject::connect(this, &AbstractStream::timeRangeChanged, this, [this](const auto &range) {
+    range ? replay->setLoop(range->first, range->second) : replay->clearLoop();
+  });
   bool success = replay->load();
   if (!success) {
     if (replay->lastRouteError() == RouteLoadError::AccessDenied) {
@@ -162,6 +166,7 @@ AbstractStream *OpenReplayWidget::open() {
     if (cameras[1]->isChecked()) flags |= REPLAY_FLAG_DCAM;
     if (cameras[2]->isChecked()) flags |= REPLAY_FLAG_ECAM;
     if (flags == REPLAY_FLAG_NONE && !cameras[0]->isChecked()) flags = REPLAY_FLAG_NO_VIPC;
+    flags |= REPLAY_FLAG_NO_VIPC_PUBLISH;
 
     if (replay_stream->loadRoute(route, data_dir, flags)) {
       return replay_stream.release();
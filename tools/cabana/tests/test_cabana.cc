@@ -1,9 +1,19 @@
 
 #undef INFO
 #include <QDir>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <random>
 
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch2/catch.hpp"
+#include "tools/cabana/chart/chartcanvas.h"
 #include "tools/cabana/dbc/dbcmanager.h"
+#include "tools/cabana/streams/abstractstream.h"
+#include "tools/cabana/tools/findcounters.h"
+#include "tools/cabana/utils/bitstats.h"
 
 const std::string TEST_RLOG_URL = "https://commadataci.blob.core.windows.net/openpilotci/0c94aa1e1296d7c6/2021-05-05--19-48-37/0/rlog.bz2";
 
@@ -155,3 +165,261 @@ TEST_CASE("parse_opendbc") {
   INFO(errors.join("\n").toStdString());
   REQUIRE(errors.empty());
 }
+
+TEST_CASE("CanData::fastForward") {
+  const uint64_t begin_mono_time = 1000;
+  std::mt19937 rng(42);
+  for (int size : {3, 8, 13, 64}) {
+    std::vector<std::unique_ptr<uint8_t[]>> buffer;
+    std::vector<const CanEvent *> events;
+    for (int i = 0; i < 3000; ++i) {
+      buffer.emplace_back(std::make_unique<uint8_t[]>(sizeof(CanEvent) + size));
+      CanEvent *e = (CanEvent *)buffer.back().get();
+      e->mono_time = begin_mono_time + i * 10000000ULL;
+      e->size = size;
+      for (int j = 0; j < size; ++j) {
+        e->dat[j] = (i == 0 || rng() % 4 == 0) ? rng() : events.back()->dat[j];
+      }
+      events.push_back(e);
+    }
+
+    CanData expected, data;
+    expected.last_changes.resize(size);
+    data.last_changes.resize(size);
+    expected.last_changes[1].suppressed = data.last_changes[1].suppressed = true;
+    // bits of defined signals, when suppress_defined_signals is on
+    const std::vector<uint8_t> mask = {0x00, 0x00, 0xF0};
+    for (auto e : events) {
+      expected.compute({}, e->dat, e->size, (e->mono_time - begin_mono_time) / 1e9, 1.0, mask, 100);
+    }
+    // resume from an intermediate state, as a seek does from a checkpoint
+    data.fastForward(events.data(), events.data() + 1000, begin_mono_time, mask);
+    data.fastForward(events.data() + 1000, events.data() + events.size(), begin_mono_time, mask);
+
+    REQUIRE(data.count == expected.count);
+    REQUIRE(data.ts == expected.ts);
+    REQUIRE(data.dat == expected.dat);
+    REQUIRE(data.colors.size() == size);
+    for (int i = 0; i < size; ++i) {
+      const auto &a = data.last_changes[i], &b = expected.last_changes[i];
+      REQUIRE(a.ts == b.ts);
+      REQUIRE(a.delta == b.delta);
+      REQUIRE(a.same_delta_counter == b.same_delta_counter);
+      REQUIRE(a.bit_change_counts == b.bit_change_counts);
+    }
+  }
+}
+
+TEST_CASE("BitStatsIndex") {
+  std::mt19937 rng(42);
+  std::vector<std::unique_ptr<uint8_t[]>> buffer;
+  auto make_event = [&](uint64_t mono_time, int size) {
+    buffer.emplace_back(std::make_unique<uint8_t[]>(sizeof(CanEvent) + size));
+    CanEvent *e = (CanEvent *)buffer.back().get();
+    e->mono_time = mono_time;
+    e->size = size;
+    for (int j = 0; j < size; ++j) e->dat[j] = rng() % 3 == 0 ? rng() : 0x5A;
+    return (const CanEvent *)e;
+  };
+  auto brute_force = [](const std::vector<const CanEvent *> &events, size_t first, size_t last, int bits) {
+    BitStats stats;
+    stats.count = last - first;
+    stats.ones.resize(bits);
+    stats.flips.resize(bits);
+    auto bit_value = [](const CanEvent *e, int bit) { return bit / 8 < e->size ? (e->dat[bit / 8] >> (7 - bit % 8)) & 1 : 0; };
+    for (size_t i = first; i < last; ++i) {
+      for (int bit = 0; bit < bits; ++bit) {
+        stats.ones[bit] += bit_value(events[i], bit);
+        if (i > first) stats.flips[bit] += bit_value(events[i], bit) != bit_value(events[i - 1], bit);
+      }
+    }
+    return stats;
+  };
+  auto require_equal = [](const BitStats &a, const BitStats &b) {
+    REQUIRE(a.count == b.count);
+    REQUIRE(a.ones == b.ones);
+    REQUIRE(a.flips == b.flips);
+  };
+
+  std::vector<const CanEvent *> events;
+  for (int i = 0; i < 1000; ++i) events.push_back(make_event(i * 100, 8));
+  BitStatsIndex index;
+  index.update(events);
+  REQUIRE(index.bits() == 64);
+
+  // appended events, including a longer frame
+  for (int i = 1000; i < 1300; ++i) events.push_back(make_event(i * 100, i == 1200 ? 12 : 8));
+  index.update(events);
+  REQUIRE(index.bits() == 96);
+
+  // events merged before the end rebuild the index
+  events.insert(events.begin() + 500, make_event(500 * 100 - 50, 8));
+  index.update(events);
+
+  for (int i = 0; i < 200; ++i) {
+    size_t first = rng() % events.size();
+    size_t last = first + rng() % (events.size() - first + 1);
+    require_equal(index.query(events, first, last), brute_force(events, first, last, index.bits()));
+  }
+  require_equal(index.query(events, 0, events.size()), brute_force(events, 0, events.size(), index.bits()));
+  require_equal(index.queryTime(events, 10000, 20000), brute_force(events, 100, 200, index.bits()));
+  REQUIRE(index.query(events, 10, 10).count == 0);
+
+  BitStats stats;
+  stats.count = 4;
+  stats.ones = {0, 2, 4};
+  REQUIRE(stats.entropy(0) == 0);
+  REQUIRE(stats.entropy(1) == Approx(1.0));
+  REQUIRE(stats.entropy(2) == 0);
+}
+
+// needs an X display for the GLX context (selfdrive/test/setup_xvfb.sh), exclude with "~[gl]" where there is none
+TEST_CASE("ChartRenderer", "[gl]") {
+  QOpenGLContext context;
+  QOffscreenSurface surface;
+  INFO("no OpenGL context, run under Xvfb or exclude the [gl] tests");
+  REQUIRE(context.create());
+  surface.setFormat(context.format());
+  surface.create();
+  REQUIRE(context.makeCurrent(&surface));
+
+  const int size = 64;
+  QOpenGLFramebufferObject fbo(size, size);
+  fbo.bind();
+  auto f = context.functions();
+  f->glViewport(0, 0, size, size);
+
+  ChartRenderer renderer;
+  renderer.initialize();
+  auto render = [&](const std::vector<QPointF> &pts, SeriesType type, const ChartRenderer::View &view) {
+    f->glClearColor(0, 0, 0, 0);
+    f->glClear(GL_COLOR_BUFFER_BIT);
+    renderer.draw(&pts, pts, type, view, 4, Qt::red, {size, size});
+    f->glFinish();
+    return fbo.toImage();
+  };
+  auto painted = [](const QImage &img, int x, int y) { return qAlpha(img.pixel(x, y)) > 0; };
+
+  // diagonal from bottom left to top right
+  std::vector<QPointF> pts = {{100.0, 0.0}, {110.0, 10.0}};
+  renderer.upload(&pts, pts, 0);
+  QImage img = render(pts, SeriesType::Line, {100, 110, 0, 10});
+  REQUIRE(painted(img, 32, 32));
+  REQUIRE(painted(img, 8, 56));
+  REQUIRE_FALSE(painted(img, 56, 56));
+
+  // appended points are drawn after a partial upload, panning only changes the view
+  pts.push_back({120.0, 0.0});
+  renderer.upload(&pts, pts, 2);
+  img = render(pts, SeriesType::Line, {110, 120, 0, 10});
+  REQUIRE(painted(img, 8, 8));
+  REQUIRE(painted(img, 56, 56));
+  REQUIRE_FALSE(painted(img, 8, 56));
+
+  // step line: horizontal along the bottom, then vertical at the right edge
+  img = render(pts, SeriesType::StepLine, {100, 110, 0, 10});
+  REQUIRE(painted(img, 32, size - 1));
+  REQUIRE(painted(img, size - 1, 32));
+  REQUIRE_FALSE(painted(img, 32, 32));
+
+  // zoomed into a long route, x precision is kept by the split float encoding
+  std::vector<QPointF> long_route = {{3600.0, 0.0}, {3600.001, 10.0}};
+  renderer.upload(&long_route, long_route, 0);
+  img = render(long_route, SeriesType::Line, {3600.0, 3600.001, 0, 10});
+  REQUIRE(painted(img, 32, 32));
+  REQUIRE_FALSE(painted(img, 56, 56));
+
+  renderer.cleanup();
+  fbo.release();
+  context.doneCurrent();
+}
+
+// frames with a 4-bit counter in the low nibble of byte 6 and a checksum in byte 7
+static std::vector<const CanEvent *> counterChecksumEvents(std::vector<std::unique_ptr<uint8_t[]>> &buffer, uint32_t address,
+                                                           size_t count, bool crc) {
+  std::mt19937 rng(7);
+  std::vector<const CanEvent *> events;
+  events.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    buffer.emplace_back(std::make_unique<uint8_t[]>(sizeof(CanEvent) + 8));
+    CanEvent *e = (CanEvent *)buffer.back().get();
+    e->address = address;
+    e->mono_time = i * 10000000ULL;
+    e->size = 8;
+    for (int j = 0; j < 7; ++j) e->dat[j] = rng();
+    e->dat[6] = (e->dat[6] & 0xF0) | (i & 0xF);
+    uint8_t checksum = crc ? 0xFF : (address & 0xFF) + (address >> 8) + 8;
+    for (int j = 0; j < 7; ++j) {
+      if (crc) {
+        checksum ^= e->dat[j];
+        for (int bit = 0; bit < 8; ++bit) checksum = (checksum & 0x80) ? (checksum << 1) ^ 0x1D : checksum << 1;
+      } else {
+        checksum += e->dat[j];
+      }
+    }
+    e->dat[7] = crc ? checksum ^ 0xFF : checksum;
+    events.push_back(e);
+  }
+  return events;
+}
+
+TEST_CASE("counters::analyzeMessage") {
+  std::vector<std::unique_ptr<uint8_t[]>> buffer;
+  const auto algorithms = counters::checksumAlgorithms({0x1D, 0x2F});
+  for (bool crc : {false, true}) {
+    const MessageId id = {.source = 0, .address = 0x2e4};
+    auto suggestions = counters::analyzeMessage(id, counterChecksumEvents(buffer, id.address, 1000, crc), algorithms);
+    REQUIRE(suggestions.size() == 2);
+    REQUIRE(suggestions[0].kind == counters::Suggestion::Counter);
+    REQUIRE((suggestions[0].byte_idx == 6 && suggestions[0].shift == 0 && suggestions[0].size == 4));
+    REQUIRE(suggestions[1].kind == counters::Suggestion::Checksum);
+    REQUIRE(suggestions[1].byte_idx == 7);
+    REQUIRE(suggestions[1].algorithm == (crc ? "CRC8 0x1d init 0xFF" : "SUM + address + length"));
+
+    auto sig = suggestions[0].toSignal();
+    const uint8_t dat[8] = {0, 0, 0, 0, 0, 0, 0xAB, 0};
+    REQUIRE(get_raw_value(dat, 8, sig) == 0xB);
+  }
+}
+
+TEST_CASE("counters::analyze benchmark", "[.][benchmark]") {
+  // 2 hours of 10 messages at 50Hz
+  std::vector<std::unique_ptr<uint8_t[]>> buffer;
+  std::vector<std::pair<MessageId, std::vector<const CanEvent *>>> samples;
+  for (uint32_t address = 0x100; address < 0x100 + 10; ++address) {
+    auto events = counterChecksumEvents(buffer, address, 2 * 3600 * 50, address % 2);
+    samples.emplace_back(MessageId{.source = 0, .address = address}, counters::sampleEvents(events));
+  }
+  const auto algorithms = counters::checksumAlgorithms({0x1D, 0x2F, 0x07});
+  BENCHMARK("analyze") {
+    return counters::analyze(samples, algorithms);
+  };
+}
+
+TEST_CASE("get_raw_value benchmark", "[.][benchmark]") {
+  DBCFile file("", R"(
+BO_ 160 message_1: 8 XXX
+  SG_ little : 0|12@1+ (1,0) [0|4095] "" XXX
+  SG_ big : 23|16@0- (0.01,0) [-327.68|327.67] "" XXX
+  SG_ flag : 40|1@1+ (1,0) [0|1] "" XXX
+  SG_ counter : 52|4@1+ (1,0) [0|15] "" XXX
+)");
+  auto msg = file.msg(160);
+  REQUIRE(msg != nullptr);
+  REQUIRE(msg->sigs.size() == 4);
+
+  // a minute of the message at 100Hz
+  std::mt19937 rng(42);
+  std::vector<uint8_t> frames(60 * 100 * 8);
+  for (auto &b : frames) b = rng() & 0xff;
+
+  BENCHMARK("decode") {
+    double sum = 0;
+    for (size_t i = 0; i < frames.size(); i += 8) {
+      for (auto sig : msg->sigs) {
+        sum += get_raw_value(&frames[i], 8, *sig);
+      }
+    }
+    return sum;
+  };
+}
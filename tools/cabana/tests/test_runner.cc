@@ -1,10 +1,18 @@
 #define CATCH_CONFIG_RUNNER
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch2/catch.hpp"
-#include <QCoreApplication>
+#include <QGuiApplication>
 
 int main(int argc, char **argv) {
-  // unit tests for Qt
-  QCoreApplication app(argc, argv);
+  // unit tests for Qt, the chart renderer tests need a QGuiApplication for OpenGL
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  // llvmpipe, so the renderer tests give the same pixels on any GPU or none
+  if (qEnvironmentVariableIsEmpty("LIBGL_ALWAYS_SOFTWARE")) {
+    qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+  }
+  QGuiApplication app(argc, argv);
   const int res = Catch::Session().run(argc, argv);
   return (res < 0xff ? res : 0xff);
 }
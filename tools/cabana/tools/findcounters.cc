@@ -0,0 +1,342 @@
+#include "tools/cabana/tools/findcounters.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <numeric>
+
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QVBoxLayout>
+#include <QtConcurrent>
+
+#include "common/timing.h"
+#include "tools/cabana/commands.h"
+
+namespace counters {
+
+const int MIN_FRAMES = 32;
+const int SAMPLE_WINDOWS = 4;
+const int SAMPLE_WINDOW_SIZE = 5000;
+const double MIN_COUNTER_CONFIDENCE = 0.95;
+const double MIN_CHECKSUM_CONFIDENCE = 0.98;
+const int CHECKSUM_SCREEN_FRAMES = 32;
+
+cabana::Signal Suggestion::toSignal() const {
+  cabana::Signal sig = {};
+  sig.name = kind == Counter ? "COUNTER" : "CHECKSUM";
+  sig.start_bit = byte_idx * 8 + shift;
+  sig.size = size;
+  sig.is_little_endian = true;
+  sig.is_signed = false;
+  sig.min = 0;
+  sig.max = (1 << size) - 1;
+  if (kind == Checksum) sig.comment = algorithm;
+  updateMsbLsb(sig);
+  return sig;
+}
+
+std::vector<ChecksumAlgorithm> checksumAlgorithms(const std::vector<uint8_t> &crc_polys) {
+  std::vector<ChecksumAlgorithm> algorithms = {
+    {.name = "XOR", .type = ChecksumAlgorithm::Xor},
+    {.name = "SUM", .type = ChecksumAlgorithm::Sum},
+    {.name = "SUM inverted", .type = ChecksumAlgorithm::SumInverted},
+    {.name = "SUM + address + length", .type = ChecksumAlgorithm::SumWithAddress},
+  };
+  for (uint8_t poly : crc_polys) {
+    QString name = QString("CRC8 0x%1").arg(poly, 2, 16, QLatin1Char('0'));
+    algorithms.push_back({.name = name + " init 0xFF", .type = ChecksumAlgorithm::Crc8, .poly = poly, .init = 0xFF, .xor_out = 0xFF});
+    algorithms.push_back({.name = name, .type = ChecksumAlgorithm::Crc8, .poly = poly, .init = 0x00, .xor_out = 0x00});
+  }
+  return algorithms;
+}
+
+std::vector<const CanEvent *> sampleEvents(const std::vector<const CanEvent *> &events) {
+  if (events.size() <= SAMPLE_WINDOWS * SAMPLE_WINDOW_SIZE) return events;
+
+  std::vector<const CanEvent *> samples;
+  samples.reserve(SAMPLE_WINDOWS * SAMPLE_WINDOW_SIZE);
+  const size_t stride = (events.size() - SAMPLE_WINDOW_SIZE) / (SAMPLE_WINDOWS - 1);
+  for (int w = 0; w < SAMPLE_WINDOWS; ++w) {
+    auto first = events.begin() + w * stride;
+    samples.insert(samples.end(), first, first + SAMPLE_WINDOW_SIZE);
+  }
+  return samples;
+}
+
+static std::array<uint8_t, 256> crc8Table(uint8_t poly) {
+  std::array<uint8_t, 256> table;
+  for (int i = 0; i < 256; ++i) {
+    uint8_t crc = i;
+    for (int j = 0; j < 8; ++j) {
+      crc = (crc & 0x80) ? (crc << 1) ^ poly : (crc << 1);
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+// A counter increments by one (mod 2^size) every frame. Larger fields are tried first, the
+// lower bits of a counter also count and are skipped once the larger field is accepted.
+static void findCounters(const MessageId &id, const std::vector<std::vector<uint8_t>> &cols, int n,
+                         std::vector<uint8_t> &counter_bits, std::vector<Suggestion> &result) {
+  for (int k = 0; k < cols.size(); ++k) {
+    const uint8_t *c = cols[k].data();
+    for (int size : {8, 4, 3, 2}) {
+      for (int shift = 0; shift + size <= 8; ++shift) {
+        const uint8_t field_mask = ((1u << size) - 1) << shift;
+        if (counter_bits[k] & field_mask) continue;
+
+        // higher bits cancel out in the masked difference. (auto-vectorized)
+        const uint8_t mask = (1u << size) - 1;
+        int matches = 0;
+        for (int i = 0; i < n - 1; ++i) {
+          matches += (uint8_t)(((c[i + 1] >> shift) - (c[i] >> shift) - 1) & mask) == 0;
+        }
+        if (double confidence = matches / double(n - 1); confidence >= MIN_COUNTER_CONFIDENCE) {
+          counter_bits[k] |= field_mask;
+          result.push_back({.id = id, .kind = Suggestion::Counter, .byte_idx = k, .shift = shift, .size = size,
+                            .frames = n, .confidence = confidence});
+        }
+      }
+    }
+  }
+}
+
+static void findChecksums(const MessageId &id, const std::vector<std::vector<uint8_t>> &cols, const std::vector<uint8_t> &rows,
+                          int n, const std::vector<ChecksumAlgorithm> &algorithms,
+                          const std::vector<uint8_t> &counter_bits, std::vector<Suggestion> &result) {
+  const int size = cols.size();
+
+  // XOR and sum of all bytes per frame, the checksum byte is removed again per candidate. (auto-vectorized)
+  std::vector<uint8_t> total_xor(n, 0), total_sum(n, 0);
+  for (const auto &col : cols) {
+    for (int i = 0; i < n; ++i) {
+      total_xor[i] ^= col[i];
+      total_sum[i] += col[i];
+    }
+  }
+  const uint8_t addr_len_sum = (id.address & 0xFF) + ((id.address >> 8) & 0xFF) + ((id.address >> 16) & 0xFF) +
+                               ((id.address >> 24) & 0xFF) + size;
+
+  std::vector<std::array<uint8_t, 256>> crc_tables;
+  for (const auto &algo : algorithms) {
+    crc_tables.push_back(algo.type == ChecksumAlgorithm::Crc8 ? crc8Table(algo.poly) : std::array<uint8_t, 256>{});
+  }
+  auto crc = [&](int algo_idx, int row, int skip) {
+    const auto &table = crc_tables[algo_idx];
+    const uint8_t *dat = &rows[row * size];
+    uint8_t v = algorithms[algo_idx].init;
+    for (int j = 0; j < size; ++j) {
+      if (j != skip) v = table[v ^ dat[j]];
+    }
+    return (uint8_t)(v ^ algorithms[algo_idx].xor_out);
+  };
+
+  std::vector<uint8_t> expected(n);
+  for (int k = 0; k < size; ++k) {
+    const uint8_t *c = cols[k].data();
+    if (counter_bits[k] == 0xFF) continue;
+
+    // the checksum must depend on the data
+    std::bitset<256> values;
+    for (int i = 0; i < n; ++i) values.set(c[i]);
+    if (values.count() < 4) continue;
+
+    for (int a = 0; a < algorithms.size(); ++a) {
+      switch (algorithms[a].type) {
+        case ChecksumAlgorithm::Xor:
+          for (int i = 0; i < n; ++i) expected[i] = total_xor[i] ^ c[i];
+          break;
+        case ChecksumAlgorithm::Sum:
+          for (int i = 0; i < n; ++i) expected[i] = total_sum[i] - c[i];
+          break;
+        case ChecksumAlgorithm::SumInverted:
+          for (int i = 0; i < n; ++i) expected[i] = ~(uint8_t)(total_sum[i] - c[i]);
+          break;
+        case ChecksumAlgorithm::SumWithAddress:
+          for (int i = 0; i < n; ++i) expected[i] = total_sum[i] - c[i] + addr_len_sum;
+          break;
+        case ChecksumAlgorithm::Crc8: {
+          // CRCs are serial per frame, screen on the first frames before running all of them
+          const int screen = std::min(n, CHECKSUM_SCREEN_FRAMES);
+          int screen_matches = 0;
+          for (int i = 0; i < screen; ++i) screen_matches += crc(a, i, k) == c[i];
+          if (screen_matches < screen - 1) continue;
+          for (int i = 0; i < n; ++i) expected[i] = crc(a, i, k);
+          break;
+        }
+      }
+
+      int matches = 0;
+      for (int i = 0; i < n; ++i) matches += expected[i] == c[i];
+      if (double confidence = matches / double(n); confidence >= MIN_CHECKSUM_CONFIDENCE) {
+        result.push_back({.id = id, .kind = Suggestion::Checksum, .byte_idx = k, .shift = 0, .size = 8,
+                          .algorithm = algorithms[a].name, .frames = n, .confidence = confidence});
+        break;
+      }
+    }
+  }
+}
+
+std::vector<Suggestion> analyzeMessage(const MessageId &id, const std::vector<const CanEvent *> &events,
+                                       const std::vector<ChecksumAlgorithm> &algorithms) {
+  // only frames of the most common length
+  std::array<int, 256> size_counts = {};
+  for (auto e : events) ++size_counts[e->size];
+  const int size = std::max_element(size_counts.begin(), size_counts.end()) - size_counts.begin();
+  const int n = size_counts[size];
+  if (size == 0 || n < MIN_FRAMES) return {};
+
+  // column-major copy for the per-byte loops, row-major for CRCs
+  std::vector<std::vector<uint8_t>> cols(size, std::vector<uint8_t>(n));
+  std::vector<uint8_t> rows(n * size);
+  int i = 0;
+  for (auto e : events) {
+    if (e->size != size) continue;
+    memcpy(&rows[i * size], e->dat, size);
+    for (int k = 0; k < size; ++k) cols[k][i] = e->dat[k];
+    ++i;
+  }
+
+  std::vector<Suggestion> result;
+  std::vector<uint8_t> counter_bits(size, 0);
+  findCounters(id, cols, n, counter_bits, result);
+  findChecksums(id, cols, rows, n, algorithms, counter_bits, result);
+  return result;
+}
+
+std::vector<Suggestion> analyze(const std::vector<std::pair<MessageId, std::vector<const CanEvent *>>> &samples,
+                                const std::vector<ChecksumAlgorithm> &algorithms) {
+  std::vector<std::vector<Suggestion>> results(samples.size());
+  std::vector<int> indices(samples.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  QtConcurrent::blockingMap(indices, [&](int &i) {
+    results[i] = analyzeMessage(samples[i].first, samples[i].second, algorithms);
+  });
+
+  std::vector<Suggestion> suggestions;
+  for (auto &r : results) {
+    suggestions.insert(suggestions.end(), r.begin(), r.end());
+  }
+  std::sort(suggestions.begin(), suggestions.end(), [](auto &l, auto &r) {
+    return std::tie(l.id, l.byte_idx, l.shift) < std::tie(r.id, r.byte_idx, r.shift);
+  });
+  return suggestions;
+}
+
+}  // namespace counters
+
+// FindCountersDlg
+
+FindCountersDlg::FindCountersDlg(QWidget *parent) : QDialog(parent, Qt::WindowFlags() | Qt::Window) {
+  setWindowTitle(tr("Find Counters && Checksums"));
+  setAttribute(Qt::WA_DeleteOnClose);
+
+  QVBoxLayout *main_layout = new QVBoxLayout(this);
+  QHBoxLayout *hlayout = new QHBoxLayout();
+  hlayout->addWidget(new QLabel(tr("CRC8 polynomials")));
+  hlayout->addWidget(polys_edit = new QLineEdit("1D, 2F, 07", this));
+  polys_edit->setPlaceholderText(tr("comma-seperated hex values"));
+  hlayout->addWidget(analyze_btn = new QPushButton(tr("&Analyze"), this));
+  hlayout->addStretch(0);
+  main_layout->addLayout(hlayout);
+
+  table = new QTableWidget(this);
+  table->setSelectionBehavior(QAbstractItemView::SelectRows);
+  table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  table->horizontalHeader()->setStretchLastSection(true);
+  main_layout->addWidget(table);
+
+  hlayout = new QHBoxLayout();
+  hlayout->addWidget(stats_label = new QLabel(this));
+  hlayout->addStretch(0);
+  hlayout->addWidget(create_btn = new QPushButton(tr("&Create Selected Signals"), this));
+  create_btn->setEnabled(false);
+  main_layout->addLayout(hlayout);
+
+  setMinimumSize({700, 500});
+  QObject::connect(analyze_btn, &QPushButton::clicked, this, &FindCountersDlg::analyze);
+  QObject::connect(create_btn, &QPushButton::clicked, this, &FindCountersDlg::createSignals);
+  QObject::connect(&watcher, &QFutureWatcherBase::finished, this, &FindCountersDlg::analysisFinished);
+  QObject::connect(table, &QTableWidget::itemSelectionChanged, [this]() {
+    create_btn->setEnabled(!table->selectionModel()->selectedRows().isEmpty());
+  });
+  QObject::connect(table, &QTableWidget::doubleClicked, [this](const QModelIndex &index) {
+    if (index.isValid()) emit openMessage(suggestions[index.row()].id);
+  });
+}
+
+FindCountersDlg::~FindCountersDlg() {
+  watcher.waitForFinished();
+}
+
+void FindCountersDlg::analyze() {
+  std::vector<uint8_t> polys;
+  for (auto poly : polys_edit->text().split(",")) {
+    bool ok = false;
+    uint32_t v = poly.trimmed().toUInt(&ok, 16);
+    if (ok && v > 0 && v <= 0xFF) polys.push_back(v);
+  }
+
+  // sample on the UI thread, the events map may change while the analysis runs
+  std::vector<std::pair<MessageId, std::vector<const CanEvent *>>> samples;
+  for (const auto &[id, events] : can->eventsMap()) {
+    samples.emplace_back(id, counters::sampleEvents(events));
+  }
+
+  analyze_btn->setEnabled(false);
+  create_btn->setEnabled(false);
+  analyze_btn->setText(tr("Analyzing ..."));
+  analyze_start = millis_since_boot();
+  watcher.setFuture(QtConcurrent::run([samples = std::move(samples), algorithms = counters::checksumAlgorithms(polys)]() {
+    return counters::analyze(samples, algorithms);
+  }));
+}
+
+void FindCountersDlg::analysisFinished() {
+  suggestions = watcher.result();
+  // skip bits already covered by signals
+  suggestions.erase(std::remove_if(suggestions.begin(), suggestions.end(), [](auto &s) {
+    auto msg = dbc()->msg(s.id);
+    return msg && s.byte_idx < msg->mask.size() && (msg->mask[s.byte_idx] & (((1u << s.size) - 1) << s.shift));
+  }), suggestions.end());
+
+  table->clear();
+  table->setRowCount(suggestions.size());
+  table->setColumnCount(6);
+  table->setHorizontalHeaderLabels({"Message", "Type", "Byte", "Bits", "Algorithm", "Confidence"});
+  for (int i = 0; i < suggestions.size(); ++i) {
+    auto &s = suggestions[i];
+    table->setItem(i, 0, new QTableWidgetItem(QString("%1 (%2)").arg(msgName(s.id), s.id.toString())));
+    table->setItem(i, 1, new QTableWidgetItem(s.kind == counters::Suggestion::Counter ? tr("Counter") : tr("Checksum")));
+    table->setItem(i, 2, new QTableWidgetItem(QString::number(s.byte_idx)));
+    table->setItem(i, 3, new QTableWidgetItem(QString("%1-%2").arg(s.shift).arg(s.shift + s.size - 1)));
+    table->setItem(i, 4, new QTableWidgetItem(s.algorithm));
+    table->setItem(i, 5, new QTableWidgetItem(QString("%1% of %2 frames").arg(s.confidence * 100, 0, 'f', 1).arg(s.frames)));
+  }
+
+  analyze_btn->setEnabled(true);
+  analyze_btn->setText(tr("&Analyze"));
+  stats_label->setText(tr("%1 suggestions in %2 ms. double click to open message")
+                           .arg(suggestions.size()).arg(millis_since_boot() - analyze_start, 0, 'f', 0));
+}
+
+void FindCountersDlg::createSignals() {
+  auto rows = table->selectionModel()->selectedRows();
+  if (rows.isEmpty()) return;
+  std::sort(rows.begin(), rows.end(), [](auto &l, auto &r) { return l.row() < r.row(); });
+
+  UndoStack::instance()->beginMacro(tr("add %1 counter/checksum signals").arg(rows.size()));
+  for (const auto &index : rows) {
+    const auto &s = suggestions[index.row()];
+    UndoStack::push(new AddSigCommand(s.id, s.toSignal()));
+  }
+  UndoStack::instance()->endMacro();
+
+  // don't offer them again
+  for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
+    suggestions.erase(suggestions.begin() + it->row());
+    table->removeRow(it->row());
+  }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include <QDialog>
+#include <QFutureWatcher>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTableWidget>
+
+#include "tools/cabana/dbc/dbcmanager.h"
+#include "tools/cabana/streams/abstractstream.h"
+
+namespace counters {
+
+struct ChecksumAlgorithm {
+  enum Type { Xor, Sum, SumInverted, SumWithAddress, Crc8 };
+  QString name;
+  Type type;
+  uint8_t poly = 0, init = 0, xor_out = 0;
+};
+
+struct Suggestion {
+  enum Kind { Counter, Checksum };
+  MessageId id;
+  Kind kind;
+  int byte_idx;
+  int shift;  // field is bits [shift, shift + size) of byte_idx
+  int size;
+  QString algorithm;
+  int frames;
+  double confidence;
+
+  cabana::Signal toSignal() const;
+};
+
+// XOR, sums and CRC8 for each of the polynomials, with both zero and 0xFF init/xor-out.
+std::vector<ChecksumAlgorithm> checksumAlgorithms(const std::vector<uint8_t> &crc_polys);
+// Pick up to a few windows of consecutive frames spread over the route. Detection only looks
+// at the samples, so the analysis time doesn't grow with the route length.
+std::vector<const CanEvent *> sampleEvents(const std::vector<const CanEvent *> &events);
+// events must be consecutive frames of one message (a sample from sampleEvents)
+std::vector<Suggestion> analyzeMessage(const MessageId &id, const std::vector<const CanEvent *> &events,
+                                       const std::vector<ChecksumAlgorithm> &algorithms);
+// analyze messages in parallel
+std::vector<Suggestion> analyze(const std::vector<std::pair<MessageId, std::vector<const CanEvent *>>> &samples,
+                                const std::vector<ChecksumAlgorithm> &algorithms);
+
+}  // namespace counters
+
+class FindCountersDlg : public QDialog {
+  Q_OBJECT
+
+public:
+  FindCountersDlg(QWidget *parent);
+  ~FindCountersDlg();
+
+signals:
+  void openMessage(const MessageId &msg_id);
+
+private:
+  void analyze();
+  void analysisFinished();
+  void createSignals();
+
+  QLineEdit *polys_edit;
+  QPushButton *analyze_btn, *create_btn;
+  QTableWidget *table;
+  QLabel *stats_label;
+  QFutureWatcher<std::vector<counters::Suggestion>> watcher;
+  std::vector<counters::Suggestion> suggestions;
+  double analyze_start = 0;
+};
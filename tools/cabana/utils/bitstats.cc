@@ -0,0 +1,115 @@
+#include "tools/cabana/utils/bitstats.h"
+
+#include <algorithm>
+#include <cmath>
+
+static inline int bit_value(const CanEvent *e, int bit) {
+  int byte = bit / 8;
+  return byte < e->size ? (e->dat[byte] >> (7 - bit % 8)) & 1 : 0;
+}
+
+// add the ones of events [first, last) and the flips between them and their previous event
+static void accumulate(const std::vector<const CanEvent *> &events, size_t first, size_t last, int bits,
+                       uint32_t *ones, uint32_t *flips) {
+  for (size_t i = first; i < last; ++i) {
+    const CanEvent *e = events[i];
+    const CanEvent *prev = i > 0 ? events[i - 1] : nullptr;
+    const int bytes = std::min<int>(e->size, bits / 8);
+    for (int byte = 0; byte < bytes; ++byte) {
+      uint8_t val = e->dat[byte];
+      uint8_t changed = prev ? val ^ (byte < prev->size ? prev->dat[byte] : 0) : 0;
+      if ((val | changed) == 0) continue;
+      for (int j = 0; j < 8; ++j) {
+        ones[byte * 8 + j] += (val >> (7 - j)) & 1;
+        flips[byte * 8 + j] += (changed >> (7 - j)) & 1;
+      }
+    }
+    // bytes missing in this event but set in the previous one
+    if (prev && prev->size > bytes) {
+      for (int bit = bytes * 8; bit < std::min<int>(prev->size * 8, bits); ++bit) {
+        flips[bit] += bit_value(prev, bit);
+      }
+    }
+  }
+}
+
+double BitStats::entropy(int bit) const {
+  double p = onesRatio(bit);
+  if (p <= 0 || p >= 1) return 0;
+  return -p * std::log2(p) - (1 - p) * std::log2(1 - p);
+}
+
+void BitStatsIndex::clear() {
+  bits_ = 0;
+  indexed_ = 0;
+  last_event_ = nullptr;
+  block_ones_.clear();
+  block_flips_.clear();
+  ones_.clear();
+  flips_.clear();
+}
+
+void BitStatsIndex::update(const std::vector<const CanEvent *> &events) {
+  int max_size = 0;
+  for (size_t i = indexed_; i < events.size(); ++i) {
+    max_size = std::max<int>(max_size, events[i]->size);
+  }
+  // merged events were inserted before the end of the index, or a longer frame showed up
+  bool appended = indexed_ <= events.size() && (indexed_ == 0 || events[indexed_ - 1] == last_event_);
+  if (!appended || max_size * 8 > bits_) {
+    clear();
+    for (auto e : events) bits_ = std::max<int>(bits_, e->size * 8);
+    ones_.resize(bits_, 0);
+    flips_.resize(bits_, 0);
+  }
+
+  while (indexed_ < events.size()) {
+    if (indexed_ % BLOCK == 0) {
+      block_ones_.insert(block_ones_.end(), ones_.begin(), ones_.end());
+      block_flips_.insert(block_flips_.end(), flips_.begin(), flips_.end());
+    }
+    size_t next = std::min((indexed_ / BLOCK + 1) * BLOCK, events.size());
+    accumulate(events, indexed_, next, bits_, ones_.data(), flips_.data());
+    indexed_ = next;
+  }
+  last_event_ = indexed_ > 0 ? events[indexed_ - 1] : nullptr;
+}
+
+void BitStatsIndex::prefix(const std::vector<const CanEvent *> &events, size_t n, uint32_t *ones, uint32_t *flips) const {
+  size_t block = n / BLOCK;
+  if (block * bits_ < block_ones_.size()) {
+    std::copy_n(block_ones_.begin() + block * bits_, bits_, ones);
+    std::copy_n(block_flips_.begin() + block * bits_, bits_, flips);
+    accumulate(events, block * BLOCK, n, bits_, ones, flips);
+  } else {
+    // n == indexed_ at a block boundary
+    std::copy(ones_.begin(), ones_.end(), ones);
+    std::copy(flips_.begin(), flips_.end(), flips);
+  }
+}
+
+BitStats BitStatsIndex::query(const std::vector<const CanEvent *> &events, size_t first, size_t last) const {
+  BitStats stats;
+  stats.ones.resize(bits_);
+  stats.flips.resize(bits_);
+  last = std::min(last, indexed_);
+  if (first >= last) return stats;
+
+  stats.count = last - first;
+  std::vector<uint32_t> ones(bits_), flips(bits_), begin_ones(bits_), begin_flips(bits_), unused(bits_);
+  prefix(events, last, ones.data(), flips.data());
+  prefix(events, first, begin_ones.data(), unused.data());
+  // the flip into the first event is outside of the range
+  prefix(events, first + 1, unused.data(), begin_flips.data());
+  for (int i = 0; i < bits_; ++i) {
+    stats.ones[i] = ones[i] - begin_ones[i];
+    stats.flips[i] = flips[i] - begin_flips[i];
+  }
+  return stats;
+}
+
+BitStats BitStatsIndex::queryTime(const std::vector<const CanEvent *> &events, uint64_t begin_mono_time, uint64_t end_mono_time) const {
+  auto first = std::lower_bound(events.begin(), events.begin() + indexed_, begin_mono_time, CompareCanEvent());
+  auto last = std::lower_bound(first, events.begin() + indexed_, end_mono_time, CompareCanEvent());
+  return query(events, first - events.begin(), last - events.begin());
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tools/cabana/streams/abstractstream.h"
+
+// Statistics of every bit of a message over a range of its events. Bit i is bit 7 - i % 8 of
+// byte i / 8, in the order of the binary view.
+struct BitStats {
+  uint32_t count = 0;
+  std::vector<uint32_t> ones;
+  std::vector<uint32_t> flips;  // changes between consecutive events
+
+  inline double onesRatio(int bit) const { return count > 0 ? ones[bit] / (double)count : 0; }
+  inline double flipRatio(int bit) const { return count > 1 ? flips[bit] / (double)(count - 1) : 0; }
+  // in bits, 0 for a constant bit and 1 for a bit that is set half of the time
+  double entropy(int bit) const;
+};
+
+// Prefix sums of the ones and flips of every bit of a message, stored every BLOCK events. The
+// stats of any range of events then only scan the two partial blocks at its ends.
+class BitStatsIndex {
+public:
+  // index new events, events appended since the last update are added to the existing index
+  void update(const std::vector<const CanEvent *> &events);
+  // stats of events [first, last), the events must be the ones of the last update
+  BitStats query(const std::vector<const CanEvent *> &events, size_t first, size_t last) const;
+  // stats of the events in [begin_mono_time, end_mono_time)
+  BitStats queryTime(const std::vector<const CanEvent *> &events, uint64_t begin_mono_time, uint64_t end_mono_time) const;
+  void clear();
+  inline int bits() const { return bits_; }
+
+private:
+  // totals over events [0, n)
+  void prefix(const std::vector<const CanEvent *> &events, size_t n, uint32_t *ones, uint32_t *flips) const;
+
+  static constexpr size_t BLOCK = 64;
+  int bits_ = 0;
+  size_t indexed_ = 0;
+  const CanEvent *last_event_ = nullptr;
+  // BLOCK-spaced prefix sums, bits_ values per block
+  std::vector<uint32_t> block_ones_, block_flips_;
+  std::vector<uint32_t> ones_, flips_;  // running totals up to indexed_
+};
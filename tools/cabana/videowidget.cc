@@ -1,5 +1,7 @@
 #include "tools/cabana/videowidget.h"
 
+#include <sys/resource.h>
+
 #include <algorithm>
 #include <utility>
 
@@ -13,6 +15,7 @@
 #include <QVBoxLayout>
 #include <QtConcurrent>
 
+#include "common/timing.h"
 #include "tools/cabana/streams/replaystream.h"
 
 const int MIN_VIDEO_HEIGHT = 100;
@@ -146,9 +149,10 @@ QWidget *VideoWidget::createCameraWidget() {
   camera_tab->setAutoHide(true);
   camera_tab->setExpanding(false);
 
+  auto replay = static_cast<ReplayStream*>(can)->getReplay();
   QStackedLayout *stacked = new QStackedLayout();
   stacked->setStackingMode(QStackedLayout::StackAll);
-  stacked->addWidget(cam_widget = new StreamCameraView("camerad", VISION_STREAM_ROAD));
+  stacked->addWidget(cam_widget = new StreamCameraView("camerad", VISION_STREAM_ROAD, replay));
   cam_widget->setMinimumHeight(MIN_VIDEO_HEIGHT);
   cam_widget->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::MinimumExpanding);
   stacked->addWidget(alert_label = new InfoLabel(this));
@@ -162,13 +166,12 @@ QWidget *VideoWidget::createCameraWidget() {
   QObject::connect(can, &AbstractStream::paused, cam_widget, [c = cam_widget]() { c->showPausedOverlay(); });
   QObject::connect(can, &AbstractStream::resume, cam_widget, [c = cam_widget]() { c->update(); });
   QObject::connect(can, &AbstractStream::eventsMerged, this, [this]() { slider->update(); });
-  QObject::connect(cam_widget, &CameraWidget::clicked, []() { can->pause(!can->isPaused()); });
-  QObject::connect(cam_widget, &CameraWidget::vipcAvailableStreamsUpdated, this, &VideoWidget::vipcAvailableStreamsUpdated);
+  QObject::connect(cam_widget, &CameraCompositor::clicked, []() { can->pause(!can->isPaused()); });
+  QObject::connect(cam_widget, &CameraCompositor::vipcAvailableStreamsUpdated, this, &VideoWidget::vipcAvailableStreamsUpdated);
   QObject::connect(camera_tab, &QTabBar::currentChanged, [this](int index) {
     if (index != -1) cam_widget->setStreamType((VisionStreamType)camera_tab->tabData(index).toInt());
   });
 
-  auto replay = static_cast<ReplayStream*>(can)->getReplay();
   QObject::connect(replay, &Replay::qLogLoaded, slider, &Slider::parseQLog, Qt::QueuedConnection);
   QObject::connect(replay, &Replay::minMaxTimeChanged, this, &VideoWidget::timeRangeChanged, Qt::QueuedConnection);
   return w;
@@ -421,16 +424,27 @@ void InfoLabel::paintEvent(QPaintEvent *event) {
   }
 }
 
-StreamCameraView::StreamCameraView(std::string stream_name, VisionStreamType stream_type, QWidget *parent)
-    : CameraWidget(stream_name, stream_type, parent) {
+StreamCameraView::StreamCameraView(std::string stream_name, VisionStreamType stream_type, Replay *replay, QWidget *parent)
+    : CameraCompositor(stream_name, parent), replay(replay) {
+  setStreamType(stream_type);
+  setShowStats(getenv("SHOW_STATS") != nullptr);
   fade_animation = new QPropertyAnimation(this, "overlayOpacity");
   fade_animation->setDuration(500);
   fade_animation->setStartValue(0.2f);
   fade_animation->setEndValue(0.7f);
+  if (replay) {
+    usePushedFrames();
+    replay->addFrameSink(this);
+  }
+}
+
+StreamCameraView::~StreamCameraView() {
+  if (replay) replay->removeFrameSink(this);
 }
 
 void StreamCameraView::paintGL() {
-  CameraWidget::paintGL();
+  CameraCompositor::paintGL();
+  if (show_stats) drawCpuUsage();
 
   if (can->isPaused()) {
     QPainter p(this);
@@ -439,3 +453,22 @@ void StreamCameraView::paintGL() {
     p.drawText(rect(), Qt::AlignCenter, tr("PAUSED"));
   }
 }
+
+void StreamCameraView::drawCpuUsage() {
+  // of the whole process, averaged over a second
+  struct rusage usage = {};
+  getrusage(RUSAGE_SELF, &usage);
+  const uint64_t cpu_ns = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL +
+                          (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+  const uint64_t now = nanos_since_boot();
+  if (now - cpu_sample_time > 1e9) {
+    if (cpu_sample_time > 0) cpu_usage = 100.0 * (cpu_ns - cpu_sample_ns) / (now - cpu_sample_time);
+    cpu_sample_time = now;
+    cpu_sample_ns = cpu_ns;
+  }
+
+  QPainter p(this);
+  p.setPen(Qt::white);
+  p.setFont(QFont(font().family(), 10));
+  p.drawText(rect().adjusted(5, 5, -5, -5), Qt::AlignBottom | Qt::AlignLeft, QString("cpu %1%").arg(cpu_usage, 0, 'f', 0));
+}
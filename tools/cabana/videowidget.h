@@ -9,13 +9,15 @@
 
 #include <QHBoxLayout>
 #include <QFrame>
+#include <QPointer>
 #include <QPropertyAnimation>
 #include <QSlider>
 #include <QTabBar>
 
-#include "selfdrive/ui/qt/widgets/cameraview.h"
+#include "selfdrive/ui/qt/widgets/cameracompositor.h"
 #include "tools/cabana/utils/util.h"
 #include "tools/replay/logreader.h"
+#include "tools/replay/replay.h"
 
 struct AlertInfo {
   cereal::SelfdriveState::AlertStatus status;
@@ -59,12 +61,17 @@ private:
   InfoLabel *thumbnail_label;
 };
 
-class StreamCameraView : public CameraWidget {
+// Shows the frames of the replay, they are handed over in the process if it's given.
+class StreamCameraView : public CameraCompositor, public CameraServer::FrameSink {
   Q_OBJECT
   Q_PROPERTY(float overlayOpacity READ overlayOpacity WRITE setOverlayOpacity)
 
 public:
-  StreamCameraView(std::string stream_name, VisionStreamType stream_type, QWidget *parent = nullptr);
+  StreamCameraView(std::string stream_name, VisionStreamType stream_type, Replay *replay = nullptr, QWidget *parent = nullptr);
+  ~StreamCameraView();
+  void cameraBuffers(VisionStreamType type, const std::vector<VisionBuf *> &buffers) override { pushBuffers(type, buffers); }
+  void cameraFrame(VisionStreamType type, VisionBuf *buf, const VisionIpcBufExtra &extra) override { pushFrame(type, buf, extra); }
+  void setStreamType(VisionStreamType type) { setTiles({{type, QRectF(0, 0, 1, 1)}}); }
   void paintGL() override;
   void showPausedOverlay() { fade_animation->start(); }
   float overlayOpacity() const { return overlay_opacity; }
@@ -74,8 +81,14 @@ public:
   }
 
 private:
+  void drawCpuUsage();
+
   float overlay_opacity;
   QPropertyAnimation *fade_animation;
+  QPointer<Replay> replay;
+  // cpu time of the process at the last sample, for the stats
+  uint64_t cpu_sample_time = 0, cpu_sample_ns = 0;
+  float cpu_usage = 0;
 };
 
 class VideoWidget : public QFrame {
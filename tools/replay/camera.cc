@@ -2,13 +2,17 @@
 
 #include <cassert>
 #include <algorithm>
+#include <cstring>
 
 #include <capnp/dynamic.h>
 
+#include "common/timing.h"
 #include "third_party/linux/include/msm_media_info.h"
 #include "tools/replay/util.h"
 
 const int BUFFER_COUNT = 40;
+// frames decoded ahead per camera, well below BUFFER_COUNT so the clients keep enough buffers
+const int DECODE_AHEAD = 8;
 
 std::tuple<size_t, size_t, size_t> get_nv12_info(int width, int height) {
   int nv12_width = VENUS_Y_STRIDE(COLOR_FMT_NV12, width);
@@ -19,18 +23,32 @@ std::tuple<size_t, size_t, size_t> get_nv12_info(int width, int height) {
   return {nv12_width, nv12_height, nv12_buffer_size};
 }
 
-CameraServer::CameraServer(std::pair<int, int> camera_size[MAX_CAMERAS]) {
+CameraServer::CameraServer(std::pair<int, int> camera_size[MAX_CAMERAS], const std::string &vipc_name, bool publish_vipc)
+    : vipc_name_(vipc_name), publish_vipc_(publish_vipc) {
   for (int i = 0; i < MAX_CAMERAS; ++i) {
     std::tie(cameras_[i].width, cameras_[i].height) = camera_size[i];
   }
   startVipcServer();
+
+  // a camera is decoded by one worker at a time, its frames depend on each other
+  int workers = std::clamp((int)std::thread::hardware_concurrency() - 1, 1, MAX_CAMERAS);
+  for (int i = 0; i < workers; ++i) {
+    decode_threads_.emplace_back(&CameraServer::decodeThread, this);
+  }
 }
 
 CameraServer::~CameraServer() {
+  {
+    std::lock_guard lk(decode_lock_);
+    exit_ = true;
+  }
+  decode_cv_.notify_all();
+  for (auto &t : decode_threads_) t.join();
+
   for (auto &cam : cameras_) {
     if (cam.thread.joinable()) {
       // Clear the queue
-      std::pair<FrameReader*, const Event *> item;
+      std::pair<std::shared_ptr<FrameReader>, const Event *> item;
       while (cam.queue.try_pop(item)) {
         --publishing_;
       }
@@ -39,26 +57,70 @@ CameraServer::~CameraServer() {
       cam.queue.push({});
       cam.thread.join();
     }
+    if (cam.stats.sent > 0) {
+      rInfo("camera[%d] sent %lu frames, %lu stalls (%.1f ms), %lu dropped", cam.type, cam.stats.sent,
+            cam.stats.stalls, cam.stats.stall_ms, cam.stats.dropped);
+    }
+  }
+  {
+    std::lock_guard lk(sinks_lock_);
+    for (auto &cam : cameras_) {
+      std::lock_guard cam_lk(cam.sinks_lock);
+      cam.buffers.clear();
+      for (auto sink : cam.sinks) sink->cameraBuffers(cam.stream_type, cam.buffers);
+    }
   }
   vipc_server_.reset(nullptr);
 }
 
 void CameraServer::startVipcServer() {
-  vipc_server_.reset(new VisionIpcServer("camerad"));
+  // the sinks switch to the new buffers before the old ones are freed with their server
+  std::unique_lock lk(sinks_lock_);
+  auto server = std::make_unique<VisionIpcServer>(vipc_name_);
   for (auto &cam : cameras_) {
-    cam.cached_buf.clear();
-
+    std::lock_guard cam_lk(cam.sinks_lock);
+    cam.buffers.clear();
     if (cam.width > 0 && cam.height > 0) {
       rInfo("camera[%d] frame size %dx%d", cam.type, cam.width, cam.height);
       auto [nv12_width, nv12_height, nv12_buffer_size] = get_nv12_info(cam.width, cam.height);
-      vipc_server_->create_buffers_with_sizes(cam.stream_type, BUFFER_COUNT, cam.width, cam.height,
-                                              nv12_buffer_size, nv12_width, nv12_width * nv12_height);
+      server->create_buffers_with_sizes(cam.stream_type, BUFFER_COUNT, cam.width, cam.height,
+                                        nv12_buffer_size, nv12_width, nv12_width * nv12_height);
+      // handed out in turn, the next call starts over with the first one
+      for (int i = 0; i < BUFFER_COUNT; ++i) {
+        cam.buffers.push_back(server->get_buffer(cam.stream_type));
+      }
       if (!cam.thread.joinable()) {
         cam.thread = std::thread(&CameraServer::cameraThread, this, std::ref(cam));
       }
     }
+    for (auto sink : cam.sinks) sink->cameraBuffers(cam.stream_type, cam.buffers);
+  }
+  vipc_server_ = std::move(server);
+  lk.unlock();
+
+  if (publish_vipc_) {
+    vipc_server_->start_listener();
+  }
+}
+
+void CameraServer::addFrameSink(FrameSink *sink) {
+  std::lock_guard lk(sinks_lock_);
+  for (auto &cam : cameras_) {
+    std::lock_guard cam_lk(cam.sinks_lock);
+    sink->cameraBuffers(cam.stream_type, cam.buffers);
+    cam.sinks.push_back(sink);
+  }
+}
+
+void CameraServer::removeFrameSink(FrameSink *sink) {
+  std::lock_guard lk(sinks_lock_);
+  for (auto &cam : cameras_) {
+    std::lock_guard cam_lk(cam.sinks_lock);
+    if (auto it = std::find(cam.sinks.begin(), cam.sinks.end(), sink); it != cam.sinks.end()) {
+      cam.sinks.erase(it);
+      sink->cameraBuffers(cam.stream_type, {});
+    }
   }
-  vipc_server_->start_listener();
 }
 
 void CameraServer::cameraThread(Camera &cam) {
@@ -72,50 +134,183 @@ void CameraServer::cameraThread(Camera &cam) {
 
     int segment_id = eidx.getSegmentId();
     uint32_t frame_id = eidx.getFrameId();
-    if (auto yuv = getFrame(cam, fr, segment_id, frame_id)) {
+    if (auto yuv = nextFrame(cam, fr, event, segment_id)) {
+      cacheFrame(cam, event->eidx_segnum, segment_id, event->mono_time, yuv);
       VisionIpcBufExtra extra = {
           .frame_id = frame_id,
           .timestamp_sof = eidx.getTimestampSof(),
           .timestamp_eof = eidx.getTimestampEof(),
       };
-      vipc_server_->send(yuv, &extra);
-    } else {
-      rError("camera[%d] failed to get frame: %lu", cam.type, segment_id);
+      if (publish_vipc_) {
+        vipc_server_->send(yuv, &extra);
+      }
+      std::lock_guard lk(cam.sinks_lock);
+      for (auto sink : cam.sinks) sink->cameraFrame(cam.stream_type, yuv, extra);
+    } else if (!exit_) {
+      rError("camera[%d] failed to get frame: %d", cam.type, segment_id);
     }
 
-    // Prefetch the next frame
-    getFrame(cam, fr, segment_id + 1, frame_id + 1);
-
     --publishing_;
   }
 }
 
-VisionBuf *CameraServer::getFrame(Camera &cam, FrameReader *fr, int32_t segment_id, uint32_t frame_id) {
-  // Check if the frame is cached
-  auto buf_it = std::find_if(cam.cached_buf.begin(), cam.cached_buf.end(),
-                             [frame_id](VisionBuf *buf) { return buf->get_frame_id() == frame_id; });
-  if (buf_it != cam.cached_buf.end()) return *buf_it;
+VisionBuf *CameraServer::nextFrame(Camera &cam, const std::shared_ptr<FrameReader> &fr, const Event *event, int idx) {
+  if (idx < 0 || idx >= fr->getFrameCount()) return nullptr;
+
+  std::unique_lock lk(decode_lock_);
+  // continue decoding ahead if the frame is the next one or a bit further (skipped events),
+  // otherwise start over from it, e.g. after a seek
+  const bool ahead = cam.ahead_fr == fr && cam.ahead_segnum == event->eidx_segnum &&
+                     idx >= cam.next_idx && idx < cam.ahead_idx + DECODE_AHEAD;
+  if (!ahead) {
+    cam.stats.dropped += cam.decoded.size();
+    restartDecodeAhead(cam, fr, event->eidx_segnum, idx);
+  }
+
+  auto ready = [&]() {
+    while (!cam.decoded.empty() && cam.decoded.front().idx < idx) {
+      cam.decoded.pop_front();
+      ++cam.stats.dropped;
+    }
+    return exit_ || (!cam.decoded.empty() && cam.decoded.front().idx == idx);
+  };
+  if (!ready()) {
+    const double begin = millis_since_boot();
+    decode_cv_.notify_all();
+    decode_cv_.wait(lk, ready);
+    ++cam.stats.stalls;
+    cam.stats.stall_ms += millis_since_boot() - begin;
+  }
+  if (exit_) return nullptr;
+
+  // the buffer isn't handed out again before BUFFER_COUNT more frames are decoded
+  VisionBuf *buf = cam.decoded.front().buf;
+  cam.decoded.pop_front();
+  cam.next_idx = idx + 1;
+  ++cam.stats.sent;
+  lk.unlock();
+  decode_cv_.notify_all();
+  return buf;
+}
+
+void CameraServer::restartDecodeAhead(Camera &cam, std::shared_ptr<FrameReader> fr, int segnum, int idx) {
+  cam.ahead_fr = std::move(fr);
+  cam.ahead_segnum = segnum;
+  cam.ahead_idx = cam.next_idx = idx;
+  cam.decoded.clear();
+  ++cam.generation;
+}
+
+CameraServer::Camera *CameraServer::nextDecodeJob() {
+  // the camera with the fewest frames decoded ahead
+  Camera *next = nullptr;
+  for (auto &cam : cameras_) {
+    if (!cam.decoding && cam.ahead_fr && cam.ahead_idx < cam.ahead_fr->getFrameCount() &&
+        cam.decoded.size() < DECODE_AHEAD && (!next || cam.decoded.size() < next->decoded.size())) {
+      next = &cam;
+    }
+  }
+  return next;
+}
+
+void CameraServer::decodeThread() {
+  std::unique_lock lk(decode_lock_);
+  while (true) {
+    Camera *cam = nullptr;
+    decode_cv_.wait(lk, [&]() { return exit_ || (cam = nextDecodeJob()) != nullptr; });
+    if (exit_) break;
+
+    cam->decoding = true;
+    const auto fr = cam->ahead_fr;
+    const int generation = cam->generation, segnum = cam->ahead_segnum, idx = cam->ahead_idx++;
+    VisionBuf *buf = vipc_server_->get_buffer(cam->stream_type);
+    lk.unlock();
 
-  VisionBuf *yuv_buf = vipc_server_->get_buffer(cam.stream_type);
-  if (fr->get(segment_id, yuv_buf)) {
-    yuv_buf->set_frame_id(frame_id);
-    cam.cached_buf.insert(yuv_buf);
-    return yuv_buf;
+    bool success = loadFrame(*cam, fr.get(), segnum, idx, buf);
+
+    lk.lock();
+    cam->decoding = false;
+    if (generation == cam->generation) {
+      cam->decoded.push_back({.segnum = segnum, .idx = idx, .buf = success ? buf : nullptr});
+    }
+    decode_cv_.notify_all();
   }
-  return nullptr;
 }
 
-void CameraServer::pushFrame(CameraType type, FrameReader *fr, const Event *event) {
+CameraServer::PipelineStats CameraServer::pipelineStats(CameraType type) const {
+  std::lock_guard lk(decode_lock_);
+  return cameras_[type].stats;
+}
+
+bool CameraServer::loadFrame(Camera &cam, FrameReader *fr, int segnum, int idx, VisionBuf *buf) {
+  if (frame_cache_size_ > 0) {
+    std::lock_guard lk(cam.frame_cache_lock);
+    if (auto it = cam.frame_cache.find({segnum, idx}); it != cam.frame_cache.end()) {
+      memcpy(buf->addr, it->second.data(), it->second.size());
+      ++frame_cache_hits_;
+      return true;
+    }
+  }
+
+  if (!fr->get(idx, buf)) return false;
+  ++decoded_frames_;
+  return true;
+}
+
+void CameraServer::cacheFrame(Camera &cam, int segnum, int idx, uint64_t mono_time, const VisionBuf *buf) {
+  // decided when the frame is sent, a frame decoded ahead has no event yet to take the time from
+  if (frame_cache_size_ == 0 || mono_time < frame_cache_begin_ts_ || mono_time >= frame_cache_end_ts_) return;
+
+  // y plane followed by the interleaved uv plane
+  const size_t frame_size = buf->uv_offset + buf->stride * (buf->height / 2);
+  if (frame_cache_bytes_ + frame_size <= frame_cache_size_) {
+    std::lock_guard lk(cam.frame_cache_lock);
+    auto &data = cam.frame_cache[{segnum, idx}];
+    if (data.empty()) {
+      data.assign((uint8_t *)buf->addr, (uint8_t *)buf->addr + frame_size);
+      frame_cache_bytes_ += frame_size;
+    }
+  }
+}
+
+void CameraServer::setFrameCache(size_t max_bytes, uint64_t begin_ts, uint64_t end_ts) {
+  // the keys don't depend on the range, a frame stored by a racing camera thread is still valid
+  frame_cache_size_ = 0;
+  for (auto &cam : cameras_) {
+    std::lock_guard lk(cam.frame_cache_lock);
+    cam.frame_cache.clear();
+  }
+  frame_cache_bytes_ = 0;
+  frame_cache_begin_ts_ = begin_ts;
+  frame_cache_end_ts_ = end_ts;
+  frame_cache_size_ = max_bytes;
+}
+
+CameraServer::FrameCacheStats CameraServer::frameCacheStats() const {
+  size_t frames = 0;
+  for (auto &cam : cameras_) {
+    std::lock_guard lk(cam.frame_cache_lock);
+    frames += cam.frame_cache.size();
+  }
+  return {.bytes = frame_cache_bytes_, .frames = frames, .decoded = decoded_frames_, .hits = frame_cache_hits_};
+}
+
+void CameraServer::pushFrame(CameraType type, std::shared_ptr<FrameReader> fr, const Event *event) {
   auto &cam = cameras_[type];
   if (cam.width != fr->width || cam.height != fr->height) {
     cam.width = fr->width;
     cam.height = fr->height;
     waitForSent();
+
+    // the decoders get their buffers from the vipc server
+    std::unique_lock lk(decode_lock_);
+    for (auto &c : cameras_) restartDecodeAhead(c);
+    decode_cv_.wait(lk, [this]() { return std::none_of(std::begin(cameras_), std::end(cameras_), [](auto &c) { return c.decoding; }); });
     startVipcServer();
   }
 
   ++publishing_;
-  cam.queue.push({fr, event});
+  cam.queue.push({std::move(fr), event});
 }
 
 void CameraServer::waitForSent() {
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <memory>
-#include <set>
+#include <mutex>
+#include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "msgq/visionipc/visionipc_server.h"
 #include "common/queue.h"
@@ -12,26 +17,91 @@
 
 std::tuple<size_t, size_t, size_t> get_nv12_info(int width, int height);
 
+// Publishes the frames of the pushed encode index events on a VisionIPC server. A pool of decode
+// workers decodes the next frames of each camera ahead into a bounded queue of VisionIPC buffers,
+// the camera threads publish from it and only wait for a decoder when it runs dry.
 class CameraServer {
 public:
-  CameraServer(std::pair<int, int> camera_size[MAX_CAMERAS] = nullptr);
+  // Gets the frames in the process, without a round trip through VisionIPC. The calls come from the
+  // camera threads and should return quickly. A frame's buffer isn't decoded into again before
+  // 32 more frames of its camera are sent, the same as for a VisionIPC client.
+  class FrameSink {
+  public:
+    virtual ~FrameSink() = default;
+    // the buffers the frames of `type` are sent in, empty when they are released and mustn't be used anymore
+    virtual void cameraBuffers(VisionStreamType type, const std::vector<VisionBuf *> &buffers) = 0;
+    virtual void cameraFrame(VisionStreamType type, VisionBuf *buf, const VisionIpcBufExtra &extra) = 0;
+  };
+
+  // without `publish_vipc` the frames only go to the frame sinks, no VisionIPC client can connect
+  CameraServer(std::pair<int, int> camera_size[MAX_CAMERAS] = nullptr, const std::string &vipc_name = "camerad",
+               bool publish_vipc = true);
   ~CameraServer();
-  void pushFrame(CameraType type, FrameReader* fr, const Event *event);
+  // the sink gets the buffers of the running cameras right away
+  void addFrameSink(FrameSink *sink);
+  // the sink gets empty buffers and no more calls after this returns
+  void removeFrameSink(FrameSink *sink);
+  void pushFrame(CameraType type, std::shared_ptr<FrameReader> fr, const Event *event);
   void waitForSent();
+  // Keep up to max_bytes of decoded frames of [begin_ts, end_ts) in memory, so a looped playback
+  // decodes each frame once. 0 disables and clears the cache.
+  void setFrameCache(size_t max_bytes, uint64_t begin_ts = 0, uint64_t end_ts = UINT64_MAX);
+  struct FrameCacheStats {
+    size_t bytes, frames;
+    uint64_t decoded, hits;
+  };
+  FrameCacheStats frameCacheStats() const;
+  struct PipelineStats {
+    uint64_t sent = 0;     // frames published
+    uint64_t stalls = 0;   // frames that weren't decoded ahead
+    double stall_ms = 0;   // time spent waiting for them
+    uint64_t dropped = 0;  // frames decoded ahead but never published, e.g. after a seek
+  };
+  PipelineStats pipelineStats(CameraType type) const;
 
 protected:
+  struct DecodedFrame {
+    int segnum;
+    int idx;
+    VisionBuf *buf;  // nullptr if decoding failed
+  };
   struct Camera {
     CameraType type;
     VisionStreamType stream_type;
     int width;
     int height;
     std::thread thread;
-    SafeQueue<std::pair<FrameReader*, const Event *>> queue;
-    std::set<VisionBuf *> cached_buf;
+    SafeQueue<std::pair<std::shared_ptr<FrameReader>, const Event *>> queue;
+    mutable std::mutex frame_cache_lock;
+    // decoded frames by route segment and frame index, outlives the segments' frame readers
+    std::map<std::pair<int, int>, std::vector<uint8_t>> frame_cache;
+
+    // decode-ahead state, protected with decode_lock_
+    std::shared_ptr<FrameReader> ahead_fr;
+    int ahead_segnum = -1;
+    int next_idx = 0;   // next frame to publish
+    int ahead_idx = 0;  // next frame to decode
+    int generation = 0;  // incremented on restart, the frames being decoded before are discarded
+    bool decoding = false;
+    std::deque<DecodedFrame> decoded;
+    PipelineStats stats;
+
+    // the frame sinks and the buffers of the vipc server they're sent, per camera so its thread only
+    // waits for a sink being added or removed, not for the sinks of the other cameras
+    std::mutex sinks_lock;
+    std::vector<FrameSink *> sinks;
+    std::vector<VisionBuf *> buffers;
   };
   void startVipcServer();
   void cameraThread(Camera &cam);
-  VisionBuf *getFrame(Camera &cam, FrameReader *fr, int32_t segment_id, uint32_t frame_id);
+  void decodeThread();
+  Camera *nextDecodeJob();
+  VisionBuf *nextFrame(Camera &cam, const std::shared_ptr<FrameReader> &fr, const Event *event, int idx);
+  void restartDecodeAhead(Camera &cam, std::shared_ptr<FrameReader> fr = nullptr, int segnum = -1, int idx = 0);
+  // decodes the frame into buf, or copies it from the frame cache
+  bool loadFrame(Camera &cam, FrameReader *fr, int segnum, int idx, VisionBuf *buf);
+  // stores a sent frame in the frame cache if its event is in the cached range
+  void cacheFrame(Camera &cam, int segnum, int idx, uint64_t mono_time, const VisionBuf *buf);
 
   Camera cameras_[MAX_CAMERAS] = {
       {.type = RoadCam, .stream_type = VISION_STREAM_ROAD},
@@ -39,5 +109,19 @@ protected:
       {.type = WideRoadCam, .stream_type = VISION_STREAM_WIDE_ROAD},
   };
   std::atomic<int> publishing_ = 0;
+  std::atomic<size_t> frame_cache_size_ = 0;
+  std::atomic<uint64_t> frame_cache_begin_ts_ = 0;
+  std::atomic<uint64_t> frame_cache_end_ts_ = 0;
+  std::atomic<size_t> frame_cache_bytes_ = 0;
+  std::atomic<uint64_t> decoded_frames_ = 0;
+  std::atomic<uint64_t> frame_cache_hits_ = 0;
+  std::string vipc_name_;
+  const bool publish_vipc_;
   std::unique_ptr<VisionIpcServer> vipc_server_;
+  std::mutex sinks_lock_;  // serializes adding and removing sinks with replacing the vipc server
+
+  mutable std::mutex decode_lock_;
+  std::condition_variable decode_cv_;
+  std::vector<std::thread> decode_threads_;
+  std::atomic<bool> exit_ = false;
 };
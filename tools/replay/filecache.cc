@@ -0,0 +1,271 @@
+#include "tools/replay/filecache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+#include "common/timing.h"
+#include "common/util.h"
+#include "system/hardware/hw.h"
+#include "tools/replay/util.h"
+
+static const char *INDEX_FILE = "index";
+// serializes index writes between processes sharing the cache directory
+static const char *INDEX_LOCK_FILE = "index.lock";
+// index changes are written at most this often, and when the cache is destroyed or flushed
+static const double INDEX_SAVE_INTERVAL_MS = 10000;
+// temp files older than this are left by interrupted writes, younger ones may still be written
+static const int STALE_TEMP_FILE_SECONDS = 3600;
+
+// the names of our files, the directory is shared with url_file.py's "<sha256>_<chunk>" files
+static bool isCacheFile(const std::string &name) {
+  return name.size() == 64 && name.find_first_not_of("0123456789abcdef") == std::string::npos;
+}
+static bool isTempFile(const std::string &name) {
+  const size_t pos = name.find(".tmp.");
+  return pos != std::string::npos && (isCacheFile(name.substr(0, pos)) || name.substr(0, pos) == INDEX_FILE);
+}
+
+// write to a temp file next to `path` and rename it into place, readers never see a partial file
+static bool writeAtomic(const std::string &path, const std::string &data) {
+  std::string tmp = path + ".tmp.XXXXXX";
+  int fd = mkstemp(tmp.data());
+  if (fd < 0) return false;
+
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    written += n;
+  }
+  bool ok = written == data.size() && fchmod(fd, 0644) == 0 && fsync(fd) == 0;
+  ok = ::close(fd) == 0 && ok;
+  ok = ok && ::rename(tmp.c_str(), path.c_str()) == 0;
+  if (!ok) ::unlink(tmp.c_str());
+  return ok;
+}
+
+FileCache::FileCache(const std::string &dir, uint64_t max_bytes) : max_bytes_(max_bytes) {
+  dir_ = dir.empty() || dir.back() == '/' ? dir : dir + "/";
+  util::create_directories(dir_, 0755);
+  loadIndex();
+  evict({});
+}
+
+FileCache::~FileCache() {
+  flush();
+}
+
+FileCache &FileCache::instance() {
+  static FileCache cache(Path::download_cache_root());
+  return cache;
+}
+
+std::string FileCache::fileName(const std::string &url) const {
+  return sha256(getUrlWithoutQuery(url));
+}
+
+std::string FileCache::path(const std::string &url) const {
+  return dir_ + fileName(url);
+}
+
+std::optional<std::string> FileCache::get(const std::string &url) {
+  const std::string name = fileName(url);
+  Entry entry;
+  {
+    std::lock_guard lk(lock_);
+    auto it = entries_.find(name);
+    if (it == entries_.end()) return std::nullopt;
+    entry = it->second;
+  }
+
+  if (entry.checksum.empty()) return std::nullopt;  // not written by us, put() replaces it
+
+  std::string data = util::read_file(dir_ + name);
+  if (data.size() != entry.size || (!entry.verified && sha256(data) != entry.checksum)) {
+    rWarning("cached file %s is corrupt, removing it", name.c_str());
+    remove(url);
+    return std::nullopt;
+  }
+
+  std::lock_guard lk(lock_);
+  if (auto it = entries_.find(name); it != entries_.end()) {
+    it->second.last_access = ++clock_;
+    it->second.verified = true;
+    indexChanged();
+  }
+  return data;
+}
+
+std::optional<std::string> FileCache::lookup(const std::string &url) {
+  const std::string name = fileName(url);
+  std::lock_guard lk(lock_);
+  auto it = entries_.find(name);
+  if (it == entries_.end() || it->second.checksum.empty()) return std::nullopt;
+
+  struct stat st;
+  if (stat((dir_ + name).c_str(), &st) != 0 || (uint64_t)st.st_size != it->second.size) {
+    rWarning("cached file %s is corrupt, removing it", name.c_str());
+    removeFile(name);
+    indexChanged();
+    return std::nullopt;
+  }
+  it->second.last_access = ++clock_;
+  indexChanged();
+  return dir_ + name;
+}
+
+bool FileCache::put(const std::string &url, const std::string &data) {
+  const std::string name = fileName(url);
+  Entry entry = {.size = data.size(), .checksum = sha256(data), .verified = true};
+  if (!writeAtomic(dir_ + name, data)) {
+    rWarning("failed to write %s to the cache", name.c_str());
+    return false;
+  }
+
+  std::lock_guard lk(lock_);
+  if (auto it = entries_.find(name); it != entries_.end()) {
+    total_bytes_ -= it->second.size;
+  }
+  entry.last_access = ++clock_;
+  entries_[name] = entry;
+  total_bytes_ += entry.size;
+  evict(name);
+  indexChanged();
+  return true;
+}
+
+void FileCache::remove(const std::string &url) {
+  std::lock_guard lk(lock_);
+  removeFile(fileName(url));
+  indexChanged();
+}
+
+void FileCache::setMaxBytes(uint64_t max_bytes) {
+  std::lock_guard lk(lock_);
+  max_bytes_ = max_bytes;
+  evict({});
+  indexChanged();
+}
+
+void FileCache::flush() {
+  std::lock_guard lk(lock_);
+  if (index_dirty_) saveIndex();
+}
+
+uint64_t FileCache::totalBytes() {
+  std::lock_guard lk(lock_);
+  return total_bytes_;
+}
+
+void FileCache::removeFile(const std::string &name) {
+  if (auto it = entries_.find(name); it != entries_.end()) {
+    total_bytes_ -= it->second.size;
+    entries_.erase(it);
+  }
+  ::unlink((dir_ + name).c_str());
+}
+
+void FileCache::evict(const std::string &keep) {
+  if (total_bytes_ <= max_bytes_) return;
+
+  std::vector<std::pair<uint64_t, std::string>> lru;
+  for (const auto &[name, entry] : entries_) {
+    if (name != keep) lru.emplace_back(entry.last_access, name);
+  }
+  std::sort(lru.begin(), lru.end());
+  for (const auto &[_, name] : lru) {
+    if (total_bytes_ <= max_bytes_) break;
+    removeFile(name);
+  }
+}
+
+// one line per file: "<name> <size> <last access> <sha256 or ->"
+std::vector<std::pair<std::string, FileCache::Entry>> FileCache::readIndex(const std::string &path) {
+  std::vector<std::pair<std::string, Entry>> index;
+  std::istringstream stream(util::read_file(path));
+  std::string name;
+  Entry entry;
+  while (stream >> name >> entry.size >> entry.last_access >> entry.checksum) {
+    if (entry.checksum == "-") entry.checksum.clear();
+    index.emplace_back(name, entry);
+  }
+  return index;
+}
+
+// add the entries of `index` this process doesn't know, if their files are still there
+void FileCache::mergeIndex(const std::vector<std::pair<std::string, Entry>> &index) {
+  for (const auto &[name, entry] : index) {
+    auto it = entries_.find(name);
+    if (it != entries_.end() && !it->second.checksum.empty()) continue;
+
+    struct stat st;
+    if (stat((dir_ + name).c_str(), &st) != 0 || (uint64_t)st.st_size != entry.size) continue;
+    if (it != entries_.end()) {
+      if (entry.checksum.empty()) continue;
+      total_bytes_ -= it->second.size;
+    }
+    entries_[name] = entry;
+    total_bytes_ += entry.size;
+    clock_ = std::max(clock_, entry.last_access);
+  }
+}
+
+void FileCache::loadIndex() {
+  mergeIndex(readIndex(dir_ + INDEX_FILE));
+
+  // files missing from the index may have been written by another process that hasn't saved its
+  // index yet, or by an older version. they can't be validated, so they are treated as misses and
+  // evicted first instead of being removed here.
+  if (DIR *dir = opendir(dir_.c_str())) {
+    while (struct dirent *ent = readdir(dir)) {
+      std::string file = ent->d_name;
+      struct stat st;
+      if (ent->d_type != DT_REG || stat((dir_ + file).c_str(), &st) != 0) continue;
+
+      if (isCacheFile(file) && entries_.count(file) == 0) {
+        entries_[file] = {.size = (uint64_t)st.st_size};
+        total_bytes_ += st.st_size;
+      } else if (isTempFile(file) && time(nullptr) - st.st_mtime > STALE_TEMP_FILE_SECONDS) {
+        ::unlink((dir_ + file).c_str());
+      }
+    }
+    closedir(dir);
+  }
+}
+
+void FileCache::saveIndex() {
+  // other processes write the index too, merge their entries under the lock so none are dropped
+  unique_fd lock_fd = HANDLE_EINTR(open((dir_ + INDEX_LOCK_FILE).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644));
+  if (lock_fd < 0 || HANDLE_EINTR(flock(lock_fd, LOCK_EX)) != 0) {
+    rWarning("failed to lock the cache index");
+    return;
+  }
+  mergeIndex(readIndex(dir_ + INDEX_FILE));
+
+  std::string index;
+  for (const auto &[name, entry] : entries_) {
+    const std::string &checksum = entry.checksum.empty() ? "-" : entry.checksum;
+    index += name + " " + std::to_string(entry.size) + " " + std::to_string(entry.last_access) + " " + checksum + "\n";
+  }
+  if (!writeAtomic(dir_ + INDEX_FILE, index)) {
+    rWarning("failed to write the cache index");
+  }
+  index_dirty_ = false;
+  index_saved_ms_ = millis_since_boot();
+}
+
+void FileCache::indexChanged() {
+  index_dirty_ = true;
+  if (millis_since_boot() - index_saved_ms_ >= INDEX_SAVE_INTERVAL_MS) {
+    saveIndex();
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Cache of downloaded route files on local disk, bounded to max bytes by evicting the least
+// recently used files. Files are written to a temp file and renamed into place, and an index in
+// the cache directory records their size and checksum, so a file left by an interrupted write or
+// damaged later is dropped instead of being trusted. A file's checksum is verified once per
+// process, when it's written or first read. Several processes can share the directory: the index
+// is merged with the one on disk under a lock when it's written, and files missing from it are
+// treated as misses and evicted first rather than removed, they may belong to another process.
+class FileCache {
+public:
+  // how logs are stored: as downloaded, decompressed, or recompressed with zstd level 1
+  enum class LogFormat { Original, Raw, Zstd };
+
+  FileCache(const std::string &dir, uint64_t max_bytes = DEFAULT_MAX_BYTES);
+  ~FileCache();
+  // the cache in Path::download_cache_root()
+  static FileCache &instance();
+
+  std::string path(const std::string &url) const;
+  // contents of the cached file, nullopt if it's missing or fails validation
+  std::optional<std::string> get(const std::string &url);
+  // path of the cached file for readers that open it themselves, only its size is validated
+  std::optional<std::string> lookup(const std::string &url);
+  bool put(const std::string &url, const std::string &data);
+  void remove(const std::string &url);
+  // write the index now if it changed, otherwise that's batched
+  void flush();
+
+  void setMaxBytes(uint64_t max_bytes);
+  inline uint64_t maxBytes() const { return max_bytes_; }
+  uint64_t totalBytes();
+  inline void setLogFormat(LogFormat format) { log_format_ = format; }
+  inline LogFormat logFormat() const { return log_format_; }
+
+  static constexpr uint64_t DEFAULT_MAX_BYTES = 20ULL * 1024 * 1024 * 1024;
+
+private:
+  struct Entry {
+    uint64_t size = 0;
+    uint64_t last_access = 0;
+    std::string checksum;  // sha256 of the contents, empty if the file isn't in any index
+    bool verified = false;  // the contents matched the checksum in this process
+  };
+  std::string fileName(const std::string &url) const;
+  static std::vector<std::pair<std::string, Entry>> readIndex(const std::string &path);
+  void mergeIndex(const std::vector<std::pair<std::string, Entry>> &index);
+  void loadIndex();
+  void saveIndex();
+  void indexChanged();
+  void removeFile(const std::string &name);
+  // evict the least recently used files, except `keep`, until the cache fits
+  void evict(const std::string &keep);
+
+  std::mutex lock_;
+  std::string dir_;
+  uint64_t max_bytes_;
+  uint64_t total_bytes_ = 0;
+  uint64_t clock_ = 0;  // last access counter
+  bool index_dirty_ = false;
+  double index_saved_ms_ = 0;
+  LogFormat log_format_ = LogFormat::Zstd;
+  std::unordered_map<std::string, Entry> entries_;
+};
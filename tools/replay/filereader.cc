@@ -1,38 +1,76 @@
 #include "tools/replay/filereader.h"
 
-#include <fstream>
-
 #include "common/util.h"
-#include "system/hardware/hw.h"
 #include "tools/replay/util.h"
 
+static bool isRemote(const std::string &file) {
+  return file.find("https://") == 0;
+}
+
 std::string cacheFilePath(const std::string &url) {
-  static std::string cache_path = [] {
-    const std::string comma_cache = Path::download_cache_root();
-    util::create_directories(comma_cache, 0755);
-    return comma_cache.back() == '/' ? comma_cache : comma_cache + "/";
-  }();
+  return FileCache::instance().path(url);
+}
 
-  return cache_path + sha256(getUrlWithoutQuery(url));
+std::string decompressLog(std::string data, std::atomic<bool> *abort) {
+  if (util::starts_with(data, "BZh")) {
+    return decompressBZ2(data, abort);
+  } else if (util::starts_with(data, "\x28\xB5\x2F\xFD")) {
+    return decompressZST(data, abort);
+  }
+  return data;
 }
 
 std::string FileReader::read(const std::string &file, std::atomic<bool> *abort) {
-  const bool is_remote = file.find("https://") == 0;
-  const std::string local_file = is_remote ? cacheFilePath(file) : file;
-  std::string result;
-
-  if ((!is_remote || cache_to_local_) && util::file_exists(local_file)) {
-    result = util::read_file(local_file);
-  } else if (is_remote) {
-    result = download(file, abort);
-    if (cache_to_local_ && !result.empty()) {
-      std::ofstream fs(local_file, std::ios::binary | std::ios::out);
-      fs.write(result.data(), result.size());
-    }
+  if (!isRemote(file)) {
+    return util::read_file(file);
+  }
+
+  if (cache_) {
+    if (auto data = cache_->get(file)) return *data;
+  }
+  std::string result = download(file, abort);
+  if (cache_ && !result.empty()) {
+    cache_->put(file, result);
   }
   return result;
 }
 
+std::string FileReader::readLog(const std::string &file, std::atomic<bool> *abort) {
+  if (!isRemote(file) || !cache_) {
+    return decompressLog(read(file, abort), abort);
+  }
+
+  // logs cached as raw data need no decompression
+  if (auto data = cache_->get(file)) {
+    return decompressLog(std::move(*data), abort);
+  }
+  std::string data = download(file, abort);
+  std::string log = decompressLog(data, abort);
+  if (!log.empty()) {
+    switch (cache_->logFormat()) {
+      case FileCache::LogFormat::Original: cache_->put(file, data); break;
+      case FileCache::LogFormat::Raw: cache_->put(file, log); break;
+      case FileCache::LogFormat::Zstd:
+        if (std::string compressed = compressZST(log, 1); !compressed.empty()) cache_->put(file, compressed);
+        break;
+    }
+  }
+  return log;
+}
+
+std::string FileReader::localPath(const std::string &file, std::atomic<bool> *abort) {
+  if (!isRemote(file)) {
+    return util::file_exists(file) ? file : "";
+  }
+
+  FileCache *cache = cache_ ? cache_ : &FileCache::instance();
+  if (auto path = cache->lookup(file)) {
+    return *path;
+  }
+  std::string data = download(file, abort);
+  return !data.empty() && cache->put(file, data) ? cache->path(file) : "";
+}
+
 std::string FileReader::download(const std::string &url, std::atomic<bool> *abort) {
   for (int i = 0; i <= max_retries_ && !(abort && *abort); ++i) {
     if (i > 0) {
@@ -40,7 +78,7 @@ std::string FileReader::download(const std::string &url, std::atomic<bool> *abor
       util::sleep_for(3000);
     }
 
-    std::string result = httpGet(url, chunk_size_, abort);
+    std::string result = fetcher_ ? fetcher_(url, abort) : httpGet(url, chunk_size_, abort);
     if (!result.empty()) {
       return result;
     }
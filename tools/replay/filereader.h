@@ -1,20 +1,36 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <string>
 
+#include "tools/replay/filecache.h"
+
 class FileReader {
 public:
+  using Fetcher = std::function<std::string(const std::string &url, std::atomic<bool> *abort)>;
+
   FileReader(bool cache_to_local, size_t chunk_size = 0, int retries = 3)
-      : cache_to_local_(cache_to_local), chunk_size_(chunk_size), max_retries_(retries) {}
+      : cache_(cache_to_local ? &FileCache::instance() : nullptr), chunk_size_(chunk_size), max_retries_(retries) {}
   virtual ~FileReader() {}
   std::string read(const std::string &file, std::atomic<bool> *abort = nullptr);
+  // read a log and decompress it, a remote log is cached in the cache's log format
+  std::string readLog(const std::string &file, std::atomic<bool> *abort = nullptr);
+  // path of a local copy of the file, remote files are always downloaded to the cache
+  std::string localPath(const std::string &file, std::atomic<bool> *abort = nullptr);
+
+  inline void setCache(FileCache *cache) { cache_ = cache; }
+  // replaces the download of remote files, e.g. in tests
+  inline void setFetcher(Fetcher fetcher) { fetcher_ = fetcher; }
 
 private:
   std::string download(const std::string &url, std::atomic<bool> *abort);
+  FileCache *cache_;
+  Fetcher fetcher_;
   size_t chunk_size_;
   int max_retries_;
-  bool cache_to_local_;
 };
 
 std::string cacheFilePath(const std::string &url);
+// decompress bz2 or zstd compressed data, anything else is returned as is
+std::string decompressLog(std::string data, std::atomic<bool> *abort = nullptr);
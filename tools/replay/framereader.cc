@@ -62,12 +62,10 @@ FrameReader::~FrameReader() {
 }
 
 bool FrameReader::load(CameraType type, const std::string &url, bool no_hw_decoder, std::atomic<bool> *abort, bool local_cache, int chunk_size, int retries) {
-  auto local_file_path = url.find("https://") == 0 ? cacheFilePath(url) : url;
-  if (!util::file_exists(local_file_path)) {
-    FileReader f(local_cache, chunk_size, retries);
-    if (f.read(url, abort).empty()) {
-      return false;
-    }
+  // videos are opened by path, so remote ones go through the cache even without local_cache
+  std::string local_file_path = FileReader(local_cache, chunk_size, retries).localPath(url, abort);
+  if (local_file_path.empty()) {
+    return false;
   }
   return loadFromFile(type, local_file_path, no_hw_decoder, abort);
 }
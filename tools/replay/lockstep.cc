@@ -0,0 +1,139 @@
+#include "tools/replay/lockstep.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "cereal/gen/cpp/log.capnp.h"
+#include "cereal/services.h"
+#include "common/timing.h"
+#include "common/util.h"
+#include "tools/replay/util.h"
+
+std::string lockstepAckPath() {
+  std::string prefix = util::getenv("OPENPILOT_PREFIX", "");
+  return "/tmp/replay_ack" + (prefix.empty() ? "" : "_" + prefix);
+}
+
+static bool ack_address(const std::string &path, sockaddr_un &addr) {
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) return false;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  return true;
+}
+
+bool lockstepAck(const std::string &consumer) {
+  static int sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+  sockaddr_un addr;
+  if (sock < 0 || !ack_address(lockstepAckPath(), addr)) return false;
+  return sendto(sock, consumer.data(), consumer.size(), 0, (sockaddr *)&addr, sizeof(addr)) == (ssize_t)consumer.size();
+}
+
+Lockstep::Lockstep(const std::vector<std::string> &consumers) {
+  auto event_schema = capnp::Schema::from<cereal::Event>().asStruct();
+  for (const auto &c : consumers) {
+    auto name_service = split(c, ':');
+    if (name_service.size() != 2 || services.count(name_service[1]) == 0) {
+      rError("invalid lockstep consumer \"%s\", expected <name>:<service>", c.c_str());
+      consumers_.clear();
+      return;
+    }
+    int which = event_schema.getFieldByName(name_service[1]).getProto().getDiscriminantValue();
+    consumers_.push_back({.name = name_service[0]});
+    triggers_[which].push_back(consumers_.size() - 1);
+  }
+
+  sockaddr_un addr;
+  path_ = lockstepAckPath();
+  if (!ack_address(path_, addr)) return;
+
+  sock_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+  unlink(path_.c_str());
+  if (sock_ < 0 || bind(sock_, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    rError("failed to bind lockstep ack socket %s: %s", path_.c_str(), strerror(errno));
+    if (sock_ >= 0) close(sock_);
+    sock_ = -1;
+    return;
+  }
+  rInfo("lockstep: waiting for acks on %s", path_.c_str());
+}
+
+Lockstep::~Lockstep() {
+  if (sock_ >= 0) {
+    close(sock_);
+    unlink(path_.c_str());
+    rInfo("%s", report().c_str());
+  }
+}
+
+void Lockstep::published(int which) {
+  uint64_t ts = nanos_since_boot();
+  for (size_t i : triggers_.at(which)) {
+    ++consumers_[i].sent;
+    consumers_[i].published_ts = ts;
+  }
+}
+
+void Lockstep::receiveAcks(int timeout_ms) {
+  pollfd fd = {.fd = sock_, .events = POLLIN};
+  if (poll(&fd, 1, timeout_ms) <= 0) return;
+
+  char buf[256];
+  ssize_t n;
+  while ((n = recv(sock_, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+    std::string_view name(buf, n);
+    auto it = std::find_if(consumers_.begin(), consumers_.end(), [&](auto &c) { return c.name == name; });
+    if (it == consumers_.end()) {
+      rWarning("lockstep: ack from unknown consumer %.*s", (int)n, buf);
+    } else if (!it->subscribed) {
+      it->subscribed = true;
+      rInfo("lockstep: %s subscribed", it->name.c_str());
+    } else if (it->acked < it->sent) {
+      ++it->acked;
+      // there is only one message in flight per consumer
+      it->latency_ms.push_back((nanos_since_boot() - it->published_ts) / 1e6);
+    }
+  }
+}
+
+bool Lockstep::waitForAcks(int which, std::atomic<bool> &abort) {
+  const auto &waiting_for = triggers_.at(which);
+  double begin = millis_since_boot();
+  double last_warning = begin;
+  while (!abort) {
+    auto pending = std::find_if(waiting_for.begin(), waiting_for.end(),
+                                [this](size_t i) { return !consumers_[i].subscribed || consumers_[i].acked < consumers_[i].sent; });
+    if (pending == waiting_for.end()) return true;
+
+    receiveAcks(100);
+    // keep waiting, a dropped message would make the results differ between runs
+    if (double now = millis_since_boot(); now - last_warning > 5000) {
+      rWarning("lockstep: waiting %.0f s for %s", (now - begin) / 1000, consumers_[*pending].name.c_str());
+      last_warning = now;
+    }
+  }
+  return false;
+}
+
+std::string Lockstep::report() const {
+  std::string ret = "lockstep ack latency:";
+  for (auto c : consumers_) {
+    if (c.latency_ms.empty()) {
+      ret += util::string_format("\n  %s: no acks", c.name.c_str());
+      continue;
+    }
+    std::sort(c.latency_ms.begin(), c.latency_ms.end());
+    auto percentile = [&](double p) { return c.latency_ms[std::min<size_t>(c.latency_ms.size() * p, c.latency_ms.size() - 1)]; };
+    double sum = std::accumulate(c.latency_ms.begin(), c.latency_ms.end(), 0.0);
+    ret += util::string_format("\n  %s: %zu acks, mean %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms",
+                               c.name.c_str(), c.latency_ms.size(), sum / c.latency_ms.size(),
+                               percentile(0.5), percentile(0.99), c.latency_ms.back());
+  }
+  return ret;
+}
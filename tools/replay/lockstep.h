@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+// Lockstep publishing for offline reprocessing. Each registered consumer names a service it
+// processes. After publishing a message of that service, replay waits until the consumer sends
+// an acknowledgement to the ack socket, so it runs as fast as the slowest consumer and nothing
+// gets dropped by conflation.
+//
+// The ack socket is a unix datagram socket at lockstepAckPath(), any number of consumers can
+// send to it. An ack is a datagram containing just the consumer name. A consumer sends one
+// ack once it's subscribed, nothing is published to it before that, then one per message.
+class Lockstep {
+public:
+  // consumers are "name:service" pairs, e.g. {"modeld:roadEncodeIdx", "controlsd:carState"}
+  Lockstep(const std::vector<std::string> &consumers);
+  ~Lockstep();
+  bool isValid() const { return sock_ >= 0 && !consumers_.empty(); }
+  inline bool isTrigger(int which) const { return triggers_.count(which) > 0; }
+  // record a published message of service `which`
+  void published(int which);
+  // wait until every consumer of `which` acknowledged all its messages.
+  // returns false if interrupted by `abort`.
+  bool waitForAcks(int which, std::atomic<bool> &abort);
+  // per consumer ack latencies
+  std::string report() const;
+
+private:
+  struct Consumer {
+    std::string name;
+    bool subscribed = false;
+    uint64_t sent = 0;
+    uint64_t acked = 0;
+    uint64_t published_ts = 0;
+    std::vector<float> latency_ms;
+  };
+  void receiveAcks(int timeout_ms);
+
+  int sock_ = -1;
+  std::string path_;
+  std::vector<Consumer> consumers_;
+  std::map<int, std::vector<size_t>> triggers_;  // service -> consumers
+};
+
+std::string lockstepAckPath();
+// consumer side: acknowledge one processed message
+bool lockstepAck(const std::string &consumer);
@@ -3,11 +3,14 @@
 #include <QApplication>
 #include <iostream>
 #include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "common/prefix.h"
 #include "tools/replay/consoleui.h"
+#include "tools/replay/filecache.h"
+#include "tools/replay/multireplay.h"
 #include "tools/replay/replay.h"
 #include "tools/replay/util.h"
 
@@ -26,10 +29,17 @@ Options:
       --ecam         Load wide road camera
       --no-loop      Stop at the end of the route
       --no-cache     Turn off local cache
+      --disk-cache   Limit the local cache to <GB>. Default is 20
+      --disk-cache-format Store cached logs <original|raw|zstd>. Default is zstd
       --qcam         Load qcamera
       --no-hw-decoder Disable HW video decoding
       --no-vipc      Do not output video
       --all          Output all messages including uiDebug, userFlag
+      --loop         Play <begin,end> seconds in a loop, kept in memory
+      --lockstep     Publish in lockstep with consumers <name:service,...>
+      --compare      Replay more routes <route,...> side by side, in sync with the first one
+      --sync         Align the routes on <start|engaged|gps|service name>. Default is start
+      --socket-prefix Socket prefix of each route <prefix,...>. Default is r<n>_ after the first one
   -h, --help         Show this help message
 )";
 
@@ -43,6 +53,13 @@ struct ReplayConfig {
   int start_seconds = 0;
   int cache_segments = -1;
   float playback_speed = -1;
+  std::optional<std::pair<double, double>> loop;
+  std::vector<std::string> lockstep;
+  std::vector<std::string> compare;
+  std::vector<std::string> socket_prefixes;
+  std::string sync = "start";
+  double disk_cache_gb = -1;
+  std::string disk_cache_format;
 };
 
 bool parseArgs(int argc, char *argv[], ReplayConfig &config) {
@@ -63,6 +80,13 @@ bool parseArgs(int argc, char *argv[], ReplayConfig &config) {
       {"no-hw-decoder", no_argument, nullptr, 0},
       {"no-vipc", no_argument, nullptr, 0},
       {"all", no_argument, nullptr, 0},
+      {"loop", required_argument, nullptr, 0},
+      {"lockstep", required_argument, nullptr, 0},
+      {"compare", required_argument, nullptr, 0},
+      {"sync", required_argument, nullptr, 0},
+      {"socket-prefix", required_argument, nullptr, 0},
+      {"disk-cache", required_argument, nullptr, 0},
+      {"disk-cache-format", required_argument, nullptr, 0},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, 0, nullptr, 0},  // Terminating entry
   };
@@ -97,6 +121,22 @@ bool parseArgs(int argc, char *argv[], ReplayConfig &config) {
         std::string name = cli_options[option_index].name;
         if (name == "demo") {
           config.route = DEMO_ROUTE;
+        } else if (name == "loop") {
+          auto range = split(optarg, ',');
+          if (range.size() != 2) return false;
+          config.loop = {std::atof(range[0].c_str()), std::atof(range[1].c_str())};
+        } else if (name == "lockstep") {
+          config.lockstep = split(optarg, ',');
+        } else if (name == "compare") {
+          config.compare = split(optarg, ',');
+        } else if (name == "sync") {
+          config.sync = optarg;
+        } else if (name == "socket-prefix") {
+          config.socket_prefixes = split(optarg, ',');
+        } else if (name == "disk-cache") {
+          config.disk_cache_gb = std::atof(optarg);
+        } else if (name == "disk-cache-format") {
+          config.disk_cache_format = optarg;
         } else {
           config.flags |= flag_map.at(name);
         }
@@ -120,6 +160,34 @@ bool parseArgs(int argc, char *argv[], ReplayConfig &config) {
   return true;
 }
 
+int runMultiReplay(QCoreApplication &app, const ReplayConfig &config) {
+  const std::map<std::string, SyncKey> sync_keys = {
+      {"start", SyncKey::RouteStart},
+      {"engaged", SyncKey::FirstEngaged},
+      {"gps", SyncKey::GpsTime},
+  };
+  auto it = sync_keys.find(config.sync);
+  SyncKey sync_key = it != sync_keys.end() ? it->second : SyncKey::Event;
+
+  std::vector<std::string> routes = {config.route};
+  routes.insert(routes.end(), config.compare.begin(), config.compare.end());
+  MultiReplay multi_replay(routes, config.socket_prefixes, config.allow, config.block, config.flags, config.data_dir, &app);
+  if (config.cache_segments > 0) {
+    multi_replay.setSegmentCacheLimit(config.cache_segments);
+  }
+  if (config.playback_speed > 0) {
+    multi_replay.leader()->setSpeed(std::clamp(config.playback_speed, ConsoleUI::speed_array.front(), ConsoleUI::speed_array.back()));
+  }
+  if (!multi_replay.load(sync_key, config.sync)) {
+    return 1;
+  }
+
+  // the console controls the first route, the others follow it
+  ConsoleUI console_ui(multi_replay.leader());
+  multi_replay.start(config.start_seconds);
+  return app.exec();
+}
+
 int main(int argc, char *argv[]) {
 #ifdef __APPLE__
   // With all sockets opened, we might hit the default limit of 256 on macOS
@@ -138,6 +206,28 @@ int main(int argc, char *argv[]) {
     op_prefix = std::make_unique<OpenpilotPrefix>(config.prefix);
   }
 
+  // the cache directory depends on the prefix
+  if (config.disk_cache_gb > 0) {
+    FileCache::instance().setMaxBytes(config.disk_cache_gb * 1024 * 1024 * 1024);
+  }
+  if (!config.disk_cache_format.empty()) {
+    const std::map<std::string, FileCache::LogFormat> formats = {
+        {"original", FileCache::LogFormat::Original},
+        {"raw", FileCache::LogFormat::Raw},
+        {"zstd", FileCache::LogFormat::Zstd},
+    };
+    auto it = formats.find(config.disk_cache_format);
+    if (it == formats.end()) {
+      std::cerr << "Invalid disk cache format " << config.disk_cache_format << "\n";
+      return 1;
+    }
+    FileCache::instance().setLogFormat(it->second);
+  }
+
+  if (!config.compare.empty()) {
+    return runMultiReplay(app, config);
+  }
+
   Replay *replay = new Replay(config.route, config.allow, config.block, nullptr, config.flags, config.data_dir, &app);
   if (config.cache_segments > 0) {
     replay->setSegmentCacheLimit(config.cache_segments);
@@ -145,9 +235,16 @@ int main(int argc, char *argv[]) {
   if (config.playback_speed > 0) {
     replay->setSpeed(std::clamp(config.playback_speed, ConsoleUI::speed_array.front(), ConsoleUI::speed_array.back()));
   }
+  if (!config.lockstep.empty() && !replay->setLockstep(config.lockstep)) {
+    return 1;
+  }
   if (!replay->load()) {
     return 1;
   }
+  if (config.loop) {
+    replay->setLoop(config.loop->first, config.loop->second);
+    if (config.start_seconds == 0) config.start_seconds = config.loop->first;
+  }
 
   ConsoleUI console_ui(replay);
   replay->start(config.start_seconds);
@@ -0,0 +1,156 @@
+#include "tools/replay/multireplay.h"
+
+#include <algorithm>
+
+#include <capnp/dynamic.h>
+
+#include "cereal/services.h"
+
+std::optional<SyncPoint> findSyncPoint(const Route *route, SyncKey key, const std::string &service,
+                                       bool local_cache, std::atomic<bool> *abort) {
+  if (key == SyncKey::RouteStart) return SyncPoint{};
+
+  int which = -1;
+  if (key == SyncKey::Event) {
+    if (services.count(service) == 0) {
+      rError("invalid sync service %s", service.c_str());
+      return std::nullopt;
+    }
+    auto event_schema = capnp::Schema::from<cereal::Event>().asStruct();
+    which = event_schema.getFieldByName(service).getProto().getDiscriminantValue();
+  }
+
+  uint64_t route_start_ts = 0;
+  for (const auto &[n, files] : route->segments()) {
+    if (abort && *abort) break;
+
+    LogReader log;
+    const std::string &file = files.qlog.empty() ? files.rlog : files.qlog;
+    if (file.empty() || !log.load(file, abort, local_cache, 0, 3) || log.events.empty()) continue;
+    if (route_start_ts == 0) route_start_ts = log.events.front().mono_time;
+
+    for (const Event &e : log.events) {
+      const double seconds = (e.mono_time - route_start_ts) / 1e9;
+      if (key == SyncKey::Event && e.which == which) {
+        return SyncPoint{.seconds = seconds};
+      } else if (key == SyncKey::FirstEngaged && e.which == cereal::Event::Which::SELFDRIVE_STATE) {
+        capnp::FlatArrayMessageReader reader(e.data);
+        if (reader.getRoot<cereal::Event>().getSelfdriveState().getEnabled()) {
+          return SyncPoint{.seconds = seconds};
+        }
+      } else if (key == SyncKey::GpsTime && (e.which == cereal::Event::Which::GPS_LOCATION_EXTERNAL ||
+                                             e.which == cereal::Event::Which::GPS_LOCATION)) {
+        capnp::FlatArrayMessageReader reader(e.data);
+        auto event = reader.getRoot<cereal::Event>();
+        auto gps = e.which == cereal::Event::Which::GPS_LOCATION ? event.getGpsLocation() : event.getGpsLocationExternal();
+        if (gps.getHasFix() && gps.getUnixTimestampMillis() > 0) {
+          return SyncPoint{.seconds = seconds, .unix_time = gps.getUnixTimestampMillis() / 1e3};
+        }
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+MultiReplay::MultiReplay(const std::vector<std::string> &routes, const std::vector<std::string> &socket_prefixes,
+                         std::vector<std::string> allow, std::vector<std::string> block, uint32_t flags,
+                         const std::string &data_dir, QObject *parent) : QObject(parent) {
+  assert(!routes.empty());
+  for (int i = 0; i < routes.size(); ++i) {
+    // looping is up to the leader, a follower restarting on its own would get out of sync
+    uint32_t replay_flags = i == 0 ? flags : flags | REPLAY_FLAG_NO_LOOP;
+    auto replay = std::make_unique<Replay>(routes[i], allow, block, nullptr, replay_flags, data_dir);
+    // by default the leader publishes on the usual sockets, the others on "r<i>_<service>"
+    replay->setSocketPrefix(i < socket_prefixes.size() ? socket_prefixes[i] : (i == 0 ? "" : "r" + std::to_string(i) + "_"));
+    replays_.push_back(std::move(replay));
+  }
+  offsets_.resize(replays_.size(), 0);
+  pending_seek_.resize(replays_.size());
+
+  QObject::connect(leader(), &Replay::seekedTo, this, &MultiReplay::leaderSeekedTo);
+  for (int i = 1; i < replays_.size(); ++i) {
+    QObject::connect(replays_[i].get(), &Replay::streamStarted, this, [this, i]() {
+      // seconds are only valid once the stream started, see Replay::startStream
+      if (auto sec = std::exchange(pending_seek_[i], std::nullopt)) {
+        replays_[i]->seekTo(*sec, false);
+      }
+    });
+  }
+  QObject::connect(&sync_timer_, &QTimer::timeout, this, &MultiReplay::sync);
+}
+
+MultiReplay::~MultiReplay() {
+  sync_timer_.stop();
+}
+
+bool MultiReplay::load(SyncKey key, const std::string &service) {
+  std::vector<SyncPoint> sync_points;
+  for (auto &r : replays_) {
+    if (!r->load()) return false;
+
+    auto sync_point = findSyncPoint(r->route(), key, service, !r->hasFlag(REPLAY_FLAG_NO_FILE_CACHE));
+    if (!sync_point) {
+      rError("failed to find the sync point in route %s", r->route()->name().c_str());
+      return false;
+    }
+    sync_points.push_back(*sync_point);
+  }
+
+  for (int i = 1; i < replays_.size(); ++i) {
+    if (key == SyncKey::GpsTime) {
+      // align on the same wall time
+      offsets_[i] = (sync_points[i].seconds - sync_points[i].unix_time) - (sync_points[0].seconds - sync_points[0].unix_time);
+    } else {
+      offsets_[i] = sync_points[i].seconds - sync_points[0].seconds;
+    }
+    rInfo("route %s (%s*) is %.2f s ahead of %s", replays_[i]->route()->name().c_str(),
+          replays_[i]->socketPrefix().c_str(), offsets_[i], leader()->route()->name().c_str());
+  }
+  return true;
+}
+
+void MultiReplay::start(int seconds) {
+  for (int i = 1; i < replays_.size(); ++i) {
+    replays_[i]->start();
+  }
+  // followers seek once the leader got there
+  leader()->start(seconds);
+  sync_timer_.start(100);
+}
+
+void MultiReplay::setSegmentCacheLimit(int n) {
+  for (auto &r : replays_) {
+    r->setSegmentCacheLimit(n / replays_.size());
+  }
+}
+
+void MultiReplay::leaderSeekedTo(double sec) {
+  for (int i = 1; i < replays_.size(); ++i) {
+    if (replays_[i]->routeStartNanos() == 0) {
+      pending_seek_[i] = sec + offsets_[i];
+    } else {
+      replays_[i]->seekTo(sec + offsets_[i], false);
+    }
+  }
+}
+
+void MultiReplay::sync() {
+  // hold the replays that are ahead of the slowest one
+  std::vector<std::optional<double>> aligned(replays_.size());
+  std::optional<double> slowest;
+  for (int i = 0; i < replays_.size(); ++i) {
+    auto &r = replays_[i];
+    bool finished = r->currentSeconds() >= r->maxSeconds() - 1;
+    if (r->routeStartNanos() != 0 && !finished && !pending_seek_[i]) {
+      aligned[i] = r->currentSeconds() - offsets_[i];
+      slowest = std::min(slowest.value_or(*aligned[i]), *aligned[i]);
+    }
+    if (i > 0) {
+      r->setSpeed(leader()->getSpeed());
+      if (r->isPaused() != leader()->isPaused()) r->pause(leader()->isPaused());
+    }
+  }
+  for (int i = 0; i < replays_.size(); ++i) {
+    replays_[i]->hold(slowest && aligned[i] && *aligned[i] - *slowest > MAX_SYNC_ERROR);
+  }
+}
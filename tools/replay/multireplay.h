@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <QTimer>
+
+#include "tools/replay/replay.h"
+
+enum class SyncKey {
+  RouteStart,
+  FirstEngaged,
+  GpsTime,
+  Event,  // first message of a service
+};
+
+struct SyncPoint {
+  double seconds = 0;  // from the route start
+  double unix_time = 0;  // only for SyncKey::GpsTime
+};
+
+// find the sync point by scanning the qlogs (or rlogs) of the route
+std::optional<SyncPoint> findSyncPoint(const Route *route, SyncKey key, const std::string &service = {},
+                                       bool local_cache = true, std::atomic<bool> *abort = nullptr);
+
+// Replays several routes side by side, each under its own socket prefix, aligned on a sync point.
+// The first route leads: seeking, pausing and speed changes on it are followed by the others,
+// and a replay that gets ahead (e.g. while another is loading a segment) is held until the
+// others catch up.
+class MultiReplay : public QObject {
+  Q_OBJECT
+
+public:
+  MultiReplay(const std::vector<std::string> &routes, const std::vector<std::string> &socket_prefixes,
+              std::vector<std::string> allow, std::vector<std::string> block, uint32_t flags = REPLAY_FLAG_NONE,
+              const std::string &data_dir = "", QObject *parent = nullptr);
+  ~MultiReplay();
+  bool load(SyncKey key, const std::string &service = {});
+  void start(int seconds = 0);
+  // total number of cached segments, split between the routes
+  void setSegmentCacheLimit(int n);
+  inline Replay *leader() const { return replays_[0].get(); }
+  inline const std::vector<std::unique_ptr<Replay>> &replays() const { return replays_; }
+  // seconds route i is ahead of the leader
+  inline double offset(int i) const { return offsets_[i]; }
+
+private:
+  void leaderSeekedTo(double sec);
+  void sync();
+
+  std::vector<std::unique_ptr<Replay>> replays_;
+  std::vector<double> offsets_;
+  // seek of a follower whose stream hasn't started yet
+  std::vector<std::optional<double>> pending_seek_;
+  QTimer sync_timer_;
+  static constexpr double MAX_SYNC_ERROR = 0.1;  // seconds
+};
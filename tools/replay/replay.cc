@@ -3,10 +3,13 @@
 #include <QDebug>
 #include <QtConcurrent>
 #include <capnp/dynamic.h>
+#include <climits>
 #include <csignal>
+#include <thread>
 #include "cereal/services.h"
 #include "common/params.h"
 #include "common/timing.h"
+#include "common/util.h"
 #include "tools/replay/util.h"
 
 static void interrupt_sleep_handler(int signal) {}
@@ -42,13 +45,6 @@ Replay::Replay(const std::string &route, std::vector<std::string> allow, std::ve
 
   rInfo("active services: %s", join(active_services, ',').c_str());
   rInfo("loading route %s", route.c_str());
-
-  if (sm == nullptr) {
-    std::vector<const char *> socket_names;
-    std::copy_if(sockets_.begin(), sockets_.end(), std::back_inserter(socket_names),
-                 [](const char *name) { return name != nullptr; });
-    pm = std::make_unique<PubMaster>(socket_names);
-  }
   route_ = std::make_unique<Route>(route, data_dir);
 }
 
@@ -69,7 +65,10 @@ void Replay::stop() {
     rInfo("shutdown: done");
   }
   timeline_future.waitForFinished();
+  lockstep_.reset();
   camera_server_.reset(nullptr);
+  std::atomic_store(&event_timeline_, std::shared_ptr<const EventTimeline>(std::make_shared<EventTimeline>()));
+  retired_timelines_.clear();
   segments_.clear();
 }
 
@@ -96,6 +95,26 @@ bool Replay::load() {
   return true;
 }
 
+bool Replay::setLockstep(const std::vector<std::string> &consumers) {
+  assert(stream_thread_ == nullptr);
+  lockstep_ = std::make_unique<Lockstep>(consumers);
+  if (!lockstep_->isValid()) {
+    lockstep_.reset();
+    return false;
+  }
+  return true;
+}
+
+void Replay::addFrameSink(CameraServer::FrameSink *sink) {
+  frame_sinks_.push_back(sink);
+  if (camera_server_) camera_server_->addFrameSink(sink);
+}
+
+void Replay::removeFrameSink(CameraServer::FrameSink *sink) {
+  frame_sinks_.erase(std::remove(frame_sinks_.begin(), frame_sinks_.end(), sink), frame_sinks_.end());
+  if (camera_server_) camera_server_->removeFrameSink(sink);
+}
+
 void Replay::start(int seconds) {
   seekTo(route_->identifier().begin_segment * 60 + seconds, false);
 }
@@ -105,7 +124,7 @@ void Replay::updateEvents(const std::function<bool()> &update_events_function) {
   {
     std::unique_lock lk(stream_lock_);
     events_ready_ = update_events_function();
-    paused_ = user_paused_;
+    paused_ = user_paused_ || held_;
   }
   stream_cv_.notify_one();
 }
@@ -135,6 +154,53 @@ void Replay::seekTo(double seconds, bool relative) {
   updateSegmentsCache();
 }
 
+void Replay::setLoop(double begin, double end) {
+  begin = std::max(begin, minSeconds());
+  end = std::min(end, maxSeconds());
+  if (end <= begin) {
+    rWarning("invalid loop %.2f - %.2f s", begin, end);
+    return;
+  }
+
+  updateEvents([&]() {
+    loop_ = {begin, end};
+    loop_jitter_ = {};
+    return events_ready_.load();
+  });
+  rInfo("loop %.2f - %.2f s", begin, end);
+  if (int n = std::ceil(end / 60) - int(begin / 60); n > segment_cache_limit) {
+    rWarning("the loop region pins %d segments, more than the segment cache limit %d", n, segment_cache_limit);
+  }
+  updateLoopCache();
+  updateSegmentsCache();
+  if (stream_thread_ && (currentSeconds() < begin || currentSeconds() >= end)) {
+    seekTo(begin, false);
+  }
+}
+
+void Replay::clearLoop() {
+  if (!loop_) return;
+
+  updateEvents([&]() {
+    loop_.reset();
+    return events_ready_.load();
+  });
+  rInfo("loop cleared");
+  updateLoopCache();
+  updateSegmentsCache();
+}
+
+void Replay::updateLoopCache() {
+  if (!camera_server_) return;
+
+  if (loop_) {
+    camera_server_->setFrameCache(LOOP_FRAME_CACHE_SIZE, route_start_ts_ + loop_->first * 1e9,
+                                  route_start_ts_ + loop_->second * 1e9);
+  } else {
+    camera_server_->setFrameCache(0);
+  }
+}
+
 void Replay::checkSeekProgress() {
   if (seeking_to_) {
     auto it = segments_.find(int(*seeking_to_ / 60));
@@ -252,7 +318,20 @@ void Replay::pause(bool pause) {
     {
       std::unique_lock lk(stream_lock_);
       rWarning("%s at %.2f s", pause ? "paused..." : "resuming", currentSeconds());
-      paused_ = user_paused_ = pause;
+      user_paused_ = pause;
+      paused_ = user_paused_ || held_;
+    }
+    stream_cv_.notify_one();
+  }
+}
+
+void Replay::hold(bool hold) {
+  if (held_ != hold) {
+    pauseStreamThread();
+    {
+      std::unique_lock lk(stream_lock_);
+      held_ = hold;
+      paused_ = user_paused_ || held_;
     }
     stream_cv_.notify_one();
   }
@@ -288,11 +367,32 @@ void Replay::updateSegmentsCache() {
   begin = std::prev(end, std::min<int>(segment_cache_limit, std::distance(segments_.begin(), end)));
 
   loadSegmentInRange(begin, cur, end);
-  mergeSegments(begin, end);
+
+  // the segments of the loop region are pinned, wherever the current segment is
+  auto pinned = [this](int n) { return loop_ && n >= int(loop_->first / 60) && n < std::ceil(loop_->second / 60); };
+  auto merge_begin = begin, merge_end = end;
+  if (loop_) {
+    auto loop_begin = segments_.lower_bound(int(loop_->first / 60));
+    auto loop_end = segments_.lower_bound(int(std::ceil(loop_->second / 60)));
+    loadSegmentInRange(loop_begin, loop_begin, loop_end);
+
+    // both ranges contain the current segment, so their union is contiguous. Elsewhere the pinned
+    // segments stay loaded for the next pass but out of the timeline, the stream would skip the gap.
+    if (pinned(cur->first)) {
+      auto key = [this](auto it) { return it == segments_.end() ? INT_MAX : it->first; };
+      if (key(loop_begin) < key(merge_begin)) merge_begin = loop_begin;
+      if (key(loop_end) > key(merge_end)) merge_end = loop_end;
+    }
+  }
 
   // free segments out of current semgnt window.
-  std::for_each(segments_.begin(), begin, [](auto &e) { e.second.reset(nullptr); });
-  std::for_each(end, segments_.end(), [](auto &e) { e.second.reset(nullptr); });
+  auto free_segments = [&](auto first, auto last) {
+    std::for_each(first, last, [&](auto &e) { if (!pinned(e.first)) e.second.reset(); });
+  };
+  free_segments(segments_.begin(), begin);
+  free_segments(end, segments_.end());
+  mergeSegments(merge_begin, merge_end);
+  releaseTimelines();
 
   // start stream thread
   const auto &cur_segment = cur->second;
@@ -306,7 +406,7 @@ void Replay::loadSegmentInRange(SegmentMap::iterator begin, SegmentMap::iterator
     auto it = std::find_if(first, last, [](const auto &seg_it) { return !seg_it.second || !seg_it.second->isLoaded(); });
     if (it != last && !it->second) {
       rDebug("loading segment %d...", it->first);
-      it->second = std::make_unique<Segment>(it->first, route_->at(it->first), flags_, filters_);
+      it->second = std::make_shared<Segment>(it->first, route_->at(it->first), flags_, filters_);
       QObject::connect(it->second.get(), &Segment::loadFinished, this, &Replay::segmentLoadFinished);
       return true;
     }
@@ -334,31 +434,56 @@ void Replay::mergeSegments(const SegmentMap::iterator &begin, const SegmentMap::
   rDebug("merge segments %s", std::accumulate(segments_to_merge.begin(), segments_to_merge.end(), std::string{},
     [](auto & a, int b) { return a + (a.empty() ? "" : ", ") + std::to_string(b); }).c_str());
 
-  std::vector<Event> new_events;
+  auto timeline = std::make_shared<EventTimeline>();
+  auto &new_events = timeline->events;
   new_events.reserve(new_events_size);
 
   // Merge events from segments_to_merge into new_events
   for (int n : segments_to_merge) {
     size_t size = new_events.size();
-    const auto &events = segments_.at(n)->log->events;
+    const auto &segment = segments_.at(n);
+    const auto &events = segment->log->events;
     std::copy_if(events.begin(), events.end(), std::back_inserter(new_events),
                   [this](const Event &e) { return e.which < sockets_.size() && sockets_[e.which] != nullptr; });
     std::inplace_merge(new_events.begin(), new_events.begin() + size, new_events.end());
+    timeline->segments.emplace(n, segment);
   }
 
   if (stream_thread_) {
     emit segmentsMerged();
   }
 
-  updateEvents([&]() {
-    events_.swap(new_events);
-    merged_segments_ = segments_to_merge;
-    // Wake up the stream thread if the current segment is loaded or invalid.
-    return !seeking_to_ && (isSegmentMerged(current_segment_) || (segments_.count(current_segment_) == 0));
-  });
+  // Publish the new snapshot without pausing the stream thread, it switches over before its next event.
+  retired_timelines_.push_back(std::atomic_exchange(&event_timeline_, std::shared_ptr<const EventTimeline>(timeline)));
+  ++timeline_version_;
+  merged_segments_ = segments_to_merge;
+  releaseTimelines();
+
+  // Wake up the stream thread if the current segment is loaded or invalid.
+  if (!seeking_to_ && (isSegmentMerged(current_segment_) || (segments_.count(current_segment_) == 0))) {
+    events_ready_ = true;
+    // stream_lock_ is held while publishing. Only sync with the stream thread if it's about to wait
+    // on stream_cv_, otherwise it sees events_ready_ before it would wait.
+    while (stream_waiting_) {
+      if (stream_lock_.try_lock()) {
+        stream_lock_.unlock();
+        break;
+      }
+      std::this_thread::yield();
+    }
+    stream_cv_.notify_one();
+  }
   checkSeekProgress();
 }
 
+void Replay::releaseTimelines() {
+  // a retired snapshot can't be picked up again, once the stream thread dropped it this is the last reference.
+  // releasing them here frees the segments on the main thread.
+  retired_timelines_.erase(std::remove_if(retired_timelines_.begin(), retired_timelines_.end(),
+                                          [](auto &t) { return t.use_count() == 1; }),
+                           retired_timelines_.end());
+}
+
 void Replay::startStream(const Segment *cur_segment) {
   const auto &events = cur_segment->log->events;
   route_start_ts_ = events.front().mono_time;
@@ -387,8 +512,11 @@ void Replay::startStream(const Segment *cur_segment) {
     builder.setRoot(event.getCarParams());
     auto words = capnp::messageToFlatArray(builder);
     auto bytes = words.asBytes();
-    Params().put("CarParams", (const char *)bytes.begin(), bytes.size());
-    Params().put("CarParamsPersistent", (const char *)bytes.begin(), bytes.size());
+    // a prefixed replay runs next to another one, which owns the params
+    if (socket_prefix_.empty()) {
+      Params().put("CarParams", (const char *)bytes.begin(), bytes.size());
+      Params().put("CarParamsPersistent", (const char *)bytes.begin(), bytes.size());
+    }
   } else {
     rWarning("failed to read CarParams from current segment");
   }
@@ -401,7 +529,20 @@ void Replay::startStream(const Segment *cur_segment) {
         camera_size[type] = {fr->width, fr->height};
       }
     }
-    camera_server_ = std::make_unique<CameraServer>(camera_size);
+    camera_server_ = std::make_unique<CameraServer>(camera_size, socket_prefix_ + "camerad", !hasFlag(REPLAY_FLAG_NO_VIPC_PUBLISH));
+    for (auto sink : frame_sinks_) camera_server_->addFrameSink(sink);
+    updateLoopCache();
+  }
+
+  if (sm == nullptr) {
+    context_.reset(Context::create());
+    pub_sockets_.resize(sockets_.size());
+    for (int i = 0; i < sockets_.size(); ++i) {
+      if (sockets_[i]) {
+        pub_sockets_[i].reset(PubSocket::create(context_.get(), socket_prefix_ + sockets_[i]));
+        assert(pub_sockets_[i]);
+      }
+    }
   }
 
   emit segmentsMerged();
@@ -414,41 +555,44 @@ void Replay::startStream(const Segment *cur_segment) {
   emit streamStarted();
 }
 
-void Replay::publishMessage(const Event *e) {
-  if (event_filter && event_filter(e, filter_opaque)) return;
+bool Replay::publishMessage(const Event *e) {
+  if (event_filter && event_filter(e, filter_opaque)) return false;
 
   if (sm == nullptr) {
     auto bytes = e->data.asBytes();
-    int ret = pm->send(sockets_[e->which], (capnp::byte *)bytes.begin(), bytes.size());
+    int ret = pub_sockets_[e->which]->send((char *)bytes.begin(), bytes.size());
     if (ret == -1) {
       rWarning("stop publishing %s due to multiple publishers error", sockets_[e->which]);
       sockets_[e->which] = nullptr;
+      return false;
     }
   } else {
     capnp::FlatArrayMessageReader reader(e->data);
     auto event = reader.getRoot<cereal::Event>();
     sm->update_msgs(nanos_since_boot(), {{sockets_[e->which], event}});
   }
+  return true;
 }
 
-void Replay::publishFrame(const Event *e) {
+bool Replay::publishFrame(const EventTimeline &timeline, const Event *e) {
   CameraType cam;
   switch (e->which) {
     case cereal::Event::ROAD_ENCODE_IDX: cam = RoadCam; break;
     case cereal::Event::DRIVER_ENCODE_IDX: cam = DriverCam; break;
     case cereal::Event::WIDE_ROAD_ENCODE_IDX: cam = WideRoadCam; break;
-    default: return;  // Invalid event type
+    default: return false;  // Invalid event type
   }
 
   if ((cam == DriverCam && !hasFlag(REPLAY_FLAG_DCAM)) || (cam == WideRoadCam && !hasFlag(REPLAY_FLAG_ECAM)))
-    return;  // Camera isdisabled
+    return false;  // Camera isdisabled
 
-  if (isSegmentMerged(e->eidx_segnum)) {
-    auto &segment = segments_.at(e->eidx_segnum);
-    if (auto &frame = segment->frames[cam]; frame) {
-      camera_server_->pushFrame(cam, frame.get(), e);
+  if (auto it = timeline.segments.find(e->eidx_segnum); it != timeline.segments.end()) {
+    if (auto &frame = it->second->frames[cam]; frame) {
+      camera_server_->pushFrame(cam, frame, e);
+      return true;
     }
   }
+  return false;
 }
 
 void Replay::streamThread() {
@@ -457,45 +601,95 @@ void Replay::streamThread() {
   std::unique_lock lk(stream_lock_);
 
   while (true) {
-    stream_cv_.wait(lk, [=]() { return exit_ || ( events_ready_ && !paused_); });
+    bool waited = false;
+    stream_cv_.wait(lk, [&]() {
+      // set before checking events_ready_, see mergeSegments
+      stream_waiting_ = true;
+      bool ready = exit_ || (events_ready_ && !paused_);
+      if (ready) stream_waiting_ = false;
+      waited |= !ready;
+      return ready;
+    });
     if (exit_) break;
+    // the loop boundary jitter is meaningless after a pause
+    if (waited) loop_wrap_ts_ = 0;
 
+    // the snapshot stays valid while we hold it, no matter how many merges happen meanwhile
+    const int version = timeline_version_;
+    const auto timeline = std::atomic_load(&event_timeline_);
+    const auto &events = timeline->events;
     Event event(cur_which, cur_mono_time_, {});
-    auto first = std::upper_bound(events_.cbegin(), events_.cend(), event);
-    if (first == events_.cend()) {
+    auto first = std::upper_bound(events.cbegin(), events.cend(), event);
+    if (first == events.cend()) {
       rInfo("waiting for events...");
       events_ready_ = false;
+      // don't miss a merge that happened after the snapshot was loaded
+      if (version != timeline_version_) events_ready_ = true;
       continue;
     }
 
-    auto it = publishEvents(first, events_.cend());
+    auto it = publishEvents(*timeline, version, first, events.cend());
 
-    // Ensure frames are sent before unlocking to prevent race conditions
+    // Ensure frames are sent before releasing the snapshot to prevent race conditions
     if (camera_server_) {
       camera_server_->waitForSent();
     }
 
-    if (it != events_.cend()) {
+    if (std::exchange(loop_wrapped_, false)) {
+      cur_which = cereal::Event::Which::INIT_DATA;
+      QMetaObject::invokeMethod(this, [this, sec = loop_->first]() { emit seekedTo(sec); }, Qt::QueuedConnection);
+    } else if (it != events.cend()) {
       cur_which = it->which;
-    } else if (!hasFlag(REPLAY_FLAG_NO_LOOP)) {
-      // Check for loop end and restart if necessary
-      int last_segment = segments_.rbegin()->first;
-      if (current_segment_ >= last_segment && isSegmentMerged(last_segment)) {
-        rInfo("reaches the end of route, restart from beginning");
-        QMetaObject::invokeMethod(this, std::bind(&Replay::seekTo, this, minSeconds(), false), Qt::QueuedConnection);
-      }
+    } else if (!hasFlag(REPLAY_FLAG_NO_LOOP) || loop_) {
+      QMetaObject::invokeMethod(this, &Replay::reachedEnd, Qt::QueuedConnection);
     }
   }
 }
 
-std::vector<Event>::const_iterator Replay::publishEvents(std::vector<Event>::const_iterator first,
+void Replay::reachedEnd() {
+  // Check for loop end and restart if necessary
+  int last_segment = segments_.rbegin()->first;
+  if (current_segment_ >= last_segment && isSegmentMerged(last_segment)) {
+    rInfo("reaches the end of route, restart from %s", loop_ ? "the loop begin" : "beginning");
+    seekTo(loop_ ? loop_->first : minSeconds(), false);
+  }
+}
+
+std::vector<Event>::const_iterator Replay::publishEvents(const EventTimeline &timeline, int version,
+                                                         std::vector<Event>::const_iterator first,
                                                          std::vector<Event>::const_iterator last) {
   uint64_t evt_start_ts = cur_mono_time_;
   uint64_t loop_start_ts = nanos_since_boot();
   double prev_replay_speed = speed_;
 
-  for (; !paused_ && first != last; ++first) {
+  uint64_t region_begin_ts = 0, region_end_ts = UINT64_MAX;
+  if (loop_) {
+    region_begin_ts = route_start_ts_ + loop_->first * 1e9;
+    region_end_ts = route_start_ts_ + loop_->second * 1e9;
+  }
+  // set by the previous call if it wrapped around, unless it was followed by a seek
+  const uint64_t wrap_ts = std::exchange(loop_wrap_ts_, 0);
+  bool measure_wrap = wrap_ts != 0 && evt_start_ts == region_begin_ts - 1;
+
+  // stop at a newer timeline, the caller continues from the same position in it
+  for (; !paused_ && version == timeline_version_ && first != last; ++first) {
     const Event &evt = *first;
+    if (evt.mono_time >= region_end_ts) {
+      // wait for the end of the loop region and start over, the caller continues from its beginning
+      // with a binary search in the same snapshot, the region's segments and frames are all in memory.
+      if (!lockstep_) {
+        const int64_t time_diff = int64_t(region_end_ts - evt_start_ts) / speed_ - (nanos_since_boot() - loop_start_ts);
+        if (time_diff > 0 && time_diff < 1e9) {
+          precise_nano_sleep(time_diff, paused_);
+        }
+        if (paused_) break;
+      }
+      cur_mono_time_ = region_begin_ts - 1;
+      loop_wrapped_ = true;
+      loop_wrap_ts_ = nanos_since_boot();
+      break;
+    }
+
     int segment = toSeconds(evt.mono_time) / 60;
 
     if (current_segment_ != segment) {
@@ -506,6 +700,12 @@ std::vector<Event>::const_iterator Replay::publishEvents(std::vector<Event>::con
      // Skip events if socket is not present
     if (!sockets_[evt.which]) continue;
 
+    if (lockstep_) {
+      // paced by the consumers' acks instead of the clock
+      if (!publishLockstep(timeline, evt)) break;
+      continue;
+    }
+
     cur_mono_time_ = evt.mono_time;
     const uint64_t current_nanos = nanos_since_boot();
     const int64_t time_diff = (evt.mono_time - evt_start_ts) / speed_ - (current_nanos - loop_start_ts);
@@ -523,15 +723,59 @@ std::vector<Event>::const_iterator Replay::publishEvents(std::vector<Event>::con
 
     if (paused_) break;
 
+    if (std::exchange(measure_wrap, false)) {
+      // how late the first event of a new pass is compared to an uninterrupted playback
+      recordLoopJitter(nanos_since_boot() - (wrap_ts + (evt.mono_time - region_begin_ts) / double(speed_)));
+    }
+
     if (evt.eidx_segnum == -1) {
       publishMessage(&evt);
     } else if (camera_server_) {
       if (speed_ > 1.0) {
         camera_server_->waitForSent();
       }
-      publishFrame(&evt);
+      publishFrame(timeline, &evt);
     }
   }
 
   return first;
 }
+
+void Replay::recordLoopJitter(int64_t jitter_ns) {
+  const double ms = jitter_ns / 1e6;
+  ++loop_jitter_.count;
+  loop_jitter_.sum_ms += ms;
+  loop_jitter_.max_ms = std::max(loop_jitter_.max_ms, ms);
+
+  std::string frames;
+  if (camera_server_) {
+    auto stats = camera_server_->frameCacheStats();
+    frames = util::string_format(", frame cache %.1f MB (%zu frames), %lu decoded, %lu cache hits",
+                                 stats.bytes / (1024.0 * 1024.0), stats.frames, stats.decoded, stats.hits);
+  }
+  rInfo("loop %d: boundary jitter %.2f ms (mean %.2f ms, max %.2f ms)%s", loop_jitter_.count, ms,
+        loop_jitter_.sum_ms / loop_jitter_.count, loop_jitter_.max_ms, frames.c_str());
+}
+
+bool Replay::publishLockstep(const EventTimeline &timeline, const Event &evt) {
+  // before the first message, this waits for the consumers to subscribe
+  const bool trigger = lockstep_->isTrigger(evt.which);
+  if (trigger && !lockstep_->waitForAcks(evt.which, paused_)) return false;
+
+  cur_mono_time_ = evt.mono_time;
+  bool sent = false;
+  if (evt.eidx_segnum == -1) {
+    sent = publishMessage(&evt);
+  } else if (camera_server_) {
+    sent = publishFrame(timeline, &evt);
+  }
+  if (sent && trigger) {
+    // the consumer can't ack a frame before it's in the vipc buffer
+    if (evt.eidx_segnum != -1) {
+      camera_server_->waitForSent();
+    }
+    lockstep_->published(evt.which);
+    return lockstep_->waitForAcks(evt.which, paused_);
+  }
+  return true;
+}
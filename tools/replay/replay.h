@@ -13,12 +13,15 @@
 #include <QThread>
 
 #include "tools/replay/camera.h"
+#include "tools/replay/lockstep.h"
 #include "tools/replay/route.h"
 
 #define DEMO_ROUTE "a2a0ccea32023010|2023-07-27--13-01-19"
 
 // one segment uses about 100M of memory
 constexpr int MIN_SEGMENTS_CACHE = 5;
+// decoded frames kept for a loop region, a 1928x1208 frame is about 3.5M
+constexpr size_t LOOP_FRAME_CACHE_SIZE = size_t(2) << 30;
 
 enum REPLAY_FLAGS {
   REPLAY_FLAG_NONE = 0x0000,
@@ -30,6 +33,7 @@ enum REPLAY_FLAGS {
   REPLAY_FLAG_NO_HW_DECODER = 0x0100,
   REPLAY_FLAG_NO_VIPC = 0x0400,
   REPLAY_FLAG_ALL_SERVICES = 0x0800,
+  REPLAY_FLAG_NO_VIPC_PUBLISH = 0x1000,  // the frames only go to the frame sinks
 };
 
 enum class FindFlag {
@@ -45,6 +49,14 @@ enum class TimelineType { None, Engaged, AlertInfo, AlertWarning, AlertCritical,
 typedef bool (*replayEventFilter)(const Event *, void *);
 Q_DECLARE_METATYPE(std::shared_ptr<LogReader>);
 
+// Immutable snapshot of the merged events. Merging publishes a new snapshot instead of
+// modifying the current one, the stream thread picks it up between two events.
+struct EventTimeline {
+  std::vector<Event> events;
+  // the merged segments, keeps the event data and frame readers alive while the snapshot is in use
+  std::map<int, std::shared_ptr<Segment>> segments;
+};
+
 class Replay : public QObject {
   Q_OBJECT
 
@@ -53,13 +65,31 @@ public:
          uint32_t flags = REPLAY_FLAG_NONE, const std::string &data_dir = "", QObject *parent = 0);
   ~Replay();
   bool load();
+  // publish in lockstep with the consumers instead of in real time, see Lockstep.
+  // must be called before start().
+  bool setLockstep(const std::vector<std::string> &consumers);
+  // publish on "<prefix><service>" and the "<prefix>camerad" vipc server. must be called before start().
+  inline void setSocketPrefix(const std::string &prefix) { socket_prefix_ = prefix; }
+  inline const std::string &socketPrefix() const { return socket_prefix_; }
+  // hand the decoded frames to `sink` in the process, see CameraServer::FrameSink. Call these on
+  // the thread of the replay, the camera server is started on it.
+  void addFrameSink(CameraServer::FrameSink *sink);
+  void removeFrameSink(CameraServer::FrameSink *sink);
   RouteLoadError lastRouteError() const { return route_->lastError(); }
   void start(int seconds = 0);
   void stop();
   void pause(bool pause);
   void seekToFlag(FindFlag flag);
   void seekTo(double seconds, bool relative);
+  // Play [begin, end) in a loop. The segments of the region stay loaded and its frames are kept
+  // decoded in memory, so every pass after the first one republishes without loading or decoding.
+  void setLoop(double begin, double end);
+  void clearLoop();
+  inline std::optional<std::pair<double, double>> loop() const { return loop_; }
   inline bool isPaused() const { return user_paused_; }
+  // pause publishing without changing the user's pause state, keeps several replays in sync
+  void hold(bool hold);
+  inline bool isHeld() const { return held_; }
   // the filter is called in streaming thread.try to return quickly from it to avoid blocking streaming.
   // the filter function must return true if the event should be filtered.
   // otherwise it must return false.
@@ -82,8 +112,11 @@ public:
   inline double maxSeconds() const { return max_seconds_; }
   inline void setSpeed(float speed) { speed_ = speed; }
   inline float getSpeed() const { return speed_; }
-  inline const std::vector<Event> *events() const { return &events_; }
-  inline const std::map<int, std::unique_ptr<Segment>> &segments() const { return segments_; }
+  inline std::shared_ptr<const std::vector<Event>> events() const {
+    auto timeline = std::atomic_load(&event_timeline_);
+    return {timeline, &timeline->events};
+  }
+  inline const std::map<int, std::shared_ptr<Segment>> &segments() const { return segments_; }
   inline const std::string &carFingerprint() const { return car_fingerprint_; }
   inline const std::vector<std::tuple<double, double, TimelineType>> getTimeline() {
     std::lock_guard lk(timeline_lock);
@@ -102,7 +135,7 @@ protected slots:
   void segmentLoadFinished(bool success);
 
 protected:
-  typedef std::map<int, std::unique_ptr<Segment>> SegmentMap;
+  typedef std::map<int, std::shared_ptr<Segment>> SegmentMap;
   std::optional<uint64_t> find(FindFlag flag);
   void pauseStreamThread();
   void startStream(const Segment *cur_segment);
@@ -110,11 +143,17 @@ protected:
   void updateSegmentsCache();
   void loadSegmentInRange(SegmentMap::iterator begin, SegmentMap::iterator cur, SegmentMap::iterator end);
   void mergeSegments(const SegmentMap::iterator &begin, const SegmentMap::iterator &end);
+  void releaseTimelines();
   void updateEvents(const std::function<bool()>& update_events_function);
-  std::vector<Event>::const_iterator publishEvents(std::vector<Event>::const_iterator first,
+  std::vector<Event>::const_iterator publishEvents(const EventTimeline &timeline, int version,
+                                                   std::vector<Event>::const_iterator first,
                                                    std::vector<Event>::const_iterator last);
-  void publishMessage(const Event *e);
-  void publishFrame(const Event *e);
+  bool publishMessage(const Event *e);
+  bool publishFrame(const EventTimeline &timeline, const Event *e);
+  bool publishLockstep(const EventTimeline &timeline, const Event &evt);
+  void updateLoopCache();
+  void recordLoopJitter(int64_t jitter_ns);
+  void reachedEnd();
   void buildTimeline();
   void checkSeekProgress();
   inline bool isSegmentMerged(int n) const { return merged_segments_.count(n) > 0; }
@@ -123,6 +162,7 @@ protected:
   QThread *stream_thread_ = nullptr;
   std::mutex stream_lock_;
   bool user_paused_ = false;
+  bool held_ = false;
   std::condition_variable stream_cv_;
   std::atomic<int> current_segment_ = 0;
   std::optional<double> seeking_to_;
@@ -130,21 +170,40 @@ protected:
   // the following variables must be protected with stream_lock_
   std::atomic<bool> exit_ = false;
   std::atomic<bool> paused_ = false;
-  bool events_ready_ = false;
+  // also set by mergeSegments without the lock while the stream thread is publishing
+  std::atomic<bool> events_ready_ = false;
+  std::atomic<bool> stream_waiting_ = false;
   QDateTime route_date_time_;
   uint64_t route_start_ts_ = 0;
   std::atomic<uint64_t> cur_mono_time_ = 0;
   std::atomic<double> max_seconds_ = 0;
-  std::vector<Event> events_;
+  // swapped with std::atomic_store, never modified after it's published
+  std::shared_ptr<const EventTimeline> event_timeline_ = std::make_shared<EventTimeline>();
+  std::atomic<int> timeline_version_ = 0;
+  // replaced snapshots, released on the main thread once the stream thread is done with them
+  std::vector<std::shared_ptr<const EventTimeline>> retired_timelines_;
   std::set<int> merged_segments_;
 
   // messaging
   SubMaster *sm = nullptr;
-  std::unique_ptr<PubMaster> pm;
+  std::string socket_prefix_;
+  std::unique_ptr<Context> context_;
+  std::vector<std::unique_ptr<PubSocket>> pub_sockets_;
   std::vector<const char*> sockets_;
   std::vector<bool> filters_;
   std::unique_ptr<Route> route_;
   std::unique_ptr<CameraServer> camera_server_;
+  std::vector<CameraServer::FrameSink *> frame_sinks_;
+  std::unique_ptr<Lockstep> lockstep_;
+  // loop region in seconds, protected with stream_lock_
+  std::optional<std::pair<double, double>> loop_;
+  // stream thread only
+  bool loop_wrapped_ = false;
+  uint64_t loop_wrap_ts_ = 0;
+  struct {
+    int count = 0;
+    double max_ms = 0, sum_ms = 0;
+  } loop_jitter_;
   std::atomic<uint32_t> flags_ = REPLAY_FLAG_NONE;
 
   std::mutex timeline_lock;
@@ -72,7 +72,8 @@ public:
 
   const int seg_num = 0;
   std::unique_ptr<LogReader> log;
-  std::unique_ptr<FrameReader> frames[MAX_CAMERAS] = {};
+  // shared with the camera server, which may still be decoding ahead when the segment is freed
+  std::shared_ptr<FrameReader> frames[MAX_CAMERAS] = {};
 
 signals:
   void loadFinished(bool success);
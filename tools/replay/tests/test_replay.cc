@@ -1,10 +1,24 @@
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <set>
 #include <thread>
 
+#include <sys/time.h>
+
+#include <QCoreApplication>
 #include <QEventLoop>
+#include <QTimer>
 
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch2/catch.hpp"
+#include "cereal/messaging/messaging.h"
+#include "common/timing.h"
 #include "common/util.h"
+#include "tools/replay/filereader.h"
+#include "tools/replay/multireplay.h"
 #include "tools/replay/replay.h"
 #include "tools/replay/util.h"
 
@@ -59,6 +73,231 @@ TEST_CASE("FileReader") {
   }
 }
 
+std::string temp_dir() {
+  char dir[] = "/tmp/test_cache_XXXXXX";
+  REQUIRE(mkdtemp(dir) != nullptr);
+  return dir;
+}
+
+TEST_CASE("FileCache") {
+  const std::string dir = temp_dir();
+  int fetches = 0;
+  auto fetcher = [&](const std::string &url, std::atomic<bool> *abort) {
+    ++fetches;
+    return std::string(100, url.back());
+  };
+  auto read = [&](FileCache &cache, const std::string &url) {
+    FileReader reader(true);
+    reader.setCache(&cache);
+    reader.setFetcher(fetcher);
+    return reader.read(url);
+  };
+
+  SECTION("evict least recently used") {
+    FileCache cache(dir, 300);
+    for (auto url : {"https://a/1", "https://a/2", "https://a/3"}) {
+      REQUIRE(read(cache, url) == std::string(100, url[10]));
+    }
+    REQUIRE(cache.get("https://a/1"));
+    REQUIRE(read(cache, "https://a/4") == std::string(100, '4'));
+    REQUIRE(cache.totalBytes() == 300);
+    REQUIRE_FALSE(cache.get("https://a/2"));
+    REQUIRE(cache.get("https://a/1"));
+    REQUIRE(fetches == 4);
+
+    // the index survives, files it doesn't know about are misses and evicted first
+    cache.flush();
+    const std::string unknown = dir + "/" + sha256("unknown");
+    util::write_file(unknown.c_str(), "x", 1, O_WRONLY | O_CREAT);
+    // temp files of interrupted writes are removed once they're stale
+    const std::string stale_tmp = cache.path("https://a/3") + ".tmp.123456", fresh_tmp = cache.path("https://a/3") + ".tmp.654321";
+    util::write_file(stale_tmp.c_str(), "x", 1, O_WRONLY | O_CREAT);
+    util::write_file(fresh_tmp.c_str(), "x", 1, O_WRONLY | O_CREAT);
+    struct timeval old_time[2] = {{.tv_sec = time(nullptr) - 2 * 3600}, {.tv_sec = time(nullptr) - 2 * 3600}};
+    REQUIRE(utimes(stale_tmp.c_str(), old_time) == 0);
+    // and url_file.py's chunks in the same directory are left alone
+    const std::string chunk = dir + "/" + sha256("https://a/5") + "_0", length = dir + "/" + sha256("https://a/5") + "_length";
+    util::write_file(chunk.c_str(), "x", 1, O_WRONLY | O_CREAT);
+    util::write_file(length.c_str(), "1", 1, O_WRONLY | O_CREAT);
+    FileCache reopened(dir, 301);
+    REQUIRE(reopened.totalBytes() == 301);
+    REQUIRE(reopened.get("https://a/3"));
+    REQUIRE_FALSE(reopened.get("unknown"));
+    REQUIRE(util::file_exists(unknown));
+    REQUIRE_FALSE(util::file_exists(stale_tmp));
+    REQUIRE(util::file_exists(fresh_tmp));
+    REQUIRE(util::file_exists(chunk));
+    REQUIRE(util::file_exists(length));
+
+    reopened.setMaxBytes(200);
+    REQUIRE(reopened.totalBytes() == 200);
+    REQUIRE_FALSE(util::file_exists(unknown));
+    REQUIRE(reopened.get("https://a/3"));
+  }
+  SECTION("processes share the directory") {
+    FileCache first(dir, 1000);
+    REQUIRE(read(first, "https://a/1") == std::string(100, '1'));
+    // opened before the first one saved its index
+    FileCache second(dir, 1000);
+    REQUIRE(read(second, "https://a/2") == std::string(100, '2'));
+    REQUIRE(util::file_exists(first.path("https://a/1")));
+    REQUIRE(first.get("https://a/1"));
+
+    // both write the index, neither drops the other's entries
+    second.flush();
+    first.flush();
+    second.flush();
+    FileCache third(dir, 1000);
+    REQUIRE(third.totalBytes() == 200);
+    REQUIRE(third.get("https://a/1") == std::string(100, '1'));
+    REQUIRE(third.get("https://a/2") == std::string(100, '2'));
+    REQUIRE(fetches == 2);
+  }
+  SECTION("corrupt files are fetched again") {
+    {
+      FileCache cache(dir, 1000);
+      read(cache, "https://a/1");
+      read(cache, "https://a/2");
+    }
+    // damaged between runs, the checksum is verified on the first read
+    FileCache cache(dir, 1000);
+    std::string path = cache.path("https://a/1");
+    util::write_file(path.c_str(), std::string(100, 'x').data(), 100, O_WRONLY | O_TRUNC);
+    // truncated, as a write interrupted without the atomic rename would leave it
+    util::write_file(cache.path("https://a/2").c_str(), "2", 1, O_WRONLY | O_TRUNC);
+    REQUIRE(read(cache, "https://a/1") == std::string(100, '1'));
+    REQUIRE_FALSE(cache.lookup("https://a/2"));
+    REQUIRE(read(cache, "https://a/2") == std::string(100, '2'));
+    REQUIRE(fetches == 4);
+    REQUIRE(util::read_file(path) == std::string(100, '1'));
+  }
+  system(("rm -rf " + dir).c_str());
+}
+
+TEST_CASE("FileCache log formats") {
+  auto format = GENERATE(FileCache::LogFormat::Original, FileCache::LogFormat::Raw, FileCache::LogFormat::Zstd);
+  const std::string dir = temp_dir();
+  std::string log(1024 * 1024, '\0');
+  for (int i = 0; i < log.size(); ++i) log[i] = i % 251 < 50 ? i % 7 : 0;
+  const std::string compressed = compressZST(log, 19);
+
+  {
+    // the cache writes its index when it's destroyed
+    int fetches = 0;
+    FileCache cache(dir);
+    cache.setLogFormat(format);
+    FileReader reader(true);
+    reader.setCache(&cache);
+    reader.setFetcher([&](const std::string &url, std::atomic<bool> *abort) {
+      ++fetches;
+      return compressed;
+    });
+    const std::string url = "https://a/rlog.zst";
+    REQUIRE(reader.readLog(url) == log);
+    REQUIRE(reader.readLog(url) == log);
+    REQUIRE(fetches == 1);
+
+    std::string cached = util::read_file(cache.path(url));
+    if (format == FileCache::LogFormat::Original) {
+      REQUIRE(cached == compressed);
+    } else if (format == FileCache::LogFormat::Raw) {
+      REQUIRE(cached == log);
+    } else {
+      REQUIRE(decompressZST(cached) == log);
+    }
+  }
+  system(("rm -rf " + dir).c_str());
+}
+
+// about a minute of can traffic and log messages, generated so the benchmarks run offline
+std::string synthetic_log(int seconds = 60, uint64_t mono_time = 1e9) {
+  std::string log;
+  for (int i = 0; i < seconds * 100; ++i, mono_time += 1e7) {
+    MessageBuilder msg;
+    auto event = msg.initEvent();
+    event.setLogMonoTime(mono_time);
+    if (i % 10 == 0) {
+      event.setLogMessage(util::string_format("{\"msg\": \"synthetic message %d\"}", i).c_str());
+    } else {
+      const int can_count = 40;
+      auto can = event.initCan(can_count);
+      for (int j = 0; j < can_count; ++j) {
+        uint8_t dat[8];
+        for (int k = 0; k < 8; ++k) dat[k] = (i * 31 + j * 7 + k) & 0xff;
+        can[j].setAddress(0x100 + j * 8);
+        can[j].setSrc(j % 3);
+        can[j].setDat(kj::arrayPtr(dat, sizeof(dat)));
+      }
+    }
+    auto bytes = msg.toBytes();
+    log.append((const char *)bytes.begin(), bytes.size());
+  }
+  return log;
+}
+
+// a local route of one minute synthetic segments, with a carState event `sync_seconds` after its start
+void write_synthetic_route(const std::string &dir, const std::string &timestamp, int segments, double sync_seconds) {
+  for (int i = 0; i < segments; ++i) {
+    std::string log = synthetic_log(60, 1e9 + i * 60e9);
+    if (i == 0) {
+      MessageBuilder msg;
+      auto event = msg.initEvent();
+      event.setLogMonoTime(1e9 + sync_seconds * 1e9);
+      event.initCarState();
+      auto bytes = msg.toBytes();
+      log.append((const char *)bytes.begin(), bytes.size());
+    }
+    const std::string segment_dir = dir + "/" + timestamp + "--" + std::to_string(i);
+    REQUIRE(util::create_directories(segment_dir, 0755));
+    REQUIRE(util::write_file((segment_dir + "/rlog").c_str(), log.data(), log.size(), O_WRONLY | O_CREAT) == 0);
+  }
+}
+
+TEST_CASE("FileCache warm route open", "[.][benchmark]") {
+  const std::string log = synthetic_log();
+  const std::string compressed = compressZST(log, 19);
+  const std::string url = "https://a/rlog.zst";
+
+  const std::string dir = temp_dir();
+  const std::map<std::string, FileCache::LogFormat> formats = {
+      {"original", FileCache::LogFormat::Original},
+      {"raw", FileCache::LogFormat::Raw},
+      {"zstd", FileCache::LogFormat::Zstd},
+  };
+  for (const auto &[name, format] : formats) {
+    FileCache cache(dir + "/" + name);
+    cache.setLogFormat(format);
+    FileReader reader(true);
+    reader.setCache(&cache);
+    reader.setFetcher([&](const std::string &, std::atomic<bool> *) { return compressed; });
+    REQUIRE(reader.readLog(url) == log);
+    BENCHMARK("open " + name) {
+      std::string data = reader.readLog(url);
+      LogReader log_reader;
+      return log_reader.load(data.data(), data.size());
+    };
+  }
+  system(("rm -rf " + dir).c_str());
+}
+
+TEST_CASE("LogReader benchmark", "[.][benchmark]") {
+  const std::string log = synthetic_log();
+  LogReader log_reader;
+  REQUIRE(log_reader.load(log.data(), log.size()));
+  REQUIRE(log_reader.events.size() == 6000);
+
+  BENCHMARK("load") {
+    LogReader reader;
+    return reader.load(log.data(), log.size());
+  };
+  BENCHMARK("load can only") {
+    std::vector<bool> filters(cereal::Event::Which::CAN + 1);
+    filters[cereal::Event::Which::CAN] = true;
+    LogReader reader(filters);
+    return reader.load(log.data(), log.size());
+  };
+}
+
 TEST_CASE("LogReader") {
   SECTION("corrupt log") {
     FileReader reader(true);
@@ -157,6 +396,76 @@ TEST_CASE("Remote route") {
   }
 }
 
+TEST_CASE("findSyncPoint") {
+  Route route(DEMO_ROUTE, download_demo_route());
+  REQUIRE(route.load());
+
+  REQUIRE(findSyncPoint(&route, SyncKey::RouteStart)->seconds == 0);
+  auto car_params = findSyncPoint(&route, SyncKey::Event, "carParams");
+  REQUIRE(car_params);
+  REQUIRE(car_params->seconds >= 0);
+  REQUIRE(car_params->seconds < 60);
+  if (auto gps = findSyncPoint(&route, SyncKey::GpsTime)) {
+    REQUIRE(gps->unix_time > 1690000000);  // the route is from 2023-07-27
+  }
+  REQUIRE(!findSyncPoint(&route, SyncKey::Event, "invalidService"));
+}
+
+TEST_CASE("MultiReplay") {
+  using namespace std::chrono_literals;
+  const std::string dir = temp_dir();
+  write_synthetic_route(dir, "2024-01-01--00-00-00", 2, 2);
+  write_synthetic_route(dir, "2024-01-01--00-10-00", 2, 5);
+
+  {
+    MultiReplay multi({"2024-01-01--00-00-00", "2024-01-01--00-10-00"}, {}, {}, {},
+                      REPLAY_FLAG_NO_VIPC | REPLAY_FLAG_NO_FILE_CACHE, dir);
+    REQUIRE(multi.load(SyncKey::Event, "carState"));
+    REQUIRE(multi.offset(1) == Approx(3));
+    Replay *leader = multi.leader();
+    Replay *follower = multi.replays()[1].get();
+
+    SECTION("splits the segment cache") {
+      multi.setSegmentCacheLimit(4 * MIN_SEGMENTS_CACHE);
+      REQUIRE(leader->segmentCacheLimit() == 2 * MIN_SEGMENTS_CACHE);
+      REQUIRE(follower->segmentCacheLimit() == 2 * MIN_SEGMENTS_CACHE);
+      // but never below the minimum of a replay
+      multi.setSegmentCacheLimit(MIN_SEGMENTS_CACHE);
+      REQUIRE(leader->segmentCacheLimit() == MIN_SEGMENTS_CACHE);
+      REQUIRE(follower->segmentCacheLimit() == MIN_SEGMENTS_CACHE);
+    }
+
+    SECTION("holds the replay that's ahead") {
+      auto wait_until = [](auto pred, int timeout_ms) {
+        double begin = millis_since_boot();
+        while (!pred() && millis_since_boot() - begin < timeout_ms) {
+          QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+          std::this_thread::sleep_for(1ms);
+        }
+        return pred();
+      };
+      auto aligned = [&]() { return follower->currentSeconds() - multi.offset(1) - leader->currentSeconds(); };
+
+      multi.start();
+      REQUIRE(wait_until([&]() { return follower->routeStartNanos() != 0 && leader->currentSeconds() > 1; }, 10000));
+      REQUIRE(wait_until([&]() { return std::abs(aligned()) < 0.5; }, 5000));
+
+      // the follower falls behind, e.g. while loading a segment, and the leader waits for it
+      follower->seekTo(follower->currentSeconds() - 3, false);
+      REQUIRE(wait_until([&]() { return leader->isHeld(); }, 5000));
+      REQUIRE_FALSE(follower->isHeld());
+      const double held_at = leader->currentSeconds();
+      std::this_thread::sleep_for(500ms);
+      REQUIRE(leader->currentSeconds() == Approx(held_at).margin(0.2));
+
+      // until it caught up
+      REQUIRE(wait_until([&]() { return !leader->isHeld(); }, 10000));
+      REQUIRE(std::abs(aligned()) < 0.5);
+    }
+  }
+  system(("rm -rf " + dir).c_str());
+}
+
 TEST_CASE("seek_to") {
   QEventLoop loop;
   int seek_to = util::random_int(0, 2 * 59);
@@ -174,3 +483,265 @@ TEST_CASE("seek_to") {
 
   loop.exec();
 }
+
+class TestReplay : public Replay {
+public:
+  using Replay::Replay;
+  // merge all loaded segments, or only the first one
+  void merge(bool all) { mergeSegments(segments_.begin(), all ? segments_.end() : std::next(segments_.begin())); }
+};
+
+struct PublishStats {
+  std::atomic<uint64_t> last_publish = 0;
+  std::atomic<uint64_t> max_gap = 0;
+  std::atomic<int> published = 0;
+};
+
+TEST_CASE("Replay timeline stress") {
+  using namespace std::chrono_literals;
+  std::string data_dir = download_demo_route();
+  TestReplay replay(DEMO_ROUTE, {}, {}, nullptr, REPLAY_FLAG_NO_VIPC, data_dir);
+
+  // runs in the stream thread for every published event
+  PublishStats stats;
+  replay.installEventFilter([](const Event *e, void *opaque) {
+    auto s = (PublishStats *)opaque;
+    uint64_t ts = nanos_since_boot();
+    if (uint64_t last = s->last_publish.exchange(ts); last > 0 && ts - last > s->max_gap) {
+      s->max_gap = ts - last;
+    }
+    ++s->published;
+    return true;
+  }, &stats);
+
+  auto wait_until = [](auto pred, int timeout_ms) {
+    double begin = millis_since_boot();
+    while (!pred() && millis_since_boot() - begin < timeout_ms) {
+      QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+      std::this_thread::sleep_for(1ms);
+    }
+    return pred();
+  };
+
+  REQUIRE(replay.load());
+  replay.start();
+  REQUIRE(wait_until([&]() {
+    const auto &segments = replay.segments();
+    return stats.published > 0 && std::all_of(segments.begin(), segments.end(), [](auto &s) { return s.second && s.second->isLoaded(); });
+  }, 60000));
+
+  SECTION("merge while publishing") {
+    double max_merge_ms = 0;
+    int merges = 0;
+    stats.max_gap = 0;
+    const int published = stats.published;
+    for (double begin = millis_since_boot(); millis_since_boot() - begin < 3000; ++merges) {
+      double merge_begin = millis_since_boot();
+      replay.merge(merges % 2);
+      max_merge_ms = std::max(max_merge_ms, millis_since_boot() - merge_begin);
+      QCoreApplication::processEvents();
+    }
+
+    INFO(merges << " merges, max merge time " << max_merge_ms << " ms, max publish gap " << stats.max_gap / 1e6 << " ms");
+    REQUIRE(stats.published > published);
+    // merging never waits for the stream thread, so the gaps are the gaps in the route
+    REQUIRE(stats.max_gap < 200 * 1e6);
+  }
+
+  SECTION("seek while merging") {
+    int merges = 0;
+    for (int i = 0; i < 20; ++i) {
+      const int published = stats.published;
+      double seek_begin = millis_since_boot();
+      replay.seekTo(util::random_int(0, 110), false);
+      bool resumed = wait_until([&]() {
+        replay.merge(++merges % 2);
+        return stats.published > published;
+      }, 10000);
+
+      INFO("seek " << i << " resumed after " << millis_since_boot() - seek_begin << " ms");
+      REQUIRE(resumed);
+    }
+  }
+}
+
+TEST_CASE("Lockstep") {
+  using namespace std::chrono_literals;
+  Lockstep lockstep({"a:carState", "b:carState", "c:roadEncodeIdx"});
+  REQUIRE(lockstep.isValid());
+
+  const int car_state = cereal::Event::Which::CAR_STATE;
+  REQUIRE(lockstep.isTrigger(car_state));
+  REQUIRE(!lockstep.isTrigger(cereal::Event::Which::CONTROLS_STATE));
+
+  std::atomic<bool> abort = false;
+  // nothing is published before the consumers subscribed
+  std::thread([]() { lockstepAck("a"); lockstepAck("b"); }).join();
+  REQUIRE(lockstep.waitForAcks(car_state, abort));
+
+  for (int i = 0; i < 10; ++i) {
+    lockstep.published(car_state);
+    std::thread consumers([]() {
+      std::this_thread::sleep_for(1ms);
+      lockstepAck("b");
+      lockstepAck("a");
+    });
+    REQUIRE(lockstep.waitForAcks(car_state, abort));
+    consumers.join();
+  }
+
+  SECTION("waits for the slowest consumer") {
+    lockstep.published(car_state);
+    lockstepAck("a");
+    std::thread pause([&]() { std::this_thread::sleep_for(200ms); abort = true; });
+    REQUIRE(!lockstep.waitForAcks(car_state, abort));
+    pause.join();
+  }
+  SECTION("ignores acks from unknown consumers") {
+    lockstep.published(car_state);
+    lockstepAck("a");
+    lockstepAck("x");
+    lockstepAck("b");
+    REQUIRE(lockstep.waitForAcks(car_state, abort));
+  }
+  REQUIRE(lockstep.report().find("a: 11 acks") != std::string::npos);
+}
+
+TEST_CASE("Replay loop") {
+  std::string data_dir = download_demo_route();
+  Replay replay(DEMO_ROUTE, {}, {}, nullptr, REPLAY_FLAG_NO_VIPC, data_dir);
+
+  struct LoopStats {
+    Replay *replay;
+    std::atomic<double> min_sec = 1e9, max_sec = 0;
+  } stats = {.replay = &replay};
+  replay.installEventFilter([](const Event *e, void *opaque) {
+    auto s = (LoopStats *)opaque;
+    double sec = s->replay->toSeconds(e->mono_time);
+    if (sec < s->min_sec) s->min_sec = sec;
+    if (sec > s->max_sec) s->max_sec = sec;
+    return true;
+  }, &stats);
+
+  int passes = 0;
+  QEventLoop loop;
+  QObject::connect(&replay, &Replay::seekedTo, [&](double sec) {
+    REQUIRE(sec == Approx(70));
+    // the first one is the seek into the region
+    if (++passes == 1) {
+      stats.min_sec = 1e9;
+      stats.max_sec = 0;
+    } else if (passes == 4) {
+      loop.quit();
+    }
+  });
+
+  REQUIRE(replay.load());
+  replay.setLoop(70, 72);
+  REQUIRE(replay.loop());
+  replay.start(70);
+  QTimer::singleShot(30000, &loop, &QEventLoop::quit);
+  loop.exec();
+
+  REQUIRE(passes == 4);
+  REQUIRE(stats.min_sec >= 70);
+  REQUIRE(stats.max_sec < 72);
+  // the region stays loaded
+  REQUIRE(replay.segments().at(1));
+  REQUIRE(replay.segments().at(1)->isLoaded());
+
+  replay.clearLoop();
+  REQUIRE(!replay.loop());
+}
+
+TEST_CASE("Replay loop frame cache") {
+  std::string data_dir = download_demo_route();
+  Replay replay(DEMO_ROUTE, {}, {}, nullptr, REPLAY_FLAG_NO_VIPC_PUBLISH, data_dir);
+
+  // a cached frame has to be the one of its encodeIdx, however the decoder got there
+  struct FrameChecksums : CameraServer::FrameSink {
+    std::mutex lock;
+    std::map<uint32_t, uint64_t> checksums;
+    int repeats = 0, mismatches = 0;
+
+    void cameraBuffers(VisionStreamType type, const std::vector<VisionBuf *> &bufs) override {}
+    void cameraFrame(VisionStreamType type, VisionBuf *buf, const VisionIpcBufExtra &extra) override {
+      if (type != VISION_STREAM_ROAD) return;
+      uint64_t checksum = 0;
+      for (size_t i = 0; i < buf->uv_offset; i += 61) checksum = checksum * 31 + ((uint8_t *)buf->addr)[i];
+      std::lock_guard lk(lock);
+      auto [it, inserted] = checksums.try_emplace(extra.frame_id, checksum);
+      if (!inserted) {
+        ++repeats;
+        mismatches += it->second != checksum;
+      }
+    }
+  } sink;
+  replay.addFrameSink(&sink);
+
+  int passes = 0;
+  QEventLoop loop;
+  QObject::connect(&replay, &Replay::seekedTo, [&](double) {
+    // after the first full pass, restart the decoders in the middle of the cached frames
+    if (++passes == 2) replay.seekTo(71, false);
+    if (passes == 4) loop.quit();
+  });
+
+  REQUIRE(replay.load());
+  replay.setLoop(70, 72);
+  replay.start(70);
+  QTimer::singleShot(30000, &loop, &QEventLoop::quit);
+  loop.exec();
+
+  REQUIRE(passes == 4);
+  replay.removeFrameSink(&sink);
+  std::lock_guard lk(sink.lock);
+  REQUIRE(sink.repeats > 20);
+  REQUIRE(sink.mismatches == 0);
+}
+
+TEST_CASE("Replay frame sink") {
+  std::string data_dir = download_demo_route();
+  Replay replay(DEMO_ROUTE, {}, {}, nullptr, REPLAY_FLAG_NO_VIPC_PUBLISH, data_dir);
+
+  struct TestSink : CameraServer::FrameSink {
+    std::mutex lock;
+    std::set<VisionBuf *> buffers;
+    int frames = 0;
+    int unknown_buffers = 0;
+
+    void cameraBuffers(VisionStreamType type, const std::vector<VisionBuf *> &bufs) override {
+      if (type != VISION_STREAM_ROAD) return;
+      std::lock_guard lk(lock);
+      buffers = std::set<VisionBuf *>(bufs.begin(), bufs.end());
+    }
+    void cameraFrame(VisionStreamType type, VisionBuf *buf, const VisionIpcBufExtra &extra) override {
+      if (type != VISION_STREAM_ROAD) return;
+      std::lock_guard lk(lock);
+      unknown_buffers += buffers.count(buf) == 0;
+      ++frames;
+    }
+  } sink;
+  // before the camera server is started with the stream
+  replay.addFrameSink(&sink);
+
+  REQUIRE(replay.load());
+  replay.start();
+  QEventLoop loop;
+  QTimer::singleShot(5000, &loop, &QEventLoop::quit);
+  loop.exec();
+
+  {
+    std::lock_guard lk(sink.lock);
+    REQUIRE(!sink.buffers.empty());
+    REQUIRE(sink.frames > 10);
+    REQUIRE(sink.unknown_buffers == 0);
+  }
+  // the sink lets go of the buffers and gets no more frames
+  replay.removeFrameSink(&sink);
+  const int frames = sink.frames;
+  QTimer::singleShot(500, &loop, &QEventLoop::quit);
+  loop.exec();
+  REQUIRE(sink.buffers.empty());
+  REQUIRE(sink.frames == frames);
+}
@@ -363,6 +363,17 @@ std::string decompressZST(const std::byte *in, size_t in_size, std::atomic<bool>
   return {};
 }
 
+std::string compressZST(const std::string &in, int level) {
+  std::string out(ZSTD_compressBound(in.size()), '\0');
+  size_t size = ZSTD_compress(out.data(), out.size(), in.data(), in.size(), level);
+  if (ZSTD_isError(size)) {
+    rWarning("compressZST error: %s", ZSTD_getErrorName(size));
+    return {};
+  }
+  out.resize(size);
+  return out;
+}
+
 void precise_nano_sleep(int64_t nanoseconds, std::atomic<bool> &should_exit) {
   struct timespec req, rem;
   req.tv_sec = nanoseconds / 1000000000;